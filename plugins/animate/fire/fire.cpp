@@ -17,11 +17,11 @@ static float random(float s, float e)
     return (s * r + (1 - r) * e);
 }
 
-static int particle_count_for_width(int width)
+static int particle_count_for_width(int width, float quality_factor)
 {
     int particles = fire_particles;
 
-    return particles * std::min(width / 400.0, 3.5);
+    return particles * std::min(width / 400.0, 3.5) * quality_factor;
 }
 
 class FireTransformer : public wf::view_transformer_t
@@ -30,13 +30,15 @@ class FireTransformer : public wf::view_transformer_t
 
   public:
     ParticleSystem ps;
+    /* The fraction of particles used, lowered by the render manager */
+    float quality_factor = 1.0;
 
     FireTransformer(wayfire_view view) :
         ps(fire_particles,
             [=] (Particle& p) {init_particle(p); })
     {
         last_boundingbox = view->get_bounding_box();
-        ps.resize(particle_count_for_width(last_boundingbox.width));
+        ps.resize(particle_count_for_width(last_boundingbox.width, quality_factor));
     }
 
     ~FireTransformer()
@@ -65,7 +67,7 @@ class FireTransformer : public wf::view_transformer_t
     wlr_box get_bounding_box(wf::geometry_t view, wlr_box region) override
     {
         last_boundingbox = view;
-        ps.resize(particle_count_for_width(last_boundingbox.width));
+        ps.resize(particle_count_for_width(last_boundingbox.width, quality_factor));
 
         // TODO
         //
@@ -154,6 +156,15 @@ void FireAnimation::init(wayfire_view view, int dur, wf_animation_type type)
     transformer = decltype(transformer)(tr.get());
 
     view->add_transformer(std::move(tr), name);
+
+    /* Each lower quality level halves the number of particles */
+    quality.num_levels = 3;
+    quality.set_level  = [=] (int level)
+    {
+        transformer->quality_factor = 1.0 / (1 << (quality.num_levels - 1 - level));
+    };
+    quality_output = view->get_output();
+    quality_output->render->add_quality_control(&quality);
 }
 
 bool FireAnimation::step()
@@ -171,5 +182,10 @@ bool FireAnimation::step()
 
 FireAnimation::~FireAnimation()
 {
+    if (quality_output)
+    {
+        quality_output->render->rem_quality_control(&quality);
+    }
+
     view->pop_transformer(name);
 }
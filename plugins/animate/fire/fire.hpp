@@ -15,6 +15,9 @@ class FireAnimation : public animation_base
     nonstd::observer_ptr<FireTransformer> transformer;
     wf::animation::simple_animation_t progression;
 
+    wf::quality_control_t quality;
+    wf::output_t *quality_output = nullptr;
+
   public:
 
     ~FireAnimation();
@@ -1,53 +1,21 @@
 #include "particle.hpp"
 #include "shaders.hpp"
 #include <wayfire/core.hpp>
-#include <thread>
+#include <wayfire/worker-pool.hpp>
+#include <algorithm>
+#include <cmath>
 
-void Particle::update(float time)
-{
-    if (life <= 0) // ignore
-    {
-        return;
-    }
-
-    const float slowdown = 0.8;
-
-    pos   += speed * 0.2f * slowdown;
-    speed += g * 0.3f * slowdown;
-
-    if (life != 0)
-    {
-        color.a /= life;
-    }
-
-    life    -= fade * 0.3 * slowdown;
-    radius   = base_radius * std::pow(life, 0.5);
-    color.a *= life;
-
-    if (start_pos.x < pos.x)
-    {
-        g.x = -1;
-    } else
-    {
-        g.x = 1;
-    }
-
-    if (life <= 0)
-    {
-        /* move outside */
-        pos = {-10000, -10000};
-    }
-}
+/* The number of particles updated by a worker at once */
+static constexpr size_t UPDATE_GRAIN = 1024;
 
 ParticleSystem::ParticleSystem(int particles, ParticleIniter init_func)
 {
     this->pinit_func = init_func;
 
+    particles_alive.store(0);
     resize(particles);
     last_update_msec = wf::get_current_time();
     create_program();
-
-    particles_alive.store(0);
 }
 
 ParticleSystem::~ParticleSystem()
@@ -61,14 +29,40 @@ int ParticleSystem::spawn(int num)
 {
     // TODO: multithread this
     int spawned = 0;
-    for (size_t i = 0; i < ps.size() && spawned < num; i++)
+    for (int i = 0; i < num_particles && spawned < num; i++)
     {
-        if (ps[i].life <= 0)
+        if (life[i] > 0)
         {
-            pinit_func(ps[i]);
-            ++spawned;
-            ++particles_alive;
+            continue;
+        }
+
+        Particle p;
+        pinit_func(p);
+
+        life[i] = p.life;
+        fade[i] = p.fade;
+        base_radius[i] = p.base_radius;
+        pos_x[i]   = p.pos.x;
+        pos_y[i]   = p.pos.y;
+        speed_x[i] = p.speed.x;
+        speed_y[i] = p.speed.y;
+        g_x[i]     = p.g.x;
+        g_y[i]     = p.g.y;
+        start_x[i] = p.start_pos.x;
+        base_alpha[i] = (p.life > 0) ? p.color.a / p.life : 0;
+
+        for (int j = 0; j < 4; j++)
+        {
+            color[4 * i + j] = p.color[j];
+            dark_color[4 * i + j] = p.color[j] * 0.5;
         }
+
+        center[2 * i]     = p.pos.x;
+        center[2 * i + 1] = p.pos.y;
+        radius[i] = p.radius;
+
+        ++spawned;
+        ++particles_alive;
     }
 
     return spawned;
@@ -76,21 +70,26 @@ int ParticleSystem::spawn(int num)
 
 void ParticleSystem::resize(int num)
 {
-    if (num == (int)ps.size())
+    if (num == num_particles)
     {
         return;
     }
 
-    // TODO: multithread this
-    for (int i = num; i < (int)ps.size(); i++)
+    for (int i = num; i < num_particles; i++)
     {
-        if (ps[i].life >= 0)
+        if (life[i] > 0)
         {
             --particles_alive;
         }
     }
 
-    ps.resize(num);
+    num_particles = num;
+    life.resize(num, -1);
+    for (auto field : {&fade, &base_radius, &base_alpha, &pos_x, &pos_y,
+        &speed_x, &speed_y, &g_x, &g_y, &start_x})
+    {
+        field->resize(num);
+    }
 
     color.resize(color_per_particle * num);
     dark_color.resize(color_per_particle * num);
@@ -100,62 +99,80 @@ void ParticleSystem::resize(int num)
 
 int ParticleSystem::size()
 {
-    return ps.size();
+    return num_particles;
 }
 
+/*
+ * Update the particles in [start, end) and write the results to the shader
+ * inputs. Time is the percentage of the frame which has elapsed.
+ *
+ * The loop has no branches, so that the compiler can vectorize it: when a
+ * particle dies, its fade, speed and gravity are multiplied by 0, which
+ * freezes it until it is spawned again.
+ */
 void ParticleSystem::update_worker(float time, int start, int end)
 {
-    end = std::min(end, (int)ps.size());
+    const float slowdown   = 0.8;
+    const float pos_step   = 0.2f * slowdown;
+    const float speed_step = 0.3f * slowdown;
+    const float life_step  = 0.3f * slowdown;
+
+    float *__restrict life    = this->life.data();
+    float *__restrict fade    = this->fade.data();
+    float *__restrict pos_x   = this->pos_x.data();
+    float *__restrict pos_y   = this->pos_y.data();
+    float *__restrict speed_x = this->speed_x.data();
+    float *__restrict speed_y = this->speed_y.data();
+    float *__restrict g_x     = this->g_x.data();
+    float *__restrict g_y     = this->g_y.data();
+    const float *__restrict start_x     = this->start_x.data();
+    const float *__restrict base_radius = this->base_radius.data();
+    const float *__restrict base_alpha  = this->base_alpha.data();
+    float *__restrict color      = this->color.data();
+    float *__restrict dark_color = this->dark_color.data();
+    float *__restrict radius     = this->radius.data();
+    float *__restrict center     = this->center.data();
+
+    /* The arrays don't overlap, which the compiler can't know */
+    int died = 0;
+#if defined(__clang__)
+  #pragma clang loop vectorize(assume_safety)
+#elif defined(__GNUC__)
+  #pragma GCC ivdep
+#endif
     for (int i = start; i < end; ++i)
     {
-        if (ps[i].life <= 0)
-        {
-            continue;
-        }
-
-        // printf("%d\n", i);
-        ps[i].update(time);
-
-        if (ps[i].life <= 0)
-        {
-            --particles_alive;
-        }
-
-        for (int j = 0; j < 4; j++) // maybe use memcpy?
-        {
-            color[4 * i + j] = ps[i].color[j];
-            dark_color[4 * i + j] = ps[i].color[j] * 0.5;
-        }
-
-        // printf("center %d gets %f", 2 * i, ps[i].pos[0]);
-        center[2 * i]     = ps[i].pos[0];
-        center[2 * i + 1] = ps[i].pos[1];
-
-        radius[i] = ps[i].radius;
-    }
-}
-
-void ParticleSystem::exec_worker_threads(std::function<void(int, int)> spawn_worker)
-{
-// return spawn_worker(0, ps.size());
-
-    const int num_threads = std::thread::hardware_concurrency();
-    const int worker_load = (ps.size() + num_threads - 1) / num_threads;
-
-    std::thread workers[num_threads];
-    for (int i = 0; i < num_threads; i++)
-    {
-        int thread_start = i * worker_load;
-        int thread_end   = (i + 1) * worker_load;
-        thread_end = std::min(thread_end, (int)ps.size());
-
-        workers[i] = std::thread([=] () { spawn_worker(thread_start, thread_end); });
+        const float old_life = life[i];
+        const float new_life = old_life - fade[i] * life_step;
+        const float alive    = (new_life > 0) ? 1.0f : 0.0f;
+        const bool dies = (old_life > 0) & (new_life <= 0);
+        died += dies;
+
+        /* Dead particles are moved outside */
+        float x = pos_x[i] + speed_x[i] * pos_step;
+        float y = pos_y[i] + speed_y[i] * pos_step;
+        x = dies ? -10000.0f : x;
+        y = dies ? -10000.0f : y;
+
+        speed_x[i] = (speed_x[i] + g_x[i] * speed_step) * alive;
+        speed_y[i] = (speed_y[i] + g_y[i] * speed_step) * alive;
+        g_x[i]   = ((start_x[i] < x) ? -1.0f : 1.0f) * alive;
+        g_y[i]  *= alive;
+        fade[i] *= alive;
+        life[i]  = new_life;
+        pos_x[i] = x;
+        pos_y[i] = y;
+
+        /* The radius and alpha fade with the life */
+        const float remaining = std::max(new_life, 0.0f);
+        radius[i] = base_radius[i] * std::sqrt(remaining);
+        color[4 * i + 3] = base_alpha[i] * remaining;
+        dark_color[4 * i + 3] = base_alpha[i] * remaining * 0.5f;
+        center[2 * i]     = x;
+        center[2 * i + 1] = y;
     }
 
-    for (auto& w : workers)
-    {
-        w.join();
-    }
+    particles_alive -= died;
 }
 
 void ParticleSystem::update()
@@ -164,7 +181,8 @@ void ParticleSystem::update()
     float time = (wf::get_current_time() - last_update_msec) / 16.0;
     last_update_msec = wf::get_current_time();
 
-    exec_worker_threads([=] (int start, int end)
+    wf::get_core().worker_pool->parallel_for(num_particles, UPDATE_GRAIN,
+        [=] (size_t start, size_t end)
     {
         update_worker(time, start, end);
     });
@@ -181,6 +199,12 @@ void ParticleSystem::create_program()
     OpenGL::render_begin();
     program.set_simple(OpenGL::compile_program(particle_vert_source,
         particle_frag_source));
+    matrix_uniform    = program.get_uniform("matrix");
+    smoothing_uniform = program.get_uniform("smoothing");
+    position_attrib = program.get_attrib("position");
+    radius_attrib   = program.get_attrib("radius");
+    center_attrib   = program.get_attrib("center");
+    color_attrib    = program.get_attrib("color");
     OpenGL::render_end();
 }
 
@@ -194,37 +218,35 @@ void ParticleSystem::render(glm::mat4 matrix)
         -1, 1
     };
 
-    program.attrib_pointer("position", 2, 0, vertex_data);
-    program.attrib_divisor("position", 0);
+    program.attrib_pointer(position_attrib, 2, 0, vertex_data);
+    program.attrib_divisor(position_attrib, 0);
 
-    program.attrib_pointer("radius", 1, 0, radius.data());
-    program.attrib_divisor("radius", 1);
+    program.attrib_pointer(radius_attrib, 1, 0, radius.data());
+    program.attrib_divisor(radius_attrib, 1);
 
-    program.attrib_pointer("center", 2, 0, center.data());
-    program.attrib_divisor("center", 1);
+    program.attrib_pointer(center_attrib, 2, 0, center.data());
+    program.attrib_divisor(center_attrib, 1);
 
     // matrix
-    program.uniformMatrix4f("matrix", matrix);
+    program.uniformMatrix4f(matrix_uniform, matrix);
 
     /* Darken the background */
-    program.attrib_pointer("color", 4, 0, dark_color.data());
-    program.attrib_divisor("color", 1);
+    program.attrib_pointer(color_attrib, 4, 0, dark_color.data());
+    program.attrib_divisor(color_attrib, 1);
 
-    GL_CALL(glEnable(GL_BLEND));
-    GL_CALL(glBlendFunc(GL_ZERO, GL_ONE_MINUS_SRC_ALPHA));
-    program.uniform1f("smoothing", 0.7);
+    OpenGL::set_blend_state(true, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+    program.uniform1f(smoothing_uniform, 0.7);
 
     // TODO: optimize shaders for this case
-    GL_CALL(glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, ps.size()));
+    GL_CALL(glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, num_particles));
 
     // particle color
-    program.attrib_pointer("color", 4, 0, color.data());
-    GL_CALL(glBlendFunc(GL_SRC_ALPHA, GL_ONE));
-    program.uniform1f("smoothing", 0.5);
-    GL_CALL(glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, ps.size()));
+    program.attrib_pointer(color_attrib, 4, 0, color.data());
+    OpenGL::set_blend_state(true, GL_SRC_ALPHA, GL_ONE);
+    program.uniform1f(smoothing_uniform, 0.5);
+    GL_CALL(glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, num_particles));
 
-    GL_CALL(glDisable(GL_BLEND));
-    GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+    OpenGL::set_blend_state(false);
 
     program.deactivate();
 }
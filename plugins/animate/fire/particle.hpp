@@ -6,6 +6,7 @@
 #include <atomic>
 #include <vector>
 
+/* The initial state of a particle, filled by the ParticleIniter */
 struct Particle
 {
     float life = -1;
@@ -17,11 +18,6 @@ struct Particle
     glm::vec2 start_pos;
 
     glm::vec4 color{1.0, 1.0, 1.0, 1.0};
-
-    /* update the given particle
-     * time is the percentage of the frame which has elapsed
-     * must be thread-safe */
-    void update(float time);
 };
 
 /* a function to initialize a particle */
@@ -65,8 +61,15 @@ class ParticleSystem
     uint32_t last_update_msec;
 
     std::atomic<int> particles_alive;
-    std::vector<Particle> ps;
+    int num_particles = 0;
+
+    /* The state of the particles, one array per field, so that the update
+     * can process several particles at once with SIMD instructions */
+    std::vector<float> life, fade, base_radius, base_alpha;
+    std::vector<float> pos_x, pos_y, speed_x, speed_y, g_x, g_y, start_x;
 
+    /* The inputs of the shader, written directly by the update. The color
+     * of a particle doesn't change except for its alpha. */
     static constexpr int color_per_particle = 4;
     std::vector<float> color, dark_color;
 
@@ -77,7 +80,9 @@ class ParticleSystem
     std::vector<float> center;
 
     OpenGL::program_t program;
-    void exec_worker_threads(std::function<void(int, int)> spawn_worker);
+    OpenGL::uniform_t matrix_uniform, smoothing_uniform;
+    OpenGL::attrib_t position_attrib, radius_attrib, center_attrib, color_attrib;
+
     void update_worker(float time, int start, int end);
     void create_program();
 };
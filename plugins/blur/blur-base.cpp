@@ -64,25 +64,41 @@ wf_blur_base::wf_blur_base(wf::output_t *output, std::string name)
     this->degrade_opt.set_callback(options_changed);
     this->iterations_opt.set_callback(options_changed);
 
+    this->quality.num_levels = 3;
+    this->quality.set_level  = [=] (int) { output->render->damage_whole_idle(); };
+    output->render->add_quality_control(&quality);
+
     OpenGL::render_begin();
     blend_program.compile(blur_blend_vertex_shader, blur_blend_fragment_shader);
+    blend_mvp = blend_program.get_uniform("mvp");
+    blend_bg_texture = blend_program.get_uniform("bg_texture");
+    blend_sat = blend_program.get_uniform("sat");
+    blend_position = blend_program.get_attrib("position");
     OpenGL::render_end();
 }
 
 wf_blur_base::~wf_blur_base()
 {
+    output->render->rem_quality_control(&quality);
+
     OpenGL::render_begin();
     fb[0].release();
     fb[1].release();
+    background.release();
     program[0].free_resources();
     program[1].free_resources();
     blend_program.free_resources();
     OpenGL::render_end();
 }
 
+int wf_blur_base::get_degrade() const
+{
+    return (int)degrade_opt << (quality.num_levels - 1 - quality.level);
+}
+
 int wf_blur_base::calculate_blur_radius()
 {
-    return offset_opt * degrade_opt * std::max(1, (int)iterations_opt);
+    return offset_opt * get_degrade() * std::max(1, (int)iterations_opt);
 }
 
 void wf_blur_base::render_iteration(wf::region_t blur_region,
@@ -137,81 +153,125 @@ static wf::geometry_t sanitize(wf::geometry_t box, int degrade,
     return wf::clamp(out_box, bounds);
 }
 
-wlr_box wf_blur_base::copy_region(wf::framebuffer_base_t& result,
-    const wf::framebuffer_t& source, const wf::region_t& region)
+wf::region_t wf_blur_base::copy_region(const wf::framebuffer_t& source,
+    const wf::region_t& region)
 {
-    auto subbox = source.framebuffer_box_from_geometry_box(
-        wlr_box_from_pixman_box(region.get_extents()));
-
     auto source_box =
         source.framebuffer_box_from_geometry_box(source.geometry);
 
-    // Make sure that the box is aligned properly for degrading, otherwise,
-    // we get a flickering
-    subbox = sanitize(subbox, degrade_opt, source_box);
-    int degraded_width  = subbox.width / degrade_opt;
-    int degraded_height = subbox.height / degrade_opt;
+    int degrade = get_degrade();
+    int degraded_width  = round_up(source_box.width, degrade) / degrade;
+    int degraded_height = round_up(source_box.height, degrade) / degrade;
 
     OpenGL::render_begin(source);
-    result.allocate(degraded_width, degraded_height);
+    fb[0].allocate(degraded_width, degraded_height);
 
     GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, source.fb));
-    GL_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, result.fb));
-    GL_CALL(glBlitFramebuffer(
-        subbox.x, source_box.height - subbox.y - subbox.height,
-        subbox.x + subbox.width, source_box.height - subbox.y,
-        0, 0, degraded_width, degraded_height,
-        GL_COLOR_BUFFER_BIT, GL_LINEAR));
+    GL_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fb[0].fb));
+
+    wf::region_t copied;
+    for (const auto& rect : region)
+    {
+        // Make sure that the box is aligned properly for degrading, otherwise,
+        // we get a flickering
+        auto box = sanitize(wlr_box_from_pixman_box(rect), degrade, source_box);
+        if ((box.width <= 0) || (box.height <= 0))
+        {
+            continue;
+        }
+
+        copied |= box;
+        GL_CALL(glBlitFramebuffer(
+            box.x, source_box.height - box.y - box.height,
+            box.x + box.width, source_box.height - box.y,
+            box.x / degrade,
+            degraded_height - (box.y + box.height) / degrade,
+            (box.x + box.width) / degrade,
+            degraded_height - box.y / degrade,
+            GL_COLOR_BUFFER_BIT, GL_LINEAR));
+    }
+
     OpenGL::render_end();
 
-    return subbox;
+    return copied;
 }
 
-void wf_blur_base::pre_render(wf::texture_t src_tex, wlr_box src_box,
-    const wf::region_t& damage, const wf::framebuffer_t& target_fb)
+/** Transform region into framebuffer coordinates */
+static wf::region_t get_fb_region(const wf::region_t& region,
+    const wf::framebuffer_t& fb)
 {
-    int degrade     = degrade_opt;
-    auto damage_box = copy_region(fb[0], target_fb, damage);
-
-    /* As an optimization, we create a region that blur can use
-     * to perform minimal rendering required to blur. We start
-     * by translating the input damage region */
-    wf::region_t blur_damage;
-    for (auto b : damage)
+    wf::region_t result;
+    for (const auto& rect : region)
     {
-        blur_damage |= target_fb.framebuffer_box_from_geometry_box(
-            wlr_box_from_pixman_box(b));
+        result |= fb.framebuffer_box_from_geometry_box(
+            wlr_box_from_pixman_box(rect));
     }
 
-    /* Scale and translate the region */
-    blur_damage += -wf::point_t{damage_box.x, damage_box.y};
-    blur_damage *= 1.0 / degrade;
+    return result;
+}
 
-    int r = blur_fb0(blur_damage, fb[0].viewport_width, fb[0].viewport_height);
+void wf_blur_base::pre_render(wf::texture_t src_tex, wlr_box src_box,
+    const wf::region_t& damage, const wf::framebuffer_t& target_fb,
+    const wf_blur_group *group)
+{
+    int degrade     = get_degrade();
+    auto source_box =
+        target_fb.framebuffer_box_from_geometry_box(target_fb.geometry);
+    auto fb_damage  = get_fb_region(damage, target_fb) & source_box;
 
-    /* Make sure the result is always fb[1], because that's what is used in render()
-     * */
-    if (r != 0)
+    bool reuse = group && (group->id == blurred_group) &&
+        (target_fb.fb == blurred_fb) &&
+        (target_fb.geometry == blurred_geometry) &&
+        (fb_damage ^ blurred_region).empty();
+    if (!reuse)
     {
-        std::swap(fb[0], fb[1]);
+        wf::region_t to_blur = fb_damage;
+        if (group)
+        {
+            to_blur |= get_fb_region(shared_damage & group->region, target_fb);
+        }
+
+        blurred_region   = copy_region(target_fb, to_blur);
+        blurred_fb       = target_fb.fb;
+        blurred_geometry = target_fb.geometry;
+        blurred_group    = group ? group->id : 0;
+
+        /* As an optimization, blur only the copied region, scaled to the
+         * size of fb[0] */
+        wf::region_t blur_damage = blurred_region * (1.0 / degrade);
+        int r = blur_fb0(blur_damage, fb[0].viewport_width,
+            fb[0].viewport_height);
+
+        /* Make sure the result is always fb[0], because that's what is used
+         * for the next views of the group */
+        if (r != 0)
+        {
+            std::swap(fb[0], fb[1]);
+        }
     }
 
     /* we subtract target_fb's position to so that
      * view box is relative to framebuffer */
-    auto view_box = target_fb.framebuffer_box_from_geometry_box(src_box);
+    auto view_box  = target_fb.framebuffer_box_from_geometry_box(src_box);
+    auto blit_box  = sanitize(view_box, degrade, source_box);
+    int fb0_height = fb[0].viewport_height;
 
     OpenGL::render_begin();
-    fb[1].allocate(view_box.width, view_box.height);
-    fb[1].bind();
+    background.allocate(view_box.width, view_box.height);
+    background.bind();
     GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, fb[0].fb));
 
     /* Blit the blurred texture into an fb which has the size of the view,
      * so that the view texture and the blurred background can be combined
      * together in render()
      *
-     * local_geometry is damage_box relative to view box */
-    wlr_box local_box = damage_box + wf::point_t{-view_box.x, -view_box.y};
-    GL_CALL(glBlitFramebuffer(0, 0, fb[0].viewport_width, fb[0].viewport_height,
+     * local_box is blit_box relative to view box */
+    wlr_box local_box = blit_box + wf::point_t{-view_box.x, -view_box.y};
+    GL_CALL(glBlitFramebuffer(
+        blit_box.x / degrade,
+        fb0_height - (blit_box.y + blit_box.height) / degrade,
+        (blit_box.x + blit_box.width) / degrade,
+        fb0_height - blit_box.y / degrade,
         local_box.x,
         view_box.height - local_box.y - local_box.height,
         local_box.x + local_box.width,
@@ -221,8 +281,45 @@ void wf_blur_base::pre_render(wf::texture_t src_tex, wlr_box src_box,
     OpenGL::render_end();
 }
 
+void wf_blur_base::set_shared_damage(const wf::region_t& damage)
+{
+    shared_damage = damage;
+    blurred_region.clear();
+    blurred_group = 0;
+}
+
+bool wf_blur_cache::matches(wlr_box src_box,
+    const wf::framebuffer_t& target_fb) const
+{
+    return valid && (fb_geometry == target_fb.geometry) &&
+           (box == target_fb.framebuffer_box_from_geometry_box(src_box));
+}
+
+void wf_blur_base::store_result(wf_blur_cache& cache, wlr_box src_box,
+    const wf::framebuffer_t& target_fb)
+{
+    /* background is allocated again by the next pre_render() */
+    std::swap(cache.fb, background);
+    cache.box = target_fb.framebuffer_box_from_geometry_box(src_box);
+    cache.fb_geometry = target_fb.geometry;
+    cache.valid = true;
+}
+
 void wf_blur_base::render(wf::texture_t src_tex, wlr_box src_box,
     wlr_box scissor_box, const wf::framebuffer_t& target_fb)
+{
+    render_background(src_tex, src_box, scissor_box, target_fb, background.tex);
+}
+
+void wf_blur_base::render(wf::texture_t src_tex, wlr_box src_box,
+    wlr_box scissor_box, const wf::framebuffer_t& target_fb,
+    const wf_blur_cache& cache)
+{
+    render_background(src_tex, src_box, scissor_box, target_fb, cache.fb.tex);
+}
+
+void wf_blur_base::render_background(wf::texture_t src_tex, wlr_box src_box,
+    wlr_box scissor_box, const wf::framebuffer_t& target_fb, GLuint bg_tex)
 {
     wlr_box fb_geom =
         target_fb.framebuffer_box_from_geometry_box(target_fb.geometry);
@@ -239,17 +336,17 @@ void wf_blur_base::render(wf::texture_t src_tex, wlr_box src_box,
         -1.0f, 1.0f
     };
 
-    blend_program.attrib_pointer("position", 2, 0, vertexData);
+    blend_program.attrib_pointer(blend_position, 2, 0, vertexData);
 
     /* Blend blurred background with window texture src_tex */
-    blend_program.uniformMatrix4f("mvp", glm::inverse(target_fb.transform));
+    blend_program.uniformMatrix4f(blend_mvp, glm::inverse(target_fb.transform));
     /* XXX: core should give us the number of texture units used */
-    blend_program.uniform1i("bg_texture", 1);
-    blend_program.uniform1f("sat", saturation_opt);
+    blend_program.uniform1i(blend_bg_texture, 1);
+    blend_program.uniform1f(blend_sat, saturation_opt);
 
     blend_program.set_active_texture(src_tex);
     GL_CALL(glActiveTexture(GL_TEXTURE0 + 1));
-    GL_CALL(glBindTexture(GL_TEXTURE_2D, fb[1].tex));
+    GL_CALL(glBindTexture(GL_TEXTURE_2D, bg_tex));
     /* Render it to target_fb */
     target_fb.bind();
     GL_CALL(glViewport(view_box.x, fb_geom.height - view_box.y - view_box.height,
@@ -6,6 +6,7 @@
 #include <wayfire/workspace-stream.hpp>
 #include <wayfire/workspace-manager.hpp>
 #include <wayfire/signal-definitions.hpp>
+#include <unordered_map>
 
 #include "blur.hpp"
 
@@ -17,6 +18,17 @@ class wf_blur_transformer : public wf::view_transformer_t
     wayfire_view view;
 
   public:
+    /* the blurred background from an earlier frame */
+    wf_blur_cache cache;
+    /* set by the plugin when it damaged the whole view to fill the cache */
+    bool fill_pending = false;
+    /* the bounding box of the view when the cache could not be filled, for ex.
+     * because a part of the view is behind an opaque view. Filling the cache
+     * is not tried again until the view changes. */
+    wf::geometry_t failed_fill_box = {0, 0, 0, 0};
+    /* the blur group of the view in the current frame */
+    std::shared_ptr<wf_blur_group> group;
+
     wf_blur_transformer(blur_algorithm_provider blur_algorithm_provider,
         wf::output_t *output, wayfire_view view)
     {
@@ -25,6 +37,13 @@ class wf_blur_transformer : public wf::view_transformer_t
         this->view   = view;
     }
 
+    ~wf_blur_transformer()
+    {
+        OpenGL::render_begin();
+        cache.fb.release();
+        OpenGL::render_end();
+    }
+
     wf::pointf_t transform_point(wf::geometry_t view,
         wf::pointf_t point) override
     {
@@ -100,7 +119,12 @@ class wf_blur_transformer : public wf::view_transformer_t
 
         if (!blurred_region.empty())
         {
-            provider()->pre_render(src_tex, src_box, blurred_region, target_fb);
+            if (!uses_cache(src_box, target_fb))
+            {
+                blur_background(src_tex, src_box, damage, blurred_region,
+                    target_fb);
+            }
+
             wf::view_transformer_t::render_with_damage(src_tex, src_box,
                 blurred_region, target_fb);
         }
@@ -113,10 +137,56 @@ class wf_blur_transformer : public wf::view_transformer_t
         }
     }
 
+    /**
+     * Whether the background of the view can be cached when rendering to
+     * target_fb. The plugin invalidates the cache with the damage of the
+     * current workspace, so other workspace streams don't use it. Sticky
+     * views, like panels, are drawn with the same box in the streams of all
+     * workspaces, so they never use it.
+     */
+    bool can_cache(const wf::framebuffer_t& target_fb) const
+    {
+        return !view->sticky &&
+               (wf::origin(target_fb.geometry) == wf::point_t{0, 0});
+    }
+
+    bool uses_cache(wlr_box src_box, const wf::framebuffer_t& target_fb) const
+    {
+        return can_cache(target_fb) && cache.matches(src_box, target_fb);
+    }
+
+    /**
+     * Blur the background for the damaged region of the view. If the whole
+     * view is damaged, the scene below it has been repainted, so the whole
+     * background is blurred and kept in the cache for the next frames.
+     */
+    void blur_background(wf::texture_t src_tex, wlr_box src_box,
+        const wf::region_t& damage, const wf::region_t& blurred_region,
+        const wf::framebuffer_t& target_fb)
+    {
+        if (can_cache(target_fb) && (wf::region_t{src_box} ^ damage).empty())
+        {
+            provider()->pre_render(src_tex, src_box, wf::region_t{src_box},
+                target_fb, group.get());
+            provider()->store_result(cache, src_box, target_fb);
+            fill_pending = false;
+        } else
+        {
+            provider()->pre_render(src_tex, src_box, blurred_region, target_fb,
+                group.get());
+        }
+    }
+
     void render_box(wf::texture_t src_tex, wlr_box src_box, wlr_box scissor_box,
         const wf::framebuffer_t& target_fb) override
     {
-        provider()->render(src_tex, src_box, scissor_box, target_fb);
+        if (uses_cache(src_box, target_fb))
+        {
+            provider()->render(src_tex, src_box, scissor_box, target_fb, cache);
+        } else
+        {
+            provider()->render(src_tex, src_box, scissor_box, target_fb);
+        }
     }
 };
 
@@ -140,6 +210,31 @@ class wayfire_blur : public wf::plugin_interface_t
     wf::framebuffer_base_t saved_pixels;
     wf::region_t padded_region;
 
+    /* the damage of each view since the last frame */
+    std::unordered_map<wf::view_interface_t*, wf::region_t> view_damage;
+    uint64_t last_stack_version = 0;
+    uint64_t last_group_id = 0;
+
+    wf::signal_connection_t on_view_damaged = [=] (wf::signal_data_t *data)
+    {
+        auto ev = static_cast<wf::view_region_damaged_signal*>(data);
+        view_damage[ev->view.get()] |= ev->box;
+    };
+
+    void track_damage(wayfire_view view)
+    {
+        /* A view may be attached and then mapped */
+        view->disconnect_signal(&on_view_damaged);
+        view->connect_signal(wf::REGION_DAMAGED_SIGNAL, &on_view_damaged);
+    }
+
+    nonstd::observer_ptr<wf_blur_transformer> get_blur_transformer(
+        wayfire_view view)
+    {
+        return nonstd::make_observer(dynamic_cast<wf_blur_transformer*>(
+            view->get_transformer(transformer_name).get()));
+    }
+
     void add_transformer(wayfire_view view)
     {
         if (view->get_transformer(transformer_name))
@@ -239,6 +334,129 @@ class wayfire_blur : public wf::plugin_interface_t
         }
     }
 
+    /**
+     * Invalidate the cached backgrounds of the blurred views which have damage
+     * below them. Damage which doesn't come from a view, for ex. from a plugin,
+     * is assumed to be below all views.
+     *
+     * @return The region of the views whose cache can be filled in this frame.
+     *   It must be repainted fully, so that the views are blurred from scratch.
+     */
+    wf::region_t update_blur_caches(const std::vector<wayfire_view>& views,
+        const wf::region_t& damage, double scale)
+    {
+        auto stack_version = output->workspace->get_stack_order_version();
+        bool restacked     = (stack_version != last_stack_version);
+        last_stack_version = stack_version;
+
+        /* Scaling the view damage to the output scale and back may grow it by
+         * a pixel, which shouldn't count as damage from below */
+        wf::region_t below = damage;
+        for (auto& view : views)
+        {
+            auto it = view_damage.find(view.get());
+            if (it != view_damage.end())
+            {
+                for (const auto& rect : it->second)
+                {
+                    below ^= wlr_box{rect.x1 - 1, rect.y1 - 1,
+                        rect.x2 - rect.x1 + 2, rect.y2 - rect.y1 + 2};
+                }
+            }
+        }
+
+        wf::region_t fill_region;
+        for (auto it = views.rbegin(); it != views.rend(); ++it)
+        {
+            auto& view   = *it;
+            auto damaged = view_damage.find(view.get());
+            auto blur    = get_blur_transformer(view);
+            if (blur && !view->sticky)
+            {
+                auto bbox = view->get_bounding_box();
+                if (blur->fill_pending)
+                {
+                    blur->fill_pending    = false;
+                    blur->failed_fill_box = bbox;
+                }
+
+                if (restacked)
+                {
+                    blur->failed_fill_box = {0, 0, 0, 0};
+                }
+
+                bool below_damaged = restacked ||
+                    !(below & expand_region(bbox, scale)).empty();
+                if (below_damaged)
+                {
+                    blur->cache.valid = false;
+                }
+
+                /* Fill the cache when the view is repainted anyway, and the
+                 * scene below it is static */
+                if (!blur->cache.valid && !below_damaged &&
+                    (damaged != view_damage.end()) &&
+                    (bbox != blur->failed_fill_box))
+                {
+                    blur->fill_pending = true;
+                    fill_region |= bbox;
+                }
+            }
+
+            if (damaged != view_damage.end())
+            {
+                below |= damaged->second;
+            }
+        }
+
+        view_damage.clear();
+        return fill_region;
+    }
+
+    /**
+     * Split the blurred views into blur groups, see wf_blur_group. A new group
+     * starts at a blurred view which overlaps a view rendered after the first
+     * view of the current group.
+     */
+    void update_blur_groups(const std::vector<wayfire_view>& views,
+        double scale)
+    {
+        std::shared_ptr<wf_blur_group> group;
+        /* the region drawn since the first view of the group */
+        wf::region_t drawn;
+        for (auto it = views.rbegin(); it != views.rend(); ++it)
+        {
+            auto& view = *it;
+            auto bbox  = view->get_bounding_box();
+            auto blur  = get_blur_transformer(view);
+            if (blur && view->sticky)
+            {
+                blur->group = nullptr;
+            } else if (blur)
+            {
+                auto padded = expand_region(bbox, scale);
+                if (!group || !(drawn & padded).empty())
+                {
+                    group     = std::make_shared<wf_blur_group>();
+                    group->id = ++last_group_id;
+                    drawn.clear();
+                }
+
+                group->region |= padded;
+                blur->group    = group;
+            }
+
+            /* Sticky views are drawn at other positions on the other
+             * workspaces */
+            if (view->sticky)
+            {
+                group = nullptr;
+            }
+
+            drawn |= bbox;
+        }
+    }
+
     /** Find the region of blurred views on the given workspace */
     wf::region_t get_blur_region(wf::point_t ws) const
     {
@@ -290,6 +508,7 @@ class wayfire_blur : public wf::plugin_interface_t
         view_attached = [=] (wf::signal_data_t *data)
         {
             auto view = get_signaled_view(data);
+            track_damage(view);
             /* View was just created -> we don't know its layer yet */
             if (!view->is_mapped())
             {
@@ -308,6 +527,8 @@ class wayfire_blur : public wf::plugin_interface_t
         view_detached = [=] (wf::signal_data_t *data)
         {
             auto view = get_signaled_view(data);
+            view->disconnect_signal(&on_view_damaged);
+            view_damage.erase(view.get());
             pop_transformer(view);
         };
         output->connect_signal("view-attached", &view_attached);
@@ -330,6 +551,9 @@ class wayfire_blur : public wf::plugin_interface_t
             wf::surface_interface_t::set_opaque_shrink_constraint("blur",
                 padding);
 
+            auto views = output->workspace->get_views_in_layer(wf::ALL_LAYERS);
+            update_blur_groups(views, fb.scale);
+            damage |= update_blur_caches(views, damage, fb.scale);
             output->render->damage(expand_region(
                 damage & this->blur_region, fb.scale));
         };
@@ -382,6 +606,7 @@ class wayfire_blur : public wf::plugin_interface_t
 
             /* This effectively makes damage the same as expanded_damage. */
             damage |= expanded_damage;
+            blur_algorithm->set_shared_damage(damage);
             GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
             OpenGL::render_end();
         };
@@ -424,6 +649,7 @@ class wayfire_blur : public wf::plugin_interface_t
         for (auto& view :
              output->workspace->get_views_in_layer(wf::ALL_LAYERS))
         {
+            track_damage(view);
             if (blur_by_default.matches(view))
             {
                 add_transformer(view);
@@ -444,6 +670,7 @@ class wayfire_blur : public wf::plugin_interface_t
             &workspace_stream_pre);
         output->render->disconnect_signal("workspace-stream-post",
             &workspace_stream_post);
+        on_view_damaged.disconnect();
 
         /* Call blur algorithm destructor */
         blur_algorithm = nullptr;
@@ -85,17 +85,70 @@
  * `````````````````````````````````````````````````````````````````
  */
 
+/**
+ * The blurred background behind a view, kept from an earlier frame.
+ *
+ * It is valid until something below the view is damaged, so that a view over
+ * a static background, like a wallpaper, is blurred only once, and not each
+ * time its own contents change.
+ */
+struct wf_blur_cache
+{
+    /* the blurred background, with the size of box */
+    wf::framebuffer_base_t fb;
+    /* the view box in framebuffer coords, and the geometry of the framebuffer
+     * that the background was blurred for */
+    wlr_box box;
+    wf::geometry_t fb_geometry;
+    bool valid = false;
+
+    /* whether the cache is valid for the given view box and framebuffer */
+    bool matches(wlr_box src_box, const wf::framebuffer_t& target_fb) const;
+};
+
+/**
+ * Blurred views whose backgrounds can be blurred together, in one pass.
+ *
+ * Views are rendered from the bottom to the top, so the background of a view
+ * is final only after the views below it are rendered. If no view which is
+ * rendered between two blurred views overlaps the upper one, its background is
+ * final already when the lower one is rendered, and they can share the result
+ * of the blur.
+ */
+struct wf_blur_group
+{
+    /* unique for each group, even across frames */
+    uint64_t id;
+    /* the union of the padded bounding boxes of the views in the group */
+    wf::region_t region;
+};
+
 class wf_blur_base
 {
   protected:
     /* used to store temporary results in blur algorithms, cleaned up in base
-     * destructor */
+     * destructor. They have the size of the (degraded) target framebuffer, so
+     * that they don't have to be reallocated when the damage changes */
     wf::framebuffer_base_t fb[2];
+    /* the blurred background of the view being rendered, with its size */
+    wf::framebuffer_base_t background;
+
+    /* the damage of the framebuffer being repainted, see set_shared_damage() */
+    wf::region_t shared_damage;
+    /* the region of fb[0] which holds a blurred copy of a framebuffer, in the
+     * coordinates of that framebuffer, and where it was copied from */
+    wf::region_t blurred_region;
+    GLuint blurred_fb = -1;
+    wf::geometry_t blurred_geometry = {0, 0, 0, 0};
+    uint64_t blurred_group = 0;
     /* the program created by the given algorithm, cleaned up in base destructor */
     OpenGL::program_t program[2];
     /* the program used by wf_blur_base to combine the blurred, unblurred and
      * view texture */
     OpenGL::program_t blend_program;
+    /* handles of blend_program's uniforms and attributes */
+    OpenGL::uniform_t blend_mvp, blend_bg_texture, blend_sat;
+    OpenGL::attrib_t blend_position;
 
     /* used to get individual algorithm options from config
      * should be set by the constructor */
@@ -106,35 +159,70 @@ class wf_blur_base
     wf::option_wrapper_t<int> degrade_opt, iterations_opt;
     wf::config::option_base_t::updated_callback_t options_changed;
 
+    /* Each lower quality level doubles the degrade factor */
+    wf::quality_control_t quality;
+
     wf::output_t *output;
 
+    /* the degrade factor from the options, adjusted for the quality level */
+    int get_degrade() const;
+
     /* renders the in texture to the out framebuffer.
      * assumes a properly bound and initialized GL program */
     void render_iteration(wf::region_t blur_region,
         wf::framebuffer_base_t& in, wf::framebuffer_base_t& out,
         int width, int height);
 
-    /* copy the source pixels from region, storing into result
-     * returns the result geometry, in framebuffer coords */
-    wlr_box copy_region(wf::framebuffer_base_t& result,
-        const wf::framebuffer_t& source, const wf::region_t& region);
+    /* copy the source pixels from region (in framebuffer coords) to the same
+     * position in fb[0], scaled down by the degrade factor
+     * returns the copied region, in framebuffer coords */
+    wf::region_t copy_region(const wf::framebuffer_t& source,
+        const wf::region_t& region);
 
-    /* blur fb[0]
+    /* blur fb[0] in blur_region, which is in the coordinates of fb[0]
      * width and height are the scaled dimensions of the buffer
      * returns the index of the fb where the result is stored (0 or 1) */
     virtual int blur_fb0(const wf::region_t& blur_region, int width, int height) = 0;
 
+    /* blends src_tex with the blurred background in bg_tex */
+    void render_background(wf::texture_t src_tex, wlr_box src_box,
+        wlr_box scissor_box, const wf::framebuffer_t& target_fb, GLuint bg_tex);
+
   public:
     wf_blur_base(wf::output_t *output, std::string name);
     virtual ~wf_blur_base();
 
     virtual int calculate_blur_radius();
 
+    /**
+     * Blur the background of a view, for render().
+     *
+     * If the view is in a blur group, and the region was already blurred for
+     * another view in the group, the result is reused. Otherwise, the damaged
+     * region of the whole group is blurred, for the next views of the group.
+     *
+     * @param damage The region of the view to blur.
+     * @param group The blur group of the view, or nullptr.
+     */
     virtual void pre_render(wf::texture_t src_tex, wlr_box src_box,
-        const wf::region_t& damage, const wf::framebuffer_t& target_fb);
+        const wf::region_t& damage, const wf::framebuffer_t& target_fb,
+        const wf_blur_group *group = nullptr);
 
     virtual void render(wf::texture_t src_tex, wlr_box src_box,
         wlr_box scissor_box, const wf::framebuffer_t& target_fb);
+
+    /* called before a framebuffer is repainted, with its damage. The blurred
+     * region kept for the blur groups from an earlier repaint is dropped */
+    void set_shared_damage(const wf::region_t& damage);
+
+    /* moves the result of the last pre_render() to the cache, which must have
+     * blurred the whole src_box */
+    void store_result(wf_blur_cache& cache, wlr_box src_box,
+        const wf::framebuffer_t& target_fb);
+
+    /* same as render(), but with the background stored in the cache */
+    void render(wf::texture_t src_tex, wlr_box src_box, wlr_box scissor_box,
+        const wf::framebuffer_t& target_fb, const wf_blur_cache& cache);
 };
 
 std::unique_ptr<wf_blur_base> create_box_blur(wf::output_t *output);
@@ -1,5 +1,7 @@
 #include "blur.hpp"
 
+using namespace OpenGL::literals;
+
 static const char *bokeh_vertex_shader =
     R"(
 #version 100
@@ -80,17 +82,16 @@ class wf_bokeh_blur : public wf_blur_base
         OpenGL::render_begin();
         /* Upload data to shader */
         program[0].use(wf::TEXTURE_TYPE_RGBA);
-        program[0].uniform2f("halfpixel", 0.5f / width, 0.5f / height);
-        program[0].uniform1f("offset", offset);
-        program[0].uniform1i("iterations", iterations);
+        program[0].uniform2f("halfpixel"_name, 0.5f / width, 0.5f / height);
+        program[0].uniform1f("offset"_name, offset);
+        program[0].uniform1i("iterations"_name, iterations);
 
-        program[0].attrib_pointer("position", 2, 0, vertexData);
-        GL_CALL(glDisable(GL_BLEND));
+        program[0].attrib_pointer("position"_name, 2, 0, vertexData);
+        OpenGL::set_blend_state(false);
         render_iteration(blur_region, fb[0], fb[1], width, height);
 
         /* Reset gl state */
-        GL_CALL(glEnable(GL_BLEND));
-        GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+        OpenGL::set_blend_state(true);
 
         program[0].deactivate();
         GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
@@ -101,7 +102,7 @@ class wf_bokeh_blur : public wf_blur_base
 
     int calculate_blur_radius() override
     {
-        return 5 * wf_blur_base::offset_opt*wf_blur_base::degrade_opt;
+        return 5 * wf_blur_base::offset_opt * get_degrade();
     }
 };
 
@@ -1,5 +1,7 @@
 #include "blur.hpp"
 
+using namespace OpenGL::literals;
+
 static const char *gaussian_vertex_shader =
     R"(
 #version 100
@@ -91,9 +93,9 @@ class wf_gaussian_blur : public wf_blur_base
         };
 
         program[i].use(wf::TEXTURE_TYPE_RGBA);
-        program[i].uniform2f("size", width, height);
-        program[i].uniform1f("offset", offset);
-        program[i].attrib_pointer("position", 2, 0, vertexData);
+        program[i].uniform2f("size"_name, width, height);
+        program[i].uniform1f("offset"_name, offset);
+        program[i].attrib_pointer("position"_name, 2, 0, vertexData);
     }
 
     void blur(const wf::region_t& blur_region, int i, int width, int height)
@@ -107,7 +109,7 @@ class wf_gaussian_blur : public wf_blur_base
         int i, iterations = iterations_opt;
 
         OpenGL::render_begin();
-        GL_CALL(glDisable(GL_BLEND));
+        OpenGL::set_blend_state(false);
         /* Enable our shader and pass some data to it. The shader
          * does gaussian blur on the background texture in two passes,
          * one horizontal and one vertical */
@@ -124,8 +126,7 @@ class wf_gaussian_blur : public wf_blur_base
         }
 
         /* Reset gl state */
-        GL_CALL(glEnable(GL_BLEND));
-        GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+        OpenGL::set_blend_state(true);
 
         GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
         program[1].deactivate();
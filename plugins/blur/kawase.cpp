@@ -1,4 +1,7 @@
 #include "blur.hpp"
+#include <vector>
+
+using namespace OpenGL::literals;
 
 static const char *kawase_vertex_shader =
     R"(
@@ -59,6 +62,19 @@ void main()
 
 class wf_kawase_blur : public wf_blur_base
 {
+    /* The images of the downsampling passes, which keep their size between
+     * frames, so that they don't have to be reallocated. levels[i] has the
+     * size of fb[0] divided by 2^(i + 1), except the last one, which is used
+     * by the first upsampling pass */
+    std::vector<wf::framebuffer_base_t> levels;
+
+    /* the target of the downsampling pass i, which has the size of fb[0]
+     * divided by 2^i */
+    wf::framebuffer_base_t& level(int i)
+    {
+        return (i == 0) ? fb[1] : levels[i - 1];
+    }
+
   public:
     wf_kawase_blur(wf::output_t *output) :
         wf_blur_base(output, "kawase")
@@ -71,6 +87,17 @@ class wf_kawase_blur : public wf_blur_base
         OpenGL::render_end();
     }
 
+    ~wf_kawase_blur()
+    {
+        OpenGL::render_begin();
+        for (auto& level_fb : levels)
+        {
+            level_fb.release();
+        }
+
+        OpenGL::render_end();
+    }
+
     int blur_fb0(const wf::region_t& blur_region, int width, int height) override
     {
         int iterations = iterations_opt;
@@ -85,15 +112,29 @@ class wf_kawase_blur : public wf_blur_base
             -1.0f, 1.0f
         };
 
+        if (iterations <= 0)
+        {
+            return 0;
+        }
+
         OpenGL::render_begin();
+        for (size_t i = iterations; i < levels.size(); i++)
+        {
+            levels[i].release();
+        }
+
+        levels.resize(iterations);
+        /* fb[0] isn't needed after the first downsampling pass */
+        auto& spare = (iterations == 1) ? fb[0] : levels[iterations - 1];
+
         program[0].use(wf::TEXTURE_TYPE_RGBA);
 
         /* Downsample */
-        program[0].attrib_pointer("position", 2, 0, vertexData);
+        program[0].attrib_pointer("position"_name, 2, 0, vertexData);
         /* Disable blending, because we may have transparent background, which
          * we want to render on uncleared framebuffer */
-        GL_CALL(glDisable(GL_BLEND));
-        program[0].uniform1f("offset", offset);
+        OpenGL::set_blend_state(false);
+        program[0].uniform1f("offset"_name, offset);
 
         for (int i = 0; i < iterations; i++)
         {
@@ -102,18 +143,18 @@ class wf_kawase_blur : public wf_blur_base
 
             auto region = blur_region * (1.0 / (1 << i));
 
-            program[0].uniform2f("halfpixel",
+            program[0].uniform2f("halfpixel"_name,
                 0.5f / sampleWidth, 0.5f / sampleHeight);
-            render_iteration(region, fb[i % 2], fb[1 - i % 2], sampleWidth,
-                sampleHeight);
+            render_iteration(region, (i == 0) ? fb[0] : level(i - 1), level(i),
+                sampleWidth, sampleHeight);
         }
 
         program[0].deactivate();
 
         /* Upsample */
         program[1].use(wf::TEXTURE_TYPE_RGBA);
-        program[1].attrib_pointer("position", 2, 0, vertexData);
-        program[1].uniform1f("offset", offset);
+        program[1].attrib_pointer("position"_name, 2, 0, vertexData);
+        program[1].uniform1f("offset"_name, offset);
         for (int i = iterations - 1; i >= 0; i--)
         {
             sampleWidth  = width / (1 << i);
@@ -121,26 +162,33 @@ class wf_kawase_blur : public wf_blur_base
 
             auto region = blur_region * (1.0 / (1 << i));
 
-            program[1].uniform2f("halfpixel",
+            program[1].uniform2f("halfpixel"_name,
                 0.5f / sampleWidth, 0.5f / sampleHeight);
-            render_iteration(region, fb[1 - i % 2], fb[i % 2], sampleWidth,
-                sampleHeight);
+            if (i == iterations - 1)
+            {
+                render_iteration(region, level(i), spare, sampleWidth,
+                    sampleHeight);
+            } else
+            {
+                render_iteration(region,
+                    (i == iterations - 2) ? spare : level(i + 1), level(i),
+                    sampleWidth, sampleHeight);
+            }
         }
 
         /* Reset gl state */
-        GL_CALL(glEnable(GL_BLEND));
-        GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+        OpenGL::set_blend_state(true);
 
         program[1].deactivate();
         GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
         OpenGL::render_end();
 
-        return 0;
+        return (iterations == 1) ? 0 : 1;
     }
 
     int calculate_blur_radius() override
     {
-        return pow(2, iterations_opt + 1) * offset_opt * degrade_opt;
+        return pow(2, iterations_opt + 1) * offset_opt * get_degrade();
     }
 };
 
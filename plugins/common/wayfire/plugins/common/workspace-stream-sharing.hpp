@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <wayfire/nonstd/noncopyable.hpp>
 #include <wayfire/object.hpp>
 #include <wayfire/output.hpp>
@@ -68,19 +69,39 @@ class workspace_stream_pool_t : public noncopyable_t, public wf::custom_data_t
      * Update the contents of the given workspace.
      *
      * If the workspace has not been started before, it will be started.
+     *
+     * @param scale_x The horizontal size at which the workspace is displayed,
+     *   relative to the output.
+     * @param scale_y The vertical size at which the workspace is displayed,
+     *   relative to the output.
+     *
+     * The stream is rendered at the smallest power-of-two fraction of the
+     * output resolution which is at least as large as the requested scale, so
+     * that zoom animations do not cause a full repaint on every frame.
      */
-    void update(wf::point_t workspace)
+    void update(wf::point_t workspace, float scale_x = 1, float scale_y = 1)
     {
         auto& stream = get(workspace);
+        float scale  = round_scale(std::max(scale_x, scale_y));
         if (stream.running)
         {
-            output->render->workspace_stream_update(stream);
+            output->render->workspace_stream_update(stream, scale, scale);
         } else
         {
+            stream.scale_x = stream.scale_y = scale;
             output->render->workspace_stream_start(stream);
         }
     }
 
+    /**
+     * Enable or disable mipmaps for the given workspace, see
+     * workspace_stream_t::mipmaps.
+     */
+    void set_mipmaps(wf::point_t workspace, bool mipmaps)
+    {
+        get(workspace).mipmaps = mipmaps;
+    }
+
     /**
      * Stop the workspace stream.
      */
@@ -101,6 +122,21 @@ class workspace_stream_pool_t : public noncopyable_t, public wf::custom_data_t
         resize_pool(this->output->workspace->get_workspace_grid_size());
     }
 
+    /** The smallest power-of-two fraction at least as large as @scale */
+    static float round_scale(float scale)
+    {
+        /* Going lower than that is not worth the loss of quality */
+        const float min_scale = 1.0 / 8;
+
+        float rounded = 1.0;
+        while (rounded / 2 >= std::max(scale, min_scale))
+        {
+            rounded /= 2;
+        }
+
+        return rounded;
+    }
+
     void resize_pool(wf::dimensions_t size)
     {
         for (auto& column : this->streams)
@@ -105,7 +105,7 @@ class workspace_wall_t : public wf::signal_provider_t
      */
     void render_wall(const wf::framebuffer_t& fb, wf::geometry_t geometry)
     {
-        update_streams();
+        update_streams(geometry);
 
         OpenGL::render_begin(fb);
         fb.logic_scissor(geometry);
@@ -218,12 +218,22 @@ class workspace_wall_t : public wf::signal_provider_t
 
     std::vector<std::vector<glm::vec4>> render_colors;
 
-    /** Update or start visible streams */
-    void update_streams()
+    /**
+     * Update or start visible streams, at the resolution at which they are
+     * displayed when rendering the viewport to @target.
+     */
+    void update_streams(const wf::geometry_t& target)
     {
+        float scale_x = 1.0, scale_y = 1.0;
+        if ((viewport.width > 0) && (viewport.height > 0))
+        {
+            scale_x = 1.0 * target.width / viewport.width;
+            scale_y = 1.0 * target.height / viewport.height;
+        }
+
         for (auto& ws : get_visible_workspaces(viewport))
         {
-            streams->update(ws);
+            streams->update(ws, scale_x, scale_y);
         }
     }
 
@@ -47,6 +47,11 @@ class wayfire_cube : public wf::plugin_interface_t
     float identity_z_offset;
 
     OpenGL::program_t program;
+    struct
+    {
+        OpenGL::uniform_t model, vp, deform, light, ease;
+        OpenGL::attrib_t position, uv_position;
+    } handles;
 
     wf_cube_animation_attribs animation;
     wf::option_wrapper_t<bool> use_light{"cube/light"};
@@ -205,6 +210,14 @@ class wayfire_cube : public wf::plugin_interface_t
 #endif
         }
 
+        handles.model  = program.get_uniform("model");
+        handles.vp     = program.get_uniform("VP");
+        handles.deform = program.get_uniform("deform");
+        handles.light  = program.get_uniform("light");
+        handles.ease   = program.get_uniform("ease");
+        handles.position    = program.get_attrib("position");
+        handles.uv_position = program.get_attrib("uvPosition");
+
         streams = wf::workspace_stream_pool_t::ensure_pool(output);
         animation.projection = glm::perspective(45.0f, 1.f, 0.1f, 100.f);
     }
@@ -316,6 +329,7 @@ class wayfire_cube : public wf::plugin_interface_t
         for (int i = 0; i < size; i++)
         {
             streams->stop({i, cws.y});
+            streams->set_mipmaps({i, cws.y}, false);
         }
     }
 
@@ -429,13 +443,52 @@ class wayfire_cube : public wf::plugin_interface_t
         animation.view = zoom_translate * rotation * view;
     }
 
-    void update_workspace_streams()
+    void update_workspace_streams(const wf::framebuffer_t& dest)
     {
+        auto vp  = calculate_vp_matrix(dest);
         auto cws = output->workspace->get_current_workspace();
         for (int i = 0; i < get_num_faces(); i++)
         {
-            streams->update({i, cws.y});
+            int index = (cws.x + i) % get_num_faces();
+            auto size = get_projected_face_size(
+                vp * calculate_model_matrix(i, dest.transform));
+
+            /* The faces are seen in perspective, so parts of them are
+             * displayed smaller than the face itself */
+            streams->set_mipmaps({index, cws.y}, true);
+            streams->update({index, cws.y}, size.x, size.y);
+        }
+    }
+
+    /**
+     * Calculate the size of a cube face on the screen, relative to the size of
+     * the output.
+     *
+     * @param mvp The model-view-projection matrix of the face.
+     */
+    glm::vec2 get_projected_face_size(const glm::mat4& mvp)
+    {
+        static const glm::vec2 corners[] = {
+            {-0.5, 0.5}, {0.5, 0.5}, {0.5, -0.5}, {-0.5, -0.5}
+        };
+
+        glm::vec2 min{1e9, 1e9}, max{-1e9, -1e9};
+        for (auto& corner : corners)
+        {
+            auto projected = mvp * glm::vec4(corner, 0.0, 1.0);
+            if (projected.w <= 0)
+            {
+                /* Behind the camera, cannot be estimated */
+                return {1.0, 1.0};
+            }
+
+            glm::vec2 ndc = glm::vec2(projected) / projected.w;
+            min = glm::min(min, ndc);
+            max = glm::max(max, ndc);
         }
+
+        /* Normalized device coordinates span [-1, 1] across the output */
+        return glm::min((max - min) / 2.0f, glm::vec2{1.0, 1.0});
     }
 
     glm::mat4 calculate_vp_matrix(const wf::framebuffer_t& dest)
@@ -484,7 +537,7 @@ class wayfire_cube : public wf::plugin_interface_t
                 streams->get({index, cws.y}).buffer.tex));
 
             auto model = calculate_model_matrix(i, fb_transform);
-            program.uniformMatrix4f("model", model);
+            program.uniformMatrix4f(handles.model, model);
 
             if (tessellation_support)
             {
@@ -501,7 +554,7 @@ class wayfire_cube : public wf::plugin_interface_t
 
     void render(const wf::framebuffer_t& dest)
     {
-        update_workspace_streams();
+        update_workspace_streams(dest);
         if (program.get_program_id(wf::TEXTURE_TYPE_RGBA) == 0)
         {
             load_program();
@@ -535,14 +588,14 @@ class wayfire_cube : public wf::plugin_interface_t
             0.0f, 0.0f
         };
 
-        program.attrib_pointer("position", 2, 0, vertexData);
-        program.attrib_pointer("uvPosition", 2, 0, coordData);
-        program.uniformMatrix4f("VP", vp);
+        program.attrib_pointer(handles.position, 2, 0, vertexData);
+        program.attrib_pointer(handles.uv_position, 2, 0, coordData);
+        program.uniformMatrix4f(handles.vp, vp);
         if (tessellation_support)
         {
-            program.uniform1i("deform", use_deform);
-            program.uniform1i("light", use_light);
-            program.uniform1f("ease",
+            program.uniform1i(handles.deform, use_deform);
+            program.uniform1i(handles.light, use_light);
+            program.uniform1f(handles.ease,
                 animation.cube_animation.ease_deformation);
         }
 
@@ -17,9 +17,13 @@ wf_cube_background_cubemap::~wf_cube_background_cubemap()
 {
     OpenGL::render_begin();
     program.free_resources();
-    GL_CALL(glDeleteTextures(1, &tex));
-    GL_CALL(glDeleteBuffers(1, &vbo_cube_vertices));
-    GL_CALL(glDeleteBuffers(1, &ibo_cube_indices));
+    if (tex != (uint32_t)-1)
+    {
+        GL_CALL(glDeleteTextures(1, &tex));
+        GL_CALL(glDeleteBuffers(1, &vbo_cube_vertices));
+        GL_CALL(glDeleteBuffers(1, &ibo_cube_indices));
+    }
+
     OpenGL::render_end();
 }
 
@@ -28,6 +32,8 @@ void wf_cube_background_cubemap::create_program()
     OpenGL::render_begin();
     program.set_simple(
         OpenGL::compile_program(cubemap_vertex, cubemap_fragment));
+    cubemap_matrix_uniform = program.get_uniform("cubeMapMatrix");
+    position_attrib = program.get_attrib("position");
     OpenGL::render_end();
 }
 
@@ -40,6 +46,23 @@ void wf_cube_background_cubemap::reload_texture()
 
     last_background_image = background_image;
 
+    /* Decode the image on a worker thread. The old texture is used until the
+     * new one is uploaded. */
+    auto image = std::make_shared<image_io::image_t>();
+    std::string path = last_background_image;
+    load_task = wf::get_core().scheduler->submit([=] ()
+    {
+        image_io::decode_file(path, *image);
+    }, [=] ()
+    {
+        /* Logs the decoding error, if any */
+        upload_texture(path, image.get());
+    });
+}
+
+void wf_cube_background_cubemap::upload_texture(const std::string& path,
+    const image_io::image_t *image)
+{
     OpenGL::render_begin();
     if (tex == (uint32_t)-1)
     {
@@ -49,10 +72,9 @@ void wf_cube_background_cubemap::reload_texture()
     }
 
     GL_CALL(glBindTexture(GL_TEXTURE_CUBE_MAP, tex));
-    if (!image_io::load_from_file(last_background_image, GL_TEXTURE_CUBE_MAP))
+    if (!image || !image_io::upload_to_texture(*image, GL_TEXTURE_CUBE_MAP))
     {
-        LOGE("Failed to load cubemap background image from \"%s\".",
-            last_background_image.c_str());
+        LOGE("Failed to load cubemap background image from \"", path, "\".");
 
         GL_CALL(glDeleteTextures(1, &tex));
         GL_CALL(glDeleteBuffers(1, &vbo_cube_vertices));
@@ -86,7 +108,15 @@ void wf_cube_background_cubemap::render_frame(const wf::framebuffer_t& fb,
     OpenGL::render_begin(fb);
     if (tex == (uint32_t)-1)
     {
-        GL_CALL(glClearColor(TEX_ERROR_FLAG_COLOR));
+        /* Only flag the error once the image has failed to load */
+        if (load_task.pending())
+        {
+            GL_CALL(glClearColor(0, 0, 0, 1));
+        } else
+        {
+            GL_CALL(glClearColor(TEX_ERROR_FLAG_COLOR));
+        }
+
         GL_CALL(glClear(GL_COLOR_BUFFER_BIT));
         OpenGL::render_end();
 
@@ -131,10 +161,7 @@ void wf_cube_background_cubemap::render_frame(const wf::framebuffer_t& fb,
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cube_indices), cube_indices,
         GL_STATIC_DRAW);
 
-    GLint vertex = glGetAttribLocation(program.get_program_id(
-        wf::TEXTURE_TYPE_RGBA), "position");
-    glEnableVertexAttribArray(vertex);
-    glVertexAttribPointer(vertex, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    program.attrib_pointer(position_attrib, 3, 0, nullptr);
 
     auto model = glm::rotate(glm::mat4(1.0),
         float(attribs.cube_animation.rotation),
@@ -148,7 +175,7 @@ void wf_cube_background_cubemap::render_frame(const wf::framebuffer_t& fb,
     auto vp   = fb.transform * attribs.projection * view;
 
     model = vp * model;
-    program.uniformMatrix4f("cubeMapMatrix", model);
+    program.uniformMatrix4f(cubemap_matrix_uniform, model);
 
     glDrawElements(GL_TRIANGLES, 12 * 3, GL_UNSIGNED_SHORT, 0);
 
@@ -2,6 +2,8 @@
 #define WF_CUBE_CUBEMAP_HPP
 
 #include "cube-background.hpp"
+#include <wayfire/img.hpp>
+#include <wayfire/task-scheduler.hpp>
 
 class wf_cube_background_cubemap : public wf_cube_background_base
 {
@@ -14,14 +16,18 @@ class wf_cube_background_cubemap : public wf_cube_background_base
 
   private:
     void reload_texture();
+    void upload_texture(const std::string& path, const image_io::image_t *image);
     void create_program();
 
     OpenGL::program_t program;
+    OpenGL::uniform_t cubemap_matrix_uniform;
+    OpenGL::attrib_t position_attrib;
     GLuint tex = -1;
     GLuint vbo_cube_vertices;
     GLuint ibo_cube_indices;
 
     std::string last_background_image;
+    wf::task_handle_t load_task;
     wf::option_wrapper_t<std::string> background_image{"cube/cubemap_image"};
 };
 
@@ -30,6 +30,10 @@ void wf_cube_background_skydome::load_program()
 {
     OpenGL::render_begin();
     program.set_simple(OpenGL::compile_program(cube_vertex_2_0, cube_fragment_2_0));
+    vp_uniform    = program.get_uniform("VP");
+    model_uniform = program.get_uniform("model");
+    position_attrib    = program.get_attrib("position");
+    uv_position_attrib = program.get_attrib("uvPosition");
     OpenGL::render_end();
 }
 
@@ -41,6 +45,24 @@ void wf_cube_background_skydome::reload_texture()
     }
 
     last_background_image = background_image;
+
+    /* Decode the image on a worker thread, and upload it at the start of the
+     * next frame. The old texture is used until then. */
+    auto image = std::make_shared<image_io::image_t>();
+    std::string path = last_background_image;
+    load_task = wf::get_core().scheduler->submit_for_frame(output, [=] ()
+    {
+        image_io::decode_file(path, *image);
+    }, [=] ()
+    {
+        /* Logs the decoding error, if any */
+        upload_texture(path, image.get());
+    });
+}
+
+void wf_cube_background_skydome::upload_texture(const std::string& path,
+    const image_io::image_t *image)
+{
     OpenGL::render_begin();
 
     if (tex == (uint32_t)-1)
@@ -50,7 +72,7 @@ void wf_cube_background_skydome::reload_texture()
 
     GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
 
-    if (image_io::load_from_file(last_background_image, GL_TEXTURE_2D))
+    if (image && image_io::upload_to_texture(*image, GL_TEXTURE_2D))
     {
         GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
         GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
@@ -58,8 +80,7 @@ void wf_cube_background_skydome::reload_texture()
         GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
     } else
     {
-        LOGE("Failed to load skydome image from \"%s\".",
-            last_background_image.c_str());
+        LOGE("Failed to load skydome image from \"", path, "\".");
         GL_CALL(glDeleteTextures(1, &tex));
         tex = -1;
     }
@@ -132,7 +153,15 @@ void wf_cube_background_skydome::render_frame(const wf::framebuffer_t& fb,
 
     if (tex == (uint32_t)-1)
     {
-        GL_CALL(glClearColor(TEX_ERROR_FLAG_COLOR));
+        /* Only flag the error once the image has failed to load */
+        if (load_task.pending())
+        {
+            GL_CALL(glClearColor(0, 0, 0, 1));
+        } else
+        {
+            GL_CALL(glClearColor(TEX_ERROR_FLAG_COLOR));
+        }
+
         GL_CALL(glClear(GL_COLOR_BUFFER_BIT));
 
         return;
@@ -150,17 +179,17 @@ void wf_cube_background_skydome::render_frame(const wf::framebuffer_t& fb,
         glm::vec3(0., 1., 0.));
 
     auto vp = fb.transform * attribs.projection * view * rotation;
-    program.uniformMatrix4f("VP", vp);
+    program.uniformMatrix4f(vp_uniform, vp);
 
-    program.attrib_pointer("position", 3, 0, vertices.data());
-    program.attrib_pointer("uvPosition", 2, 0, coords.data());
+    program.attrib_pointer(position_attrib, 3, 0, vertices.data());
+    program.attrib_pointer(uv_position_attrib, 2, 0, coords.data());
 
     auto cws   = output->workspace->get_current_workspace();
     auto model = glm::rotate(glm::mat4(1.0),
         float(attribs.cube_animation.rotation) - cws.x * attribs.side_angle,
         glm::vec3(0, 1, 0));
 
-    program.uniformMatrix4f("model", model);
+    program.uniformMatrix4f(model_uniform, model);
 
     GL_CALL(glActiveTexture(GL_TEXTURE0));
     GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
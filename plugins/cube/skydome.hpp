@@ -3,6 +3,8 @@
 
 #include "cube-background.hpp"
 #include "wayfire/output.hpp"
+#include <wayfire/img.hpp>
+#include <wayfire/task-scheduler.hpp>
 #include <vector>
 
 class wf_cube_background_skydome : public wf_cube_background_base
@@ -20,8 +22,11 @@ class wf_cube_background_skydome : public wf_cube_background_base
     void load_program();
     void fill_vertices();
     void reload_texture();
+    void upload_texture(const std::string& path, const image_io::image_t *image);
 
     OpenGL::program_t program;
+    OpenGL::uniform_t vp_uniform, model_uniform;
+    OpenGL::attrib_t position_attrib, uv_position_attrib;
     GLuint tex = -1;
 
     std::vector<GLfloat> vertices;
@@ -29,6 +34,7 @@ class wf_cube_background_skydome : public wf_cube_background_base
     std::vector<GLuint> indices;
 
     std::string last_background_image;
+    wf::task_handle_t load_task;
     int last_mirror = -1;
     wf::option_wrapper_t<std::string> background_image{"cube/skydome_texture"};
     wf::option_wrapper_t<bool> mirror_opt{"cube/skydome_mirror"};
@@ -253,6 +253,9 @@ class simple_decoration_surface : public wf::surface_interface_t,
                 theme.get_title_height() + theme.get_border_size();
             this->cached_region = layout.calculate_region();
         }
+
+        /* The offset of the decoration depends on its size */
+        invalidate_surface_tree();
     }
 };
 
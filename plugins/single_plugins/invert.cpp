@@ -120,9 +120,9 @@ class wayfire_invert_screen : public wf::plugin_interface_t
         program.attrib_pointer("uvPosition", 2, 0, coordData);
         program.uniform1i("preserve_hue", preserve_hue);
 
-        GL_CALL(glDisable(GL_BLEND));
+        OpenGL::set_blend_state(false);
         GL_CALL(glDrawArrays(GL_TRIANGLE_FAN, 0, 4));
-        GL_CALL(glEnable(GL_BLEND));
+        OpenGL::set_blend_state(true);
         GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
 
         program.deactivate();
@@ -37,48 +37,64 @@
 
 #include "wobbly.h"
 
-#define GRID_WIDTH  4
-#define GRID_HEIGHT 4
+/*
+ * The objects of all models in a world are stored together, one array per
+ * field, so that stepping all of them is a few passes over contiguous
+ * memory which the compiler can vectorize.
+ */
+enum
+{
+    POSITION_X,
+    POSITION_Y,
+    VELOCITY_X,
+    VELOCITY_Y,
+    FORCE_X,
+    FORCE_Y,
+    /* 1 for objects which move, 0 for immobile ones */
+    MOBILE,
+    /* 1 for objects of the models which run the current step, 0 otherwise */
+    ACTIVE,
+    /* The sums of the velocity and force of each object over a world step */
+    VELOCITY_SUM,
+    FORCE_SUM,
+    NUM_FIELDS
+};
+
+struct wobbly_world
+{
+    float *fields[NUM_FIELDS];
+    int numObjects;
+    int capacity;
 
-#define MODEL_MAX_SPRINGS (GRID_WIDTH * GRID_HEIGHT * 2)
+    struct wobbly_surface **surfaces;
+    int numSurfaces;
+    int surfaceCapacity;
+};
 
 typedef struct _xy_pair {
     float x, y;
 } Point, Vector;
 
-typedef struct _Edge {
-    float next, prev;
-
-    float start;
-    float end;
-
-    float attract;
-    float velocity;
-} Edge;
-
-typedef struct _Object {
-    Vector	 force;
-    Point	 position;
-    Vector	 velocity;
-    float	 theta;
-    int		 immobile;
-    Edge	 vertEdge;
-    Edge	 horzEdge;
-} Object;
-
-typedef struct _Spring {
-    Object *a;
-    Object *b;
-    Vector offset;
-} Spring;
-
+/*
+ * A grid of objects, each connected with springs to its horizontal and
+ * vertical neighbours. All horizontal springs have the same rest length,
+ * and so do the vertical ones, so the springs are not stored.
+ *
+ * The objects are at [offset, offset + numObjects) in the arrays of the
+ * world of the model.
+ */
 typedef struct _Model {
-    Object	 *objects;
+    struct wobbly_world *world;
+    int		 offset;
     int		 numObjects;
-    Spring	 springs[MODEL_MAX_SPRINGS];
-    int		 numSprings;
-    Object	 *anchorObject;
+    int		 gridWidth;
+    int		 gridHeight;
+    float	 hpad, vpad;
+    /* The index of the anchor object, or -1 */
+    int		 anchor;
     float	 steps;
+    /* The number of steps to run in the current world step */
+    int		 pendingSteps;
     Point	 topLeft;
     Point	 bottomRight;
 } Model;
@@ -97,37 +113,162 @@ typedef struct _WobblyWindow {
 #define WobblyForce    (1L << 1)
 #define WobblyVelocity (1L << 2)
 
-static void objectInit(Object *object, float positionX, float positionY,
+#if defined(__clang__)
+  #define WOBBLY_VECTORIZE _Pragma("clang loop vectorize(assume_safety)")
+#elif defined(__GNUC__)
+  #define WOBBLY_VECTORIZE _Pragma("GCC ivdep")
+#else
+  #define WOBBLY_VECTORIZE
+#endif
+
+struct wobbly_world *wobbly_world_create(void)
+{
+    return calloc(1, sizeof(struct wobbly_world));
+}
+
+void wobbly_world_destroy(struct wobbly_world *world)
+{
+    int i;
+
+    for (i = 0; i < NUM_FIELDS; i++)
+        free(world->fields[i]);
+
+    free(world->surfaces);
+    free(world);
+}
+
+static int worldReserve(struct wobbly_world *world, int numObjects)
+{
+    int i, capacity;
+    float *field;
+
+    if (numObjects <= world->capacity)
+        return 1;
+
+    capacity = world->capacity * 2;
+    if (capacity < numObjects)
+        capacity = numObjects;
+    if (capacity < 64)
+        capacity = 64;
+
+    for (i = 0; i < NUM_FIELDS; i++)
+    {
+        field = realloc(world->fields[i], sizeof(float) * capacity);
+        if (!field)
+            return 0;
+
+        world->fields[i] = field;
+    }
+
+    world->capacity = capacity;
+    return 1;
+}
+
+/* Add space for the objects of the surface's model at the end of the world.
+ * Returns the offset of the objects, or -1 on failure. */
+static int worldAddSurface(struct wobbly_world *world,
+        struct wobbly_surface *surface, int numObjects)
+{
+    struct wobbly_surface **surfaces;
+    int offset;
+
+    if (!worldReserve(world, world->numObjects + numObjects))
+        return -1;
+
+    if (world->numSurfaces == world->surfaceCapacity)
+    {
+        int capacity = world->surfaceCapacity ? world->surfaceCapacity * 2 : 16;
+        surfaces = realloc(world->surfaces,
+                sizeof(struct wobbly_surface*) * capacity);
+        if (!surfaces)
+            return -1;
+
+        world->surfaces = surfaces;
+        world->surfaceCapacity = capacity;
+    }
+
+    offset = world->numObjects;
+    world->numObjects += numObjects;
+    world->surfaces[world->numSurfaces++] = surface;
+
+    return offset;
+}
+
+/* Remove the objects of the surface's model, moving the following models
+ * down so that the objects stay contiguous */
+static void worldRemoveSurface(struct wobbly_world *world,
+        struct wobbly_surface *surface)
+{
+    Model *model = ((WobblyWindow*)surface->ww)->model;
+    int i, index = -1;
+    int tail = world->numObjects - model->offset - model->numObjects;
+
+    for (i = 0; i < world->numSurfaces; i++)
+    {
+        if (world->surfaces[i] == surface)
+            index = i;
+    }
+
+    if (index < 0)
+        return;
+
+    for (i = 0; i < NUM_FIELDS; i++)
+    {
+        memmove(world->fields[i] + model->offset,
+                world->fields[i] + model->offset + model->numObjects,
+                sizeof(float) * tail);
+    }
+
+    for (i = index + 1; i < world->numSurfaces; i++)
+    {
+        ((WobblyWindow*)world->surfaces[i]->ww)->model->offset -=
+            model->numObjects;
+    }
+
+    memmove(world->surfaces + index, world->surfaces + index + 1,
+            sizeof(struct wobbly_surface*) * (world->numSurfaces - index - 1));
+
+    world->numSurfaces--;
+    world->numObjects -= model->numObjects;
+}
+
+/* The objects' values of the given field. Invalidated when the world
+ * changes. */
+static float *modelField(Model *model, int field)
+{
+    return model->world->fields[field] + model->offset;
+}
+
+static void objectInit(Model *model, int i, float positionX, float positionY,
         float velocityX, float velocityY)
 {
-    object->force.x = 0;
-    object->force.y = 0;
+    modelField(model, FORCE_X)[i] = 0;
+    modelField(model, FORCE_Y)[i] = 0;
 
-    object->position.x = positionX;
-    object->position.y = positionY;
+    modelField(model, POSITION_X)[i] = positionX;
+    modelField(model, POSITION_Y)[i] = positionY;
 
-    object->velocity.x = velocityX;
-    object->velocity.y = velocityY;
+    modelField(model, VELOCITY_X)[i] = velocityX;
+    modelField(model, VELOCITY_Y)[i] = velocityY;
 
-    object->theta    = 0;
-    object->immobile = 0;
+    modelField(model, MOBILE)[i] = 1;
+}
 
-    object->vertEdge.next = 0.0f;
-    object->horzEdge.next = 0.0f;
+static void objectSetImmobile(Model *model, int i, int immobile)
+{
+    modelField(model, MOBILE)[i] = immobile ? 0 : 1;
 }
 
-static void springInit(Spring *spring, Object *a, Object *b,
-	    float offsetX, float offsetY)
+static int objectIsImmobile(Model *model, int i)
 {
-    spring->a	     = a;
-    spring->b	     = b;
-    spring->offset.x = offsetX;
-    spring->offset.y = offsetY;
+    return modelField(model, MOBILE)[i] == 0;
 }
 
 static void modelCalcBounds(Model *model)
 {
     int i;
+    float *px = modelField(model, POSITION_X);
+    float *py = modelField(model, POSITION_Y);
 
     model->topLeft.x	 = SHRT_MAX;
     model->topLeft.y	 = SHRT_MAX;
@@ -136,63 +277,51 @@ static void modelCalcBounds(Model *model)
 
     for (i = 0; i < model->numObjects; i++)
     {
-        if (model->objects[i].position.x < model->topLeft.x)
-            model->topLeft.x = model->objects[i].position.x;
-        else if (model->objects[i].position.x > model->bottomRight.x)
-            model->bottomRight.x = model->objects[i].position.x;
-
-        if (model->objects[i].position.y < model->topLeft.y)
-            model->topLeft.y = model->objects[i].position.y;
-        else if (model->objects[i].position.y > model->bottomRight.y)
-            model->bottomRight.y = model->objects[i].position.y;
+        if (px[i] < model->topLeft.x)
+            model->topLeft.x = px[i];
+        if (px[i] > model->bottomRight.x)
+            model->bottomRight.x = px[i];
+
+        if (py[i] < model->topLeft.y)
+            model->topLeft.y = py[i];
+        if (py[i] > model->bottomRight.y)
+            model->bottomRight.y = py[i];
     }
 }
 
-static void modelAddSpring(Model *model, Object *a, Object *b,
-		float offsetX, float offsetY)
+static void modelSetAnchor(Model *model, int anchor, float x, float y)
 {
-    Spring *spring;
+    if (model->anchor >= 0)
+        objectSetImmobile(model, model->anchor, 0);
 
-    spring = &model->springs[model->numSprings];
-    model->numSprings++;
+    model->anchor = anchor;
+    modelField(model, POSITION_X)[anchor] = x;
+    modelField(model, POSITION_Y)[anchor] = y;
 
-    springInit (spring, a, b, offsetX, offsetY);
+    objectSetImmobile(model, anchor, 1);
 }
 
 static void modelSetMiddleAnchor(Model *model, int x, int y,
         int width, int height)
 {
+    int gw = model->gridWidth, gh = model->gridHeight;
     float gx, gy;
 
-    gx = ((GRID_WIDTH  - 1) / 2 * width)  / (float) (GRID_WIDTH  - 1);
-    gy = ((GRID_HEIGHT - 1) / 2 * height) / (float) (GRID_HEIGHT - 1);
-
-    if (model->anchorObject)
-        model->anchorObject->immobile = 0;
+    gx = ((gw - 1) / 2 * width)  / (float) (gw - 1);
+    gy = ((gh - 1) / 2 * height) / (float) (gh - 1);
 
-    model->anchorObject =
-        &model->objects[GRID_WIDTH * ((GRID_HEIGHT-1)/2) + (GRID_WIDTH-1)/ 2];
-    model->anchorObject->position.x = x + gx;
-    model->anchorObject->position.y = y + gy;
-
-    model->anchorObject->immobile = 1;
+    modelSetAnchor(model, gw * ((gh - 1) / 2) + (gw - 1) / 2, x + gx, y + gy);
 }
 
 static void modelSetTopAnchor(Model *model, int x, int y,
         int width)
 {
+    int gw = model->gridWidth;
     float gx;
 
-    gx = ((GRID_WIDTH  - 1) / 2 * width)  / (float) (GRID_WIDTH  - 1);
-
-    if (model->anchorObject)
-	model->anchorObject->immobile = 0;
+    gx = ((gw - 1) / 2 * width)  / (float) (gw - 1);
 
-    model->anchorObject = &model->objects[(GRID_WIDTH-1)/ 2];
-    model->anchorObject->position.x = x + gx;
-    model->anchorObject->position.y = y;
-
-    model->anchorObject->immobile = 1;
+    modelSetAnchor(model, (gw - 1) / 2, x + gx, y);
 }
 
 static void modelInitObjects(Model *model, int x, int y, int width, int height)
@@ -200,14 +329,14 @@ static void modelInitObjects(Model *model, int x, int y, int width, int height)
     int	  gridX, gridY, i = 0;
     float gw, gh;
 
-    gw = GRID_WIDTH  - 1;
-    gh = GRID_HEIGHT - 1;
+    gw = model->gridWidth  - 1;
+    gh = model->gridHeight - 1;
 
-    for (gridY = 0; gridY < GRID_HEIGHT; gridY++)
+    for (gridY = 0; gridY < model->gridHeight; gridY++)
     {
-        for (gridX = 0; gridX < GRID_WIDTH; gridX++)
+        for (gridX = 0; gridX < model->gridWidth; gridX++)
         {
-            objectInit (&model->objects[i],
+            objectInit (model, i,
                     x + (gridX * width) / gw,
                     y + (gridY * height) / gh,
                     0, 0);
@@ -215,42 +344,27 @@ static void modelInitObjects(Model *model, int x, int y, int width, int height)
         }
     }
 
-    if (!model->anchorObject)
+    if (model->anchor < 0)
         modelSetMiddleAnchor (model, x, y, width, height);
 }
 
 static void modelInitSprings(Model *model, int width, int height)
 {
-    int   gridX, gridY, i = 0;
-    float hpad, vpad;
-
-    model->numSprings = 0;
-
-    hpad = ((float) width) / (GRID_WIDTH  - 1);
-    vpad = ((float) height) / (GRID_HEIGHT - 1);
-
-    for (gridY = 0; gridY < GRID_HEIGHT; gridY++)
-    {
-        for (gridX = 0; gridX < GRID_WIDTH; gridX++)
-        {
-            if (gridX > 0)
-            {
-                modelAddSpring (model, &model->objects[i - 1],
-                        &model->objects[i], hpad, 0);
-            }
+    model->hpad = ((float) width) / (model->gridWidth  - 1);
+    model->vpad = ((float) height) / (model->gridHeight - 1);
+}
 
-            if (gridY > 0)
-            {
-                modelAddSpring (model, &model->objects[i - GRID_WIDTH],
-                        &model->objects[i], 0, vpad);
-            }
+static int clampGridSize(int size)
+{
+    if (size < 2)
+        return 2;
+    if (size > WOBBLY_MAX_GRID_SIZE)
+        return WOBBLY_MAX_GRID_SIZE;
 
-            i++;
-        }
-    }
+    return size;
 }
 
-static Model * createModel(int x, int y, int width, int height)
+static Model * createModel(struct wobbly_surface *surface)
 {
     Model *model;
 
@@ -258,150 +372,235 @@ static Model * createModel(int x, int y, int width, int height)
     if (!model)
         return 0;
 
-    model->numObjects = GRID_WIDTH * GRID_HEIGHT;
-    model->objects = malloc (sizeof (Object) * model->numObjects);
-    if (!model->objects)
+    model->gridWidth  = clampGridSize(surface->grid_width);
+    model->gridHeight = clampGridSize(surface->grid_height);
+    model->numObjects = model->gridWidth * model->gridHeight;
+    model->world  = surface->world;
+    model->offset = worldAddSurface(model->world, surface, model->numObjects);
+    if (model->offset < 0)
     {
         free (model);
         return 0;
     }
 
-    model->anchorObject = 0;
-    model->numSprings = 0;
+    model->anchor = -1;
     model->steps = 0;
+    model->pendingSteps = 0;
 
-    modelInitObjects (model, x, y, width, height);
-    modelInitSprings (model, width, height);
+    modelInitObjects (model, surface->x, surface->y,
+            surface->width, surface->height);
+    modelInitSprings (model, surface->width, surface->height);
     modelCalcBounds (model);
 
     return model;
 }
 
-static void objectApplyForce(Object *object, float fx, float fy)
-{
-    object->force.x += fx;
-    object->force.y += fy;
-}
-
-static void springExertForces(Spring *spring, float k)
+/*
+ * Add the forces of all springs of the model to its objects.
+ *
+ * Each spring pulls its two objects towards each other with the same force,
+ * so instead of walking a list of springs, the extension of the springs is
+ * computed along the rows and columns of the grid, in loops which don't
+ * depend on each other.
+ */
+static void modelExertForces(Model *model, float k)
 {
-    Vector da, db;
-    Vector a, b;
+    int i, x, y;
+    int gw = model->gridWidth, n = model->numObjects;
+    float hk = 0.5f * k, hpad = model->hpad, vpad = model->vpad;
+    float *px = modelField(model, POSITION_X);
+    float *py = modelField(model, POSITION_Y);
+    float *fx = modelField(model, FORCE_X);
+    float *fy = modelField(model, FORCE_Y);
+
+    /* Horizontal springs, pulling each object towards its right and left
+     * neighbours */
+    for (y = 0; y < model->gridHeight; y++)
+    {
+        float *rpx = px + y * gw, *rpy = py + y * gw;
+        float *rfx = fx + y * gw, *rfy = fy + y * gw;
 
-    a = spring->a->position;
-    b = spring->b->position;
+        WOBBLY_VECTORIZE
+        for (x = 0; x < gw - 1; x++)
+        {
+            rfx[x] += hk * (rpx[x + 1] - rpx[x] - hpad);
+            rfy[x] += hk * (rpy[x + 1] - rpy[x]);
+        }
 
-    da.x = 0.5f * (b.x - a.x - spring->offset.x);
-    da.y = 0.5f * (b.y - a.y - spring->offset.y);
+        WOBBLY_VECTORIZE
+        for (x = 1; x < gw; x++)
+        {
+            rfx[x] -= hk * (rpx[x] - rpx[x - 1] - hpad);
+            rfy[x] -= hk * (rpy[x] - rpy[x - 1]);
+        }
+    }
 
-    db.x = 0.5f * (a.x - b.x + spring->offset.x);
-    db.y = 0.5f * (a.y - b.y + spring->offset.y);
+    /* Vertical springs, pulling each object towards the objects below and
+     * above it */
+    WOBBLY_VECTORIZE
+    for (i = 0; i < n - gw; i++)
+    {
+        fx[i] += hk * (px[i + gw] - px[i]);
+        fy[i] += hk * (py[i + gw] - py[i] - vpad);
+    }
 
-    objectApplyForce (spring->a, k * da.x, k * da.y);
-    objectApplyForce (spring->b, k * db.x, k * db.y);
+    WOBBLY_VECTORIZE
+    for (i = gw; i < n; i++)
+    {
+        fx[i] -= hk * (px[i] - px[i - gw]);
+        fy[i] -= hk * (py[i] - py[i - gw] - vpad);
+    }
 }
 
-static float modelStepObject(Object *object, float friction, float *force)
+/*
+ * Move all objects of the world according to their forces, and reset the
+ * forces. Objects of inactive models are left as they are, and immobile
+ * objects of active models are stopped.
+ */
+static void worldStepObjects(struct wobbly_world *world, float friction)
 {
-    object->theta += 0.05f;
-
-    if (object->immobile)
+    int i, n = world->numObjects;
+    float *px = world->fields[POSITION_X], *py = world->fields[POSITION_Y];
+    float *vx = world->fields[VELOCITY_X], *vy = world->fields[VELOCITY_Y];
+    float *fx = world->fields[FORCE_X], *fy = world->fields[FORCE_Y];
+    float *mobile = world->fields[MOBILE], *active = world->fields[ACTIVE];
+    float *velocitySum = world->fields[VELOCITY_SUM];
+    float *forceSum = world->fields[FORCE_SUM];
+    const float mass = WOBBLY_MASS;
+
+    WOBBLY_VECTORIZE
+    for (i = 0; i < n; i++)
     {
-        object->velocity.x = 0.0f;
-        object->velocity.y = 0.0f;
-        object->force.x = 0.0f;
-        object->force.y = 0.0f;
+        float move = mobile[i] * active[i];
+        float keep = 1.0f - active[i];
 
-        *force = 0.0f;
-        return 0.0f;
-    }
-    else
-    {
-        object->force.x -= friction * object->velocity.x;
-        object->force.y -= friction * object->velocity.y;
+        float forceX = fx[i] - friction * vx[i];
+        float forceY = fy[i] - friction * vy[i];
+        float velocityX = vx[i] + forceX / mass;
+        float velocityY = vy[i] + forceY / mass;
+
+        vx[i] = move * velocityX + keep * vx[i];
+        vy[i] = move * velocityY + keep * vy[i];
+        px[i] += move * velocityX;
+        py[i] += move * velocityY;
 
-        object->velocity.x += object->force.x / WOBBLY_MASS;
-        object->velocity.y += object->force.y / WOBBLY_MASS;
+        velocitySum[i] += move * (fabsf(velocityX) + fabsf(velocityY));
+        forceSum[i] += move * (fabsf(forceX) + fabsf(forceY));
 
-        object->position.x += object->velocity.x;
-        object->position.y += object->velocity.y;
+        fx[i] = 0.0f;
+        fy[i] = 0.0f;
+    }
+}
 
-        *force = fabs(object->force.x) + fabs(object->force.y);
+static float modelSum(Model *model, int field)
+{
+    float *values = modelField(model, field);
+    float sum = 0.0f;
+    int i;
 
-        object->force.x = 0.0f;
-        object->force.y = 0.0f;
+    for (i = 0; i < model->numObjects; i++)
+        sum += values[i];
 
-        return fabs(object->velocity.x) + fabs(object->velocity.y);
-    }
+    return sum;
 }
 
-static int modelStep(Model *model, float friction, float k, float time)
+void wobbly_world_step(struct wobbly_world *world, int msSinceLastPaint)
 {
-    int   i, j, steps, wobbly = 0;
-    float velocitySum = 0.0f;
-    float force, forceSum = 0.0f;
+    float friction, springK;
+    int   i, j, step, maxSteps = 0;
 
-    model->steps += time / 15.0f;
-    steps = floor (model->steps);
-    model->steps -= steps;
+    if (!world->numSurfaces)
+        return;
 
-    if (!steps)
-        return 1;
+    friction = wobbly_settings_get_friction();
+    springK  = wobbly_settings_get_spring_k();
 
-    for (j = 0; j < steps; j++)
+    for (i = 0; i < world->numSurfaces; i++)
     {
-        for (i = 0; i < model->numSprings; i++)
-            springExertForces (&model->springs[i], k);
+        WobblyWindow *ww = world->surfaces[i]->ww;
+        Model *model = ww->model;
 
-        for (i = 0; i < model->numObjects; i++)
+        model->pendingSteps = 0;
+        if (ww->wobbly & (WobblyInitial | WobblyVelocity | WobblyForce))
         {
-            velocitySum += modelStepObject(&model->objects[i], friction, &force);
-            forceSum += force;
+            float time = (ww->wobbly & WobblyVelocity) ? msSinceLastPaint : 16;
+
+            model->steps += time / 15.0f;
+            model->pendingSteps = floor (model->steps);
+            model->steps -= model->pendingSteps;
+
+            if (model->pendingSteps > maxSteps)
+                maxSteps = model->pendingSteps;
         }
     }
 
-    modelCalcBounds (model);
+    memset(world->fields[VELOCITY_SUM], 0, sizeof(float) * world->numObjects);
+    memset(world->fields[FORCE_SUM], 0, sizeof(float) * world->numObjects);
 
-    if (velocitySum > 0.5f)
-        wobbly |= WobblyVelocity;
-    if (forceSum > 20.0f)
-        wobbly |= WobblyForce;
+    for (step = 0; step < maxSteps; step++)
+    {
+        for (i = 0; i < world->numSurfaces; i++)
+        {
+            Model *model = ((WobblyWindow*)world->surfaces[i]->ww)->model;
+            float *active = modelField(model, ACTIVE);
+            float isActive = (step < model->pendingSteps) ? 1.0f : 0.0f;
 
-    return wobbly;
-}
+            for (j = 0; j < model->numObjects; j++)
+                active[j] = isActive;
 
-static void bezierPatchEvaluate (Model *model, float u, float v,
-        float *patchX, float *patchY)
-{
-    float coeffsU[4], coeffsV[4];
-    float x, y;
-    int   i, j;
+            if (isActive)
+                modelExertForces(model, springK);
+        }
 
-    coeffsU[0] = (1 - u) * (1 - u) * (1 - u);
-    coeffsU[1] = 3 * u * (1 - u) * (1 - u);
-    coeffsU[2] = 3 * u * u * (1 - u);
-    coeffsU[3] = u * u * u;
+        worldStepObjects(world, friction);
+    }
 
-    coeffsV[0] = (1 - v) * (1 - v) * (1 - v);
-    coeffsV[1] = 3 * v * (1 - v) * (1 - v);
-    coeffsV[2] = 3 * v * v * (1 - v);
-    coeffsV[3] = v * v * v;
+    for (i = 0; i < world->numSurfaces; i++)
+    {
+        struct wobbly_surface *surface = world->surfaces[i];
+        WobblyWindow *ww = surface->ww;
+        Model *model = ww->model;
 
-    x = y = 0.0f;
+        if (!(ww->wobbly & (WobblyInitial | WobblyVelocity | WobblyForce)))
+            continue;
 
-    for (i = 0; i < 4; i++)
-    {
-        for (j = 0; j < 4; j++)
+        if (!model->pendingSteps)
+        {
+            ww->wobbly = WobblyInitial;
+        } else
+        {
+            ww->wobbly = 0;
+            if (modelSum(model, VELOCITY_SUM) > 0.5f)
+                ww->wobbly |= WobblyVelocity;
+            if (modelSum(model, FORCE_SUM) > 20.0f)
+                ww->wobbly |= WobblyForce;
+        }
+
+        modelCalcBounds(model);
+        if (!ww->wobbly)
         {
-            x += coeffsU[i] * coeffsV[j] *
-                model->objects[j * GRID_WIDTH + i].position.x;
-            y += coeffsU[i] * coeffsV[j] *
-                model->objects[j * GRID_HEIGHT + i].position.y;
+            surface->x = model->topLeft.x;
+            surface->y = model->topLeft.y;
+            surface->synced = 1;
         }
     }
+}
+
+/* The Bernstein polynomials of the given degree at t, which are the weights
+ * of the control points of a Bezier curve */
+static void bernsteinCoefficients(int degree, float t, float *coeffs)
+{
+    int d, i;
 
-    *patchX = x;
-    *patchY = y;
+    coeffs[0] = 1.0f;
+    for (d = 1; d <= degree; d++)
+    {
+        coeffs[d] = t * coeffs[d - 1];
+        for (i = d - 1; i > 0; i--)
+            coeffs[i] = (1 - t) * coeffs[i] + t * coeffs[i - 1];
+
+        coeffs[0] *= (1 - t);
+    }
 }
 
 static int wobblyEnsureModel(struct wobbly_surface *surface)
@@ -410,8 +609,7 @@ static int wobblyEnsureModel(struct wobbly_surface *surface)
 
     if (!ww->model)
     {
-        ww->model = createModel(surface->x, surface->y,
-                surface->width, surface->height);
+        ww->model = createModel(surface);
         if (!ww->model)
             return 0;
     }
@@ -419,123 +617,89 @@ static int wobblyEnsureModel(struct wobbly_surface *surface)
     return 1;
 }
 
-static float objectDistance(Object *object, float x, float y)
+static float objectDistance(Model *model, int i, float x, float y)
 {
     float dx, dy;
-    dx = object->position.x - x;
-    dy = object->position.y - y;
+    dx = modelField(model, POSITION_X)[i] - x;
+    dy = modelField(model, POSITION_Y)[i] - y;
 
     return sqrt(dx * dx + dy * dy);
 }
 
-static Object *modelFindNearestObject(Model *model, float x, float y)
+static int modelFindNearestObject(Model *model, float x, float y)
 {
-    Object *object = &model->objects[0];
+    int    object = 0;
     float  distance, minDistance = 0.0;
     int    i;
 
     for (i = 0; i < model->numObjects; i++)
     {
-        distance = objectDistance(&model->objects[i], x, y);
+        distance = objectDistance(model, i, x, y);
         if (i == 0 || distance < minDistance)
         {
             minDistance = distance;
-            object = &model->objects[i];
+            object = i;
         }
     }
 
     return object;
 }
 
-static void modelAdjustCorners(Model *model, int x, int y,
-        int width, int height, int make_immobile)
+/* Push the neighbours of the object away from it, along their springs */
+static void modelPushNeighbours(Model *model, int object)
 {
-    Object *o;
-    o = &model->objects[0];
-    o->position.x = x;
-    o->position.y = y;
-    o->immobile = make_immobile;
-
-    o = &model->objects[GRID_WIDTH - 1];
-    o->position.x = x + width;
-    o->position.y = y;
-    o->immobile = make_immobile;
-
-    o = &model->objects[GRID_WIDTH * (GRID_HEIGHT - 1)];
-    o->position.x = x;
-    o->position.y = y + height;
-    o->immobile = make_immobile;
-
-    o = &model->objects[model->numObjects - 1];
-    o->position.x = x + width;
-    o->position.y = y + height;
-    o->immobile = make_immobile;
-
-    if (!model->anchorObject)
-        model->anchorObject = &model->objects[0];
+    int gw = model->gridWidth;
+    int gridX = object % gw, gridY = object / gw;
+    float *vx = modelField(model, VELOCITY_X);
+    float *vy = modelField(model, VELOCITY_Y);
+
+    if (gridX > 0)
+        vx[object - 1] += model->hpad * 0.05f;
+    if (gridX < gw - 1)
+        vx[object + 1] -= model->hpad * 0.05f;
+    if (gridY > 0)
+        vy[object - gw] += model->vpad * 0.05f;
+    if (gridY < model->gridHeight - 1)
+        vy[object + gw] -= model->vpad * 0.05f;
 }
 
-static int modelRemoveEdgeAnchors(Model *model)
+static void modelAdjustCorners(Model *model, int x, int y,
+        int width, int height, int make_immobile)
 {
-    int result = 0;
-    Object *o;
-
-    o = &model->objects[0];
-    if (o != model->anchorObject)
-    {
-        result |= o->immobile;
-        o->immobile = 0;
-    }
-
-    o = &model->objects[GRID_WIDTH - 1];
-    if (o != model->anchorObject)
-    {
-        result |= o->immobile;
-        o->immobile = 0;
-    }
-
-    o = &model->objects[GRID_WIDTH * (GRID_HEIGHT - 1)];
-    if (o != model->anchorObject)
-    {
-        result |= o->immobile;
-        o->immobile = 0;
-    }
+    int gw = model->gridWidth, gh = model->gridHeight;
+    int corners[4] = {0, gw - 1, gw * (gh - 1), model->numObjects - 1};
+    float *px = modelField(model, POSITION_X);
+    float *py = modelField(model, POSITION_Y);
+    int i;
 
-    o = &model->objects[model->numObjects - 1];
-    if (o != model->anchorObject)
+    for (i = 0; i < 4; i++)
     {
-        result |= o->immobile;
-        o->immobile = 0;
+        px[corners[i]] = x + ((i & 1) ? width : 0);
+        py[corners[i]] = y + ((i & 2) ? height : 0);
+        objectSetImmobile(model, corners[i], make_immobile);
     }
 
-    return result;
+    if (model->anchor < 0)
+        model->anchor = 0;
 }
 
-void wobbly_prepare_paint(struct wobbly_surface *surface, int msSinceLastPaint)
+static int modelRemoveEdgeAnchors(Model *model)
 {
-    WobblyWindow *ww = surface->ww;
-    float  friction, springK;
-
-    friction = wobbly_settings_get_friction();
-    springK  = wobbly_settings_get_spring_k();
+    int gw = model->gridWidth, gh = model->gridHeight;
+    int corners[4] = {0, gw - 1, gw * (gh - 1), model->numObjects - 1};
+    int result = 0;
+    int i;
 
-    if (ww->wobbly)
+    for (i = 0; i < 4; i++)
     {
-        if (ww->wobbly & (WobblyInitial | WobblyVelocity | WobblyForce))
+        if (corners[i] != model->anchor)
         {
-            ww->wobbly = modelStep(ww->model, friction, springK,
-                    (ww->wobbly & WobblyVelocity) ?
-                    msSinceLastPaint : 16);
-
-            if (ww->wobbly) {
-                modelCalcBounds(ww->model);
-            } else {
-                surface->x = ww->model->topLeft.x;
-                surface->y = ww->model->topLeft.y;
-                surface->synced = 1;
-            }
+            result |= objectIsImmobile(model, corners[i]);
+            objectSetImmobile(model, corners[i], 0);
         }
     }
+
+    return result;
 }
 
 void wobbly_done_paint(struct wobbly_surface *surface)
@@ -551,23 +715,21 @@ void wobbly_done_paint(struct wobbly_surface *surface)
 void wobbly_add_geometry(struct wobbly_surface *surface)
 {
     WobblyWindow *ww = surface->ww;
+    Model *model = ww->model;
 
-    float    width, height;
-    float    deformedX, deformedY;
-    int      x, y, iw, ih;
-    float    cell_w, cell_h;
+    int      x, x0, y, i, j, iw, ih, gw, gh;
+    float    *px, *py;
+    float    coeffsU[WOBBLY_MAX_GRID_SIZE][WOBBLY_MAX_GRID_SIZE];
+    float    coeffsV[WOBBLY_MAX_GRID_SIZE];
+    float    rowX[WOBBLY_MAX_GRID_SIZE], rowY[WOBBLY_MAX_GRID_SIZE];
     GLfloat  *v, *uv;
 
     if (ww->wobbly)
     {
-        width  = surface->width;
-        height = surface->height;
-
-        cell_w = width / surface->x_cells;
-        cell_h = height / surface->y_cells;
-
         iw = surface->x_cells + 1;
         ih = surface->y_cells + 1;
+        gw = model->gridWidth;
+        gh = model->gridHeight;
 
         v = realloc(surface->v, sizeof(GLfloat) * 2 * iw * ih);
         uv = realloc(surface->uv, sizeof(GLfloat) * 2 * iw * ih);
@@ -575,19 +737,56 @@ void wobbly_add_geometry(struct wobbly_surface *surface)
         surface->v = v;
         surface->uv = uv;
 
-        for (y = 0; y < ih; y++)
+        px = modelField(model, POSITION_X);
+        py = modelField(model, POSITION_Y);
+
+        /* The window is a Bezier patch with the objects as control points.
+         * The weights of the columns are the same in all rows, so they are
+         * computed once for up to WOBBLY_MAX_GRID_SIZE columns at a time. */
+        for (x0 = 0; x0 < iw; x0 += WOBBLY_MAX_GRID_SIZE)
         {
-            for (x = 0; x < iw; x++)
-            {
-                bezierPatchEvaluate(ww->model,
-                        (x * cell_w) / width, (y * cell_h) / height,
-                        &deformedX, &deformedY);
+            int columns = iw - x0;
+            if (columns > WOBBLY_MAX_GRID_SIZE)
+                columns = WOBBLY_MAX_GRID_SIZE;
 
-                *v++ = deformedX;
-                *v++ = deformedY;
+            for (x = 0; x < columns; x++)
+            {
+                bernsteinCoefficients(gw - 1,
+                        (float) (x0 + x) / surface->x_cells, coeffsU[x]);
+            }
 
-                *uv++ = (x * cell_w) / width;
-                *uv++ = 1.0 - ((y * cell_h) / height);
+            for (y = 0; y < ih; y++)
+            {
+                /* Reduce the grid to the Bezier curve of this row */
+                bernsteinCoefficients(gh - 1, (float) y / surface->y_cells,
+                        coeffsV);
+
+                for (i = 0; i < gw; i++)
+                {
+                    rowX[i] = rowY[i] = 0.0f;
+                    for (j = 0; j < gh; j++)
+                    {
+                        rowX[i] += coeffsV[j] * px[j * gw + i];
+                        rowY[i] += coeffsV[j] * py[j * gw + i];
+                    }
+                }
+
+                for (x = 0; x < columns; x++)
+                {
+                    float deformedX = 0.0f, deformedY = 0.0f;
+                    int vertex = y * iw + x0 + x;
+                    for (i = 0; i < gw; i++)
+                    {
+                        deformedX += coeffsU[x][i] * rowX[i];
+                        deformedY += coeffsU[x][i] * rowY[i];
+                    }
+
+                    v[2 * vertex] = deformedX;
+                    v[2 * vertex + 1] = deformedY;
+
+                    uv[2 * vertex] = (float) (x0 + x) / surface->x_cells;
+                    uv[2 * vertex + 1] = 1.0 - ((float) y / surface->y_cells);
+                }
             }
         }
     }
@@ -615,8 +814,9 @@ void wobbly_move_notify(struct wobbly_surface *surface, int x, int y)
     WobblyWindow *ww = surface->ww;
     if (ww->grabbed)
     {
-        ww->model->anchorObject->position.x = x + ww->grab_dx;
-        ww->model->anchorObject->position.y = y + ww->grab_dy;
+        Model *model = ww->model;
+        modelField(model, POSITION_X)[model->anchor] = x + ww->grab_dx;
+        modelField(model, POSITION_Y)[model->anchor] = y + ww->grab_dy;
 
         ww->wobbly |= WobblyInitial;
         surface->synced = 0;
@@ -628,28 +828,9 @@ void wobbly_slight_wobble(struct wobbly_surface *surface)
     WobblyWindow *ww = surface->ww;
     if (wobblyEnsureModel(surface))
     {
-        Object *centerObj;
-        Spring *s;
-        int	   i;
-
-        centerObj = modelFindNearestObject(ww->model,
+        int centerObj = modelFindNearestObject(ww->model,
             surface->x + surface->width / 2, surface->y + surface->height / 2);
-
-        for (i = 0; i < ww->model->numSprings; i++)
-        {
-            s = &ww->model->springs[i];
-
-            if (s->a == centerObj)
-            {
-                s->b->velocity.x -= s->offset.x * 0.05f;
-                s->b->velocity.y -= s->offset.y * 0.05f;
-            }
-            else if (s->b == centerObj)
-            {
-                s->a->velocity.x += s->offset.x * 0.05f;
-                s->a->velocity.y += s->offset.y * 0.05f;
-            }
-        }
+        modelPushNeighbours(ww->model, centerObj);
 
         ww->wobbly |= WobblyInitial;
     }
@@ -671,33 +852,18 @@ void wobbly_grab_notify(struct wobbly_surface *surface, int x, int y)
 
     if (wobblyEnsureModel(surface))
     {
-        Spring *s;
-        int	   i;
+        Model *model = ww->model;
 
-        if (ww->model->anchorObject)
-            ww->model->anchorObject->immobile = 0;
+        if (model->anchor >= 0)
+            objectSetImmobile(model, model->anchor, 0);
 
-        ww->model->anchorObject = modelFindNearestObject(ww->model, x, y);
-        ww->model->anchorObject->immobile = 1;
-        ww->grab_dx = ww->model->anchorObject->position.x - x;
-        ww->grab_dy = ww->model->anchorObject->position.y - y;
+        model->anchor = modelFindNearestObject(model, x, y);
+        objectSetImmobile(model, model->anchor, 1);
+        ww->grab_dx = modelField(model, POSITION_X)[model->anchor] - x;
+        ww->grab_dy = modelField(model, POSITION_Y)[model->anchor] - y;
 
         ww->grabbed = 1;
-        for (i = 0; i < ww->model->numSprings; i++)
-        {
-            s = &ww->model->springs[i];
-
-            if (s->a == ww->model->anchorObject)
-            {
-                s->b->velocity.x -= s->offset.x * 0.05f;
-                s->b->velocity.y -= s->offset.y * 0.05f;
-            }
-            else if (s->b == ww->model->anchorObject)
-            {
-                s->a->velocity.x += s->offset.x * 0.05f;
-                s->a->velocity.y += s->offset.y * 0.05f;
-            }
-        }
+        modelPushNeighbours(model, model->anchor);
 
         ww->wobbly |= WobblyInitial;
     }
@@ -710,10 +876,10 @@ void wobbly_ungrab_notify(struct wobbly_surface *surface)
     {
         if (ww->model)
         {
-            if (ww->model->anchorObject)
-                ww->model->anchorObject->immobile = 0;
+            if (ww->model->anchor >= 0)
+                objectSetImmobile(ww->model, ww->model->anchor, 0);
 
-            ww->model->anchorObject = NULL;
+            ww->model->anchor = -1;
 
             ww->wobbly |= WobblyInitial;
         }
@@ -751,14 +917,42 @@ void wobbly_fini(struct wobbly_surface *surface)
 
     if (ww->model)
     {
-        free(ww->model->objects);
+        worldRemoveSurface(ww->model->world, surface);
         free(ww->model);
-        free(surface->v);
     }
 
+    free(surface->v);
+    free(surface->uv);
     free (ww);
 }
 
+int wobbly_set_world(struct wobbly_surface *surface, struct wobbly_world *world)
+{
+    WobblyWindow *ww = surface->ww;
+    Model *model = ww->model;
+    int i, offset;
+
+    surface->world = world;
+    if (!model || model->world == world)
+        return 1;
+
+    offset = worldAddSurface(world, surface, model->numObjects);
+    if (offset < 0)
+        return 0;
+
+    for (i = 0; i < NUM_FIELDS; i++)
+    {
+        memcpy(world->fields[i] + offset, modelField(model, i),
+                sizeof(float) * model->numObjects);
+    }
+
+    worldRemoveSurface(model->world, surface);
+    model->world  = world;
+    model->offset = offset;
+
+    return 1;
+}
+
 void wobbly_force_geometry(struct wobbly_surface *surface,
         int x, int y, int w, int h)
 {
@@ -766,10 +960,10 @@ void wobbly_force_geometry(struct wobbly_surface *surface,
 
     if (wobblyEnsureModel(surface))
     {
-		if (!ww->grabbed && ww->model->anchorObject)
+		if (!ww->grabbed && ww->model->anchor >= 0)
 		{
-		    ww->model->anchorObject->immobile = 0;
-		    ww->model->anchorObject = NULL;
+		    objectSetImmobile(ww->model, ww->model->anchor, 0);
+		    ww->model->anchor = -1;
 		}
 
         surface->x = x;
@@ -793,7 +987,8 @@ void wobbly_unenforce_geometry(struct wobbly_surface *surface)
     {
         if (modelRemoveEdgeAnchors(ww->model))
         {
-            if (!ww->model->anchorObject || !ww->model->anchorObject->immobile)
+            if (ww->model->anchor < 0 ||
+                !objectIsImmobile(ww->model, ww->model->anchor))
             {
                 modelSetMiddleAnchor(ww->model, surface->x, surface->y,
                     surface->width, surface->height);
@@ -810,10 +1005,12 @@ void wobbly_translate(struct wobbly_surface *surface, int dx, int dy)
     WobblyWindow *ww = surface->ww;
     if (wobblyEnsureModel(surface))
     {
+        float *px = modelField(ww->model, POSITION_X);
+        float *py = modelField(ww->model, POSITION_Y);
         for (int i = 0; i < ww->model->numObjects; i++)
         {
-            ww->model->objects[i].position.x += dx;
-            ww->model->objects[i].position.y += dy;
+            px[i] += dx;
+            py[i] += dy;
         }
 
         ww->model->topLeft.x += dx;
@@ -833,10 +1030,12 @@ void wobbly_scale(struct wobbly_surface *surface, double dx, double dy)
     WobblyWindow *ww = surface->ww;
     if (wobblyEnsureModel(surface))
     {
+        float *px = modelField(ww->model, POSITION_X);
+        float *py = modelField(ww->model, POSITION_Y);
         for (int i = 0; i < ww->model->numObjects; i++)
         {
-            scale(surface->x, &ww->model->objects[i].position.x, dx);
-            scale(surface->y, &ww->model->objects[i].position.y, dy);
+            scale(surface->x, &px[i], dx);
+            scale(surface->y, &py[i], dy);
         }
 
         scale(surface->x, &ww->model->topLeft.x, dx);
@@ -46,6 +46,8 @@ void main()
 }
 
 OpenGL::program_t program;
+OpenGL::uniform_t mvp_uniform;
+OpenGL::attrib_t position_attrib, uv_position_attrib;
 int times_loaded = 0;
 
 void load_program()
@@ -57,6 +59,9 @@ void load_program()
 
     OpenGL::render_begin();
     program.compile(vertex_source, frag_source);
+    mvp_uniform = program.get_uniform("MVP");
+    position_attrib    = program.get_attrib("position");
+    uv_position_attrib = program.get_attrib("uvPosition");
     OpenGL::render_end();
 }
 
@@ -131,15 +136,14 @@ void render_triangles(wf::texture_t tex, glm::mat4 mat, float *pos, float *uv,
     program.use(tex.type);
     program.set_active_texture(tex);
 
-    program.attrib_pointer("position", 2, 0, pos);
-    program.attrib_pointer("uvPosition", 2, 0, uv);
-    program.uniformMatrix4f("MVP", mat);
+    program.attrib_pointer(position_attrib, 2, 0, pos);
+    program.attrib_pointer(uv_position_attrib, 2, 0, uv);
+    program.uniformMatrix4f(mvp_uniform, mat);
 
-    GL_CALL(glEnable(GL_BLEND));
-    GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+    OpenGL::set_blend_state(true);
 
     GL_CALL(glDrawArrays(GL_TRIANGLES, 0, 3 * cnt));
-    GL_CALL(glDisable(GL_BLEND));
+    OpenGL::set_blend_state(false);
 
     program.deactivate();
 }
@@ -150,6 +154,7 @@ namespace wobbly_settings
 wf::option_wrapper_t<double> friction{"wobbly/friction"};
 wf::option_wrapper_t<double> spring_k{"wobbly/spring_k"};
 wf::option_wrapper_t<int> resolution{"wobbly/grid_resolution"};
+wf::option_wrapper_t<int> spring_grid{"wobbly/spring_grid"};
 }
 
 extern "C"
@@ -533,10 +538,41 @@ class wobbly_state_free_t : public iwobbly_state_t
 };
 }
 
+class wf_wobbly;
+
+/**
+ * The wobbly models of all views on an output. Their objects are kept in one
+ * wobbly_world, so that they are stepped together, once per frame.
+ */
+class wobbly_batch_t : public wf::custom_data_t
+{
+  public:
+    wobbly_world *world = wobbly_world_create();
+
+    static nonstd::observer_ptr<wobbly_batch_t> get(wf::output_t *output)
+    {
+        auto batch = output->get_data_safe<wobbly_batch_t>();
+        batch->output = output;
+        return batch;
+    }
+
+    void add(wf_wobbly *wobbly);
+    void remove(wf_wobbly *wobbly);
+    ~wobbly_batch_t();
+
+  private:
+    wf::output_t *output;
+    std::vector<wf_wobbly*> wobblies;
+    uint32_t last_frame;
+
+    wf::effect_hook_t pre_hook = [=] () { step(); };
+    void step();
+};
+
 class wf_wobbly : public wf::view_transformer_t
 {
     wayfire_view view;
-    wf::effect_hook_t pre_hook;
+    nonstd::observer_ptr<wobbly_batch_t> batch;
 
     wf::signal_callback_t view_removed = [=] (wf::signal_data_t*)
     {
@@ -566,9 +602,6 @@ class wf_wobbly : public wf::view_transformer_t
 
         if (!view->get_output())
         {
-            // Destructor won't be able to disconnect bc view output is invalid
-            sig->output->render->rem_effect(&pre_hook);
-
             return destroy_self();
         }
 
@@ -581,9 +614,10 @@ class wf_wobbly : public wf::view_transformer_t
         state->translate_model(old_geometry.x - new_geometry.x,
             old_geometry.y - new_geometry.y);
 
-        sig->output->render->rem_effect(&pre_hook);
-        view->get_output()->render->add_effect(&pre_hook,
-            wf::OUTPUT_EFFECT_PRE);
+        batch->remove(this);
+        batch = wobbly_batch_t::get(view->get_output());
+        wobbly_set_world(model.get(), batch->world);
+        batch->add(this);
 
         on_workspace_changed.disconnect();
         view->get_output()->connect_signal("workspace-changed",
@@ -592,7 +626,7 @@ class wf_wobbly : public wf::view_transformer_t
 
     std::unique_ptr<wobbly_surface> model;
     std::unique_ptr<wf::iwobbly_state_t> state;
-    uint32_t last_frame;
+    int grid_resolution;
 
     void init_model()
     {
@@ -607,8 +641,12 @@ class wf_wobbly : public wf::view_transformer_t
         model->grabbed = 0;
         model->synced  = 1;
 
-        model->x_cells = wobbly_settings::resolution;
-        model->y_cells = wobbly_settings::resolution;
+        model->x_cells = grid_resolution;
+        model->y_cells = grid_resolution;
+
+        model->world = batch->world;
+        model->grid_width  = wobbly_settings::spring_grid;
+        model->grid_height = wobbly_settings::spring_grid;
 
         model->v  = NULL;
         model->uv = NULL;
@@ -616,14 +654,14 @@ class wf_wobbly : public wf::view_transformer_t
     }
 
   public:
-    wf_wobbly(wayfire_view view)
+    wf_wobbly(wayfire_view view, int grid_resolution)
     {
         this->view = view;
+        this->grid_resolution = grid_resolution;
+        this->batch = wobbly_batch_t::get(view->get_output());
         init_model();
-        last_frame = wf::get_current_time();
+        batch->add(this);
 
-        pre_hook = [=] () { update_model(); };
-        view->get_output()->render->add_effect(&pre_hook, wf::OUTPUT_EFFECT_PRE);
         view->get_output()->connect_signal("workspace-changed",
             &on_workspace_changed);
 
@@ -668,7 +706,8 @@ class wf_wobbly : public wf::view_transformer_t
         return point;
     }
 
-    void update_model()
+    /** Prepare the model for the next step of the batch. */
+    void prepare_frame()
     {
         view->damage();
 
@@ -678,13 +717,11 @@ class wf_wobbly : public wf::view_transformer_t
             &this->view_geometry_changed);
         state->handle_frame();
         view->connect_signal("geometry-changed", &this->view_geometry_changed);
+    }
 
-        /* Update all the wobbly model */
-        auto now = wf::get_current_time();
-        wobbly_prepare_paint(model.get(), now - last_frame);
-
-        /* Update wobbly geometry */
-        last_frame = now;
+    /** Update the geometry after the batch has stepped the model. */
+    void finish_frame()
+    {
         wobbly_add_geometry(model.get());
         wobbly_done_paint(model.get());
         view->damage();
@@ -864,13 +901,9 @@ class wf_wobbly : public wf::view_transformer_t
     virtual ~wf_wobbly()
     {
         state = nullptr;
+        batch->remove(this);
         wobbly_fini(model.get());
 
-        if (view->get_output())
-        {
-            view->get_output()->render->rem_effect(&pre_hook);
-        }
-
         view->disconnect_signal("unmapped", &view_removed);
         view->disconnect_signal("tiled", &view_state_changed);
         view->disconnect_signal("fullscreen", &view_state_changed);
@@ -879,10 +912,76 @@ class wf_wobbly : public wf::view_transformer_t
     }
 };
 
+void wobbly_batch_t::add(wf_wobbly *wobbly)
+{
+    if (wobblies.empty())
+    {
+        last_frame = wf::get_current_time();
+        output->render->add_effect(&pre_hook, wf::OUTPUT_EFFECT_PRE);
+    }
+
+    wobblies.push_back(wobbly);
+}
+
+void wobbly_batch_t::remove(wf_wobbly *wobbly)
+{
+    auto it = std::find(wobblies.begin(), wobblies.end(), wobbly);
+    if (it == wobblies.end())
+    {
+        return;
+    }
+
+    wobblies.erase(it);
+    if (wobblies.empty())
+    {
+        output->render->rem_effect(&pre_hook);
+    }
+}
+
+void wobbly_batch_t::step()
+{
+    /* Finished wobblies destroy themselves in the second pass */
+    auto current = wobblies;
+    for (auto& wobbly : current)
+    {
+        wobbly->prepare_frame();
+    }
+
+    auto now = wf::get_current_time();
+    wobbly_world_step(world, now - last_frame);
+    last_frame = now;
+
+    for (auto& wobbly : current)
+    {
+        wobbly->finish_frame();
+    }
+}
+
+wobbly_batch_t::~wobbly_batch_t()
+{
+    /* Usually the plugin has already destroyed them */
+    for (auto& wobbly : std::vector<wf_wobbly*>(wobblies))
+    {
+        wobbly->destroy_self();
+    }
+
+    wobbly_world_destroy(world);
+}
+
 class wayfire_wobbly : public wf::plugin_interface_t
 {
     wf::signal_callback_t wobbly_changed;
 
+    /* Each lower quality level halves the grid resolution of new wobbly
+     * models. Running models keep their grid. */
+    wf::quality_control_t quality;
+
+    int get_grid_resolution()
+    {
+        int shift = quality.num_levels - 1 - quality.level;
+        return std::max(2, (int)wobbly_settings::resolution >> shift);
+    }
+
   public:
     void init() override
     {
@@ -896,6 +995,9 @@ class wayfire_wobbly : public wf::plugin_interface_t
 
         output->connect_signal("wobbly-event", &wobbly_changed);
 
+        quality.num_levels = 3;
+        output->render->add_quality_control(&quality);
+
         wobbly_graphics::load_program();
     }
 
@@ -910,7 +1012,7 @@ class wayfire_wobbly : public wf::plugin_interface_t
             (data->view->get_transformer("wobbly") == nullptr))
         {
             data->view->add_transformer(
-                std::make_unique<wf_wobbly>(data->view),
+                std::make_unique<wf_wobbly>(data->view, get_grid_resolution()),
                 "wobbly");
         }
 
@@ -974,7 +1076,9 @@ class wayfire_wobbly : public wf::plugin_interface_t
             }
         }
 
+        output->erase_data<wobbly_batch_t>();
         wobbly_graphics::destroy_program();
+        output->render->rem_quality_control(&quality);
         output->disconnect_signal("wobbly-event", &wobbly_changed);
     }
 };
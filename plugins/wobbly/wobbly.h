@@ -14,14 +14,21 @@
 #define MINIMAL_SPRING_K 0.1
 #define MAXIMAL_SPRING_K 10.0
 #define WOBBLY_MASS 15.0
+#define WOBBLY_MAX_GRID_SIZE 16
 
 double wobbly_settings_get_friction();
 double wobbly_settings_get_spring_k();
 
+/* The models of the surfaces in a world are stepped together */
+struct wobbly_world;
+
 struct wobbly_surface
 {
    void *ww;
+   struct wobbly_world *world;
    int x, y, width, height;
+   /* The number of points of the spring model along each side */
+   int grid_width, grid_height;
    int x_cells, y_cells;
    int grabbed, synced;
    int vertex_count;
@@ -35,8 +42,18 @@ struct wobbly_rect
     float brx, bry;
 };
 
+struct wobbly_world *wobbly_world_create(void);
+/* All surfaces of the world must be destroyed first */
+void wobbly_world_destroy(struct wobbly_world *world);
+/* Advance the models of all surfaces in the world */
+void wobbly_world_step(struct wobbly_world *world, int msSinceLastPaint);
+
+/* Set world, grid size and geometry of the surface before calling this */
 int  wobbly_init(struct wobbly_surface *surface);
 void wobbly_fini(struct wobbly_surface *surface);
+/* Move the model of the surface to another world */
+int  wobbly_set_world(struct wobbly_surface *surface,
+    struct wobbly_world *world);
 void wobbly_set_top_anchor(struct wobbly_surface *surface,
     int x, int y, int w, int h);
 
@@ -47,7 +64,6 @@ void wobbly_ungrab_notify(struct wobbly_surface *surface);
 void wobbly_scale(struct wobbly_surface *surface, double dx, double dy);
 void wobbly_resize(struct wobbly_surface *surface, int width, int height);
 void wobbly_move_notify(struct wobbly_surface *surface, int x, int y);
-void wobbly_prepare_paint(struct wobbly_surface *surface, int msSinceLastPaint);
 void wobbly_done_paint(struct wobbly_surface *surface);
 void wobbly_add_geometry(struct wobbly_surface *surface);
 struct wobbly_rect wobbly_boundingbox(struct wobbly_surface *surface);
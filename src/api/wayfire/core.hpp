@@ -33,6 +33,8 @@ namespace wf
 {
 class output_t;
 class output_layout_t;
+class worker_pool_t;
+class task_scheduler_t;
 class input_device_t;
 
 /** Describes the state of the compositor */
@@ -89,6 +91,11 @@ class compositor_core_t : public wf::object_base_t
     std::unique_ptr<wf::config_backend_t> config_backend;
     std::unique_ptr<wf::output_layout_t> output_layout;
 
+    /** The worker threads, see worker-pool.hpp */
+    std::unique_ptr<wf::worker_pool_t> worker_pool;
+    /** Runs work on the worker threads, see task-scheduler.hpp */
+    std::unique_ptr<wf::task_scheduler_t> scheduler;
+
     /**
      * Various protocols supported by wlroots
      */
@@ -0,0 +1,83 @@
+#ifndef WF_FRAME_TIMING_HPP
+#define WF_FRAME_TIMING_HPP
+
+#include <cstdint>
+
+namespace wf
+{
+/**
+ * The phases of an output's repaint cycle which are measured separately.
+ */
+enum frame_phase_t
+{
+    /* Running the OUTPUT_EFFECT_PRE hooks */
+    FRAME_PHASE_EFFECT_PRE      = 0,
+    /* Running the OUTPUT_EFFECT_DAMAGE hooks */
+    FRAME_PHASE_EFFECT_DAMAGE   = 1,
+    /* Running the render hook of a plugin, or the default renderer */
+    FRAME_PHASE_RENDER          = 2,
+    /* Updating workspace streams. This is part of the render phase, and
+     * includes all streams updated in the frame, for ex. by expo or cube. */
+    FRAME_PHASE_WORKSPACE_STREAM = 3,
+    /* Running the OUTPUT_EFFECT_OVERLAY hooks */
+    FRAME_PHASE_EFFECT_OVERLAY  = 4,
+    /* Running the postprocessing hooks */
+    FRAME_PHASE_POSTPROCESSING  = 5,
+    /* Rendering software cursors */
+    FRAME_PHASE_SOFTWARE_CURSOR = 6,
+    /* Committing the frame to the output, or directly scanning out a view */
+    FRAME_PHASE_COMMIT          = 7,
+    /* Running the OUTPUT_EFFECT_POST hooks */
+    FRAME_PHASE_EFFECT_POST     = 8,
+    FRAME_PHASE_TOTAL           = 9,
+};
+
+/** @return A short human-readable name of the phase. */
+const char *get_frame_phase_name(frame_phase_t phase);
+
+/**
+ * How a repaint cycle ended.
+ */
+enum frame_result_t
+{
+    /* The frame was rendered and committed */
+    FRAME_RESULT_RENDERED = 0,
+    /* A view was directly scanned out */
+    FRAME_RESULT_SCANOUT  = 1,
+    /* Nothing was damaged, or the output could not be made current */
+    FRAME_RESULT_SKIPPED  = 2,
+};
+
+/**
+ * The timings of a single repaint cycle of an output.
+ *
+ * All times are in nanoseconds. Phases which did not run in the frame have
+ * zero CPU time. GPU times are -1 if the phase was not measured on the GPU,
+ * or if the GPU timer is not supported by the driver.
+ */
+struct frame_timing_t
+{
+    /** Increases by one for each repaint cycle of the output. */
+    uint64_t sequence = 0;
+    /** When the repaint cycle started, in CLOCK_MONOTONIC. */
+    int64_t start_nsec = 0;
+    /** Time from the start of the repaint cycle until its end. */
+    int64_t total_cpu_nsec = 0;
+
+    /** The repaint delay used for the frame, in milliseconds. */
+    int repaint_delay = 0;
+    frame_result_t result = FRAME_RESULT_SKIPPED;
+
+    int64_t cpu_nsec[FRAME_PHASE_TOTAL] = {0};
+    int64_t gpu_nsec[FRAME_PHASE_TOTAL] = {0};
+
+    /** The number of damaged boxes on the output which were repainted. */
+    int damage_rects = 0;
+    /** The number of damaged boxes which were merged into others. */
+    int damage_rects_merged = 0;
+    /** The undamaged area, in pixels, repainted because of merged boxes. */
+    int64_t damage_area_added = 0;
+};
+}
+
+#endif /* end of include guard: WF_FRAME_TIMING_HPP */
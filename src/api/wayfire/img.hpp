@@ -2,11 +2,39 @@
 #define IMG_HPP_
 
 #include <GLES2/gl2.h>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace image_io
 {
+/* A decoded image, with 3 (RGB) or 4 (RGBA) channels of 8 bits per pixel,
+ * and rows from top to bottom */
+struct image_t
+{
+    int width    = 0;
+    int height   = 0;
+    int channels = 0;
+    std::vector<uint8_t> data;
+    /* Why decoding failed, empty if it didn't */
+    std::string error;
+};
+
+/* Decode the image in the given file.
+ * Doesn't use GL or log, so it can be called from any thread, for ex. in the
+ * work function of a task (see task-scheduler.hpp). On failure, the reason
+ * is stored in image.error */
+bool decode_file(std::string name, image_t& image);
+
+/* Upload a decoded image to the given GL texture target, which is either
+ * GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP
+ * If decoding the image failed, logs image.error and returns false
+ * Bind the texture before you call this function
+ * Guaranteed: doesn't change any GL state except pixel packing */
+bool upload_to_texture(const image_t& image, GLuint target);
+
 /* Load the image from the given file, binding it to the given GL texture target
+ * This is decode_file() followed by upload_to_texture()
  * Bind the texture before you call this function
  * Guaranteed: doesn't change any GL state except pixel packing */
 bool load_from_file(std::string name, GLuint target);
@@ -4,6 +4,8 @@
 #include <typeinfo>
 #include <memory>
 #include <string>
+#include <cstdint>
+#include <functional>
 
 #include <wayfire/nonstd/observer_ptr.h>
 #include <wayfire/nonstd/noncopyable.hpp>
@@ -22,6 +24,69 @@ struct signal_data_t
 using signal_callback_t = std::function<void (signal_data_t*)>;
 class signal_provider_t;
 
+/**
+ * Identifies a signal by a hash of its name. The hash is computed at compile
+ * time when the name is a constant, so that emitting a signal by its ID
+ * doesn't need to construct or hash a string.
+ *
+ * A signal ID and the signal's name can be used interchangeably, i.e
+ * connecting to signal_id_t{"view-mapped"} also receives the "view-mapped"
+ * signal emitted by name, and vice versa.
+ */
+class signal_id_t
+{
+  public:
+    constexpr explicit signal_id_t(const char *name) : hash(hash_name(name))
+    {}
+
+    explicit signal_id_t(const std::string& name) : signal_id_t(name.c_str())
+    {}
+
+    constexpr bool operator ==(const signal_id_t& other) const
+    {
+        return hash == other.hash;
+    }
+
+    constexpr bool operator !=(const signal_id_t& other) const
+    {
+        return hash != other.hash;
+    }
+
+  private:
+    uint64_t hash;
+
+    /* 64-bit FNV-1a */
+    static constexpr uint64_t hash_name(const char *name)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (; *name; ++name)
+        {
+            hash ^= (unsigned char)*name;
+            hash *= 1099511628211ull;
+        }
+
+        return hash;
+    }
+};
+
+/**
+ * A signal whose data has the type SignalData. Emitting a typed signal
+ * ensures the data has the expected type at compile time.
+ *
+ * Typed signals are usually declared as constants next to their data, see
+ * signal-definitions.hpp.
+ */
+template<class SignalData>
+struct signal_t
+{
+    using data_t = SignalData;
+
+    constexpr explicit signal_t(const char *name) : id(name)
+    {}
+
+    signal_id_t id;
+};
+
 /**
  * Provides an interface to connect to signal providers.
  *
@@ -68,6 +133,17 @@ class signal_provider_t
   public:
     /** Register a connection to be called when the given signal is emitted. */
     void connect_signal(std::string name, signal_connection_t *callback);
+    /** Same as connect_signal(), but with the ID of the signal. */
+    void connect_signal(signal_id_t id, signal_connection_t *callback);
+
+    /** Same as connect_signal(), but with a typed signal. */
+    template<class SignalData>
+    void connect_signal(const signal_t<SignalData>& signal,
+        signal_connection_t *callback)
+    {
+        connect_signal(signal.id, callback);
+    }
+
     /** Unregister a connection. */
     void disconnect_signal(signal_connection_t *callback);
 
@@ -84,6 +160,16 @@ class signal_provider_t
 
     /** Emit the given signal. No type checking for data is required */
     void emit_signal(std::string name, signal_data_t *data);
+    /** Same as emit_signal(), but with the ID of the signal. */
+    void emit_signal(signal_id_t id, signal_data_t *data);
+
+    /** Emit a typed signal, checking the type of the data. */
+    template<class SignalData>
+    void emit_signal(const signal_t<SignalData>& signal,
+        typename signal_t<SignalData>::data_t *data)
+    {
+        emit_signal(signal.id, data);
+    }
 
     virtual ~signal_provider_t();
 
@@ -2,6 +2,7 @@
 #define WF_OPENGL_HPP
 
 #include <GLES3/gl3.h>
+#include <cstdint>
 
 #include <wayfire/config/types.hpp>
 #include <wayfire/util.hpp>
@@ -279,6 +280,58 @@ void draw_cached();
  */
 void clear_cached();
 
+/**
+ * Start a batch of textured quads rendered with the built-in shaders.
+ *
+ * Quads added with batch_texture() are collected in a vertex buffer, and are
+ * drawn with a single draw call for each change of texture, color or flags.
+ * Instead of scissoring each damaged rectangle, the quads are clipped to the
+ * damaged region, so a fragmented damage still results in a single draw.
+ *
+ * No other GL state should be changed between batch_begin() and batch_end().
+ *
+ * @param fb The framebuffer to render onto. It should have been already bound.
+ */
+void batch_begin(const wf::framebuffer_t& fb);
+
+/**
+ * Add a textured quad to the current batch.
+ *
+ * @param texture   The texture to render.
+ * @param geometry  The geometry of the quad to render, in the same coordinate
+ *                    system as the framebuffer geometry.
+ * @param damage    The part of the quad to render, in the same coordinate
+ *                    system as the framebuffer geometry.
+ * @param color     A color multiplier for each channel of the texture.
+ * @param bits      A bitwise OR of TEXTURE_TRANSFORM_INVERT_X and
+ *                    TEXTURE_TRANSFORM_INVERT_Y. Other flags are ignored.
+ */
+void batch_texture(const wf::texture_t& texture, const wf::geometry_t& geometry,
+    const wf::region_t& damage, glm::vec4 color = glm::vec4(1.f),
+    uint32_t bits = 0);
+
+/**
+ * Draw all quads remaining in the current batch and reset the GL state.
+ */
+void batch_end();
+
+/**
+ * Enable or disable blending and set the blend function.
+ *
+ * The blending state is cached for the duration of a render_begin() ..
+ * render_end() block, so that redundant GL calls are skipped. render_begin()
+ * resets the cache. Code which changes the blending state directly with
+ * glEnable/glBlendFunc inside a block must call invalidate_state_cache()
+ * afterwards.
+ */
+void set_blend_state(bool enabled, GLenum sfactor = GL_ONE,
+    GLenum dfactor = GL_ONE_MINUS_SRC_ALPHA);
+
+/**
+ * Forget the cached GL state, see set_blend_state().
+ */
+void invalidate_state_cache();
+
 /* Compiles the given shader source */
 GLuint compile_shader(std::string source, GLuint type);
 
@@ -299,6 +352,56 @@ GLuint compile_program(std::string vertex_source, std::string frag_source);
  */
 void render_rectangle(wf::geometry_t box, wf::color_t color, glm::mat4 matrix);
 
+/**
+ * A uniform of a program_t, resolved with program_t::get_uniform().
+ * Setting a uniform via its handle does not need any lookups by name.
+ */
+struct uniform_t
+{
+    int index = -1;
+};
+
+/**
+ * An attribute of a program_t, resolved with program_t::get_attrib().
+ */
+struct attrib_t
+{
+    int index = -1;
+};
+
+/** FNV-1a hash of a uniform or attribute name, usable at compile time. */
+constexpr uint32_t hash_name(const char *name, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+/**
+ * A uniform or attribute name together with its precomputed hash.
+ * Create it with the _name literal, for ex. "MVP"_name.
+ *
+ * program_t remembers names by their address, so the name must stay valid
+ * and unchanged for the lifetime of the program, as string literals do.
+ */
+struct hashed_name_t
+{
+    const char *name;
+    uint32_t hash;
+};
+
+namespace literals
+{
+constexpr hashed_name_t operator ""_name(const char *name, size_t length)
+{
+    return {name, hash_name(name, length)};
+}
+}
+
 /**
  * An OpenGL program for rendering texture_t.
  * It contains multiple programs for the different texture types.
@@ -350,6 +453,76 @@ class program_t : public noncopyable_t
     /** @return The program ID for the given texture type, or 0 on failure */
     int get_program_id(wf::texture_type_t type);
 
+    /**
+     * Resolve the given uniform for all texture types of the program.
+     *
+     * The returned handle remains valid if the program is recompiled, so it
+     * is enough to resolve each uniform once, and then set its value with the
+     * uniform*() functions taking a uniform_t.
+     */
+    uniform_t get_uniform(const std::string& name);
+    /**
+     * Same as get_uniform(), but looks up the name by its hash. After the
+     * first call with a given name, no string comparisons are done.
+     */
+    uniform_t get_uniform(hashed_name_t name);
+
+    /**
+     * Resolve the given attribute for all texture types of the program.
+     * See get_uniform() for details.
+     */
+    attrib_t get_attrib(const std::string& name);
+    /** Same as get_attrib(), but looks up the name by its hash. */
+    attrib_t get_attrib(hashed_name_t name);
+
+    /** Set the given uniform for the currently used program. */
+    void uniform1i(uniform_t uniform, int value);
+    /** Set the given uniform for the currently used program. */
+    void uniform1f(uniform_t uniform, float value);
+    /** Set the given uniform for the currently used program. */
+    void uniform2f(uniform_t uniform, float x, float y);
+    /** Set the given uniform for the currently used program. */
+    void uniform3f(uniform_t uniform, float x, float y, float z);
+    /** Set the given uniform for the currently used program. */
+    void uniform4f(uniform_t uniform, const glm::vec4& value);
+    /** Set the given uniform for the currently used program. */
+    void uniformMatrix4f(uniform_t uniform, const glm::mat4& value);
+
+    /**
+     * Set the given uniform for the currently used program. The _name literal
+     * overloads hash the name at compile time, so that only a hash table
+     * lookup is needed to find the uniform.
+     */
+    void uniform1i(hashed_name_t name, int value)
+    {
+        uniform1i(get_uniform(name), value);
+    }
+
+    void uniform1f(hashed_name_t name, float value)
+    {
+        uniform1f(get_uniform(name), value);
+    }
+
+    void uniform2f(hashed_name_t name, float x, float y)
+    {
+        uniform2f(get_uniform(name), x, y);
+    }
+
+    void uniform3f(hashed_name_t name, float x, float y, float z)
+    {
+        uniform3f(get_uniform(name), x, y, z);
+    }
+
+    void uniform4f(hashed_name_t name, const glm::vec4& value)
+    {
+        uniform4f(get_uniform(name), value);
+    }
+
+    void uniformMatrix4f(hashed_name_t name, const glm::mat4& value)
+    {
+        uniformMatrix4f(get_uniform(name), value);
+    }
+
     /** Set the given uniform for the currently used program. */
     void uniform1i(const std::string& name, int value);
     /** Set the given uniform for the currently used program. */
@@ -372,6 +545,13 @@ class program_t : public noncopyable_t
      */
     void attrib_pointer(const std::string& attrib,
         int size, int stride, const void *ptr, GLenum type = GL_FLOAT);
+    void attrib_pointer(attrib_t attrib,
+        int size, int stride, const void *ptr, GLenum type = GL_FLOAT);
+    void attrib_pointer(hashed_name_t attrib,
+        int size, int stride, const void *ptr, GLenum type = GL_FLOAT)
+    {
+        attrib_pointer(get_attrib(attrib), size, stride, ptr, type);
+    }
 
     /*
      * Set the attrib divisor. Analoguous to glVertexAttribDivisor().
@@ -380,6 +560,11 @@ class program_t : public noncopyable_t
      * @param divisor The divisor value.
      */
     void attrib_divisor(const std::string& attrib, int divisor);
+    void attrib_divisor(attrib_t attrib, int divisor);
+    void attrib_divisor(hashed_name_t attrib, int divisor)
+    {
+        attrib_divisor(get_attrib(attrib), divisor);
+    }
 
     /**
      * Set the active texture, and modify the builtin Y-inversion uniforms.
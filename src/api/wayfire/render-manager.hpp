@@ -3,6 +3,8 @@
 
 #include "wayfire/output.hpp"
 #include "wayfire/object.hpp"
+#include "wayfire/frame-timing.hpp"
+#include <vector>
 
 namespace wf
 {
@@ -56,6 +58,34 @@ enum output_effect_type_t
 using post_hook_t = std::function<void (const wf::framebuffer_base_t& source,
     const wf::framebuffer_base_t& destination)>;
 
+/**
+ * A quality control lets an expensive effect trade quality for speed.
+ *
+ * When frames take longer to render than the output's refresh interval, the
+ * render manager lowers the level of registered quality controls, and raises
+ * it again once there is enough headroom.
+ *
+ * See render_manager::add_quality_control().
+ */
+struct quality_control_t
+{
+    /** The number of quality levels, at least 1. */
+    int num_levels = 1;
+
+    /**
+     * The current level, from 0 (lowest quality) to num_levels - 1 (full
+     * quality). Set by the render manager.
+     */
+    int level = 0;
+
+    /**
+     * Called when the render manager changes the level, with the new level.
+     * It is called after a frame has been submitted, so effects should use
+     * damage_whole_idle() or similar if the change needs a repaint.
+     */
+    std::function<void (int level)> set_level;
+};
+
 /** Render manager
  *
  * Each output has a render manager, which is responsible for all rendering
@@ -126,6 +156,25 @@ class render_manager : public wf::signal_provider_t
      */
     void rem_post(post_hook_t *hook);
 
+    /**
+     * Register an effect whose quality can be lowered when rendering is too
+     * slow. The control starts at its highest level, and set_level() is not
+     * called for it.
+     *
+     * Automatic quality adjustment is enabled with core/adaptive_quality.
+     *
+     * @param control The quality control, which must stay alive until it is
+     *   removed with rem_quality_control().
+     */
+    void add_quality_control(quality_control_t *control);
+
+    /**
+     * Remove a quality control. No-op if the control wasn't added.
+     *
+     * @param control The quality control to be removed.
+     */
+    void rem_quality_control(quality_control_t *control);
+
     /**
      * @return The damaged region on the current output for the current
      * frame that is used when swapping buffers. This function should
@@ -181,10 +230,41 @@ class render_manager : public wf::signal_provider_t
      */
     wf::framebuffer_t get_target_framebuffer() const;
 
+    /**
+     * @return How many times the frame arena, which holds the damaged surfaces
+     * and render lists of a frame, had to grow in the last frame. The arena is
+     * reused between frames, so this should be zero unless the scene has
+     * grown.
+     *
+     * Only the arena is counted. Other per-frame data, like regions and view
+     * lists, may still be allocated on the heap.
+     */
+    size_t get_frame_arena_growth_count() const;
+
+    /**
+     * Get the timings of the latest repaint cycles of the output.
+     *
+     * Timings are published with a delay of a few frames, once the GPU times
+     * are known. The render manager keeps the last 256 frames.
+     *
+     * @param max_count The maximal number of frames to return.
+     * @return The timings of the latest frames, oldest first.
+     */
+    std::vector<frame_timing_t> get_frame_timings(size_t max_count = -1) const;
+
+    /**
+     * @return Whether frame timings contain GPU times. This requires support
+     * for GL_EXT_disjoint_timer_query.
+     */
+    bool has_gpu_frame_timings() const;
+
     /**
      * Initialize a workspace stream. If you need to change the stream's
      * attributes, you should stop the stream, and start it again
      *
+     * The stream is started with the scale set in stream.scale_x and
+     * stream.scale_y, see workspace_stream_update().
+     *
      * @param stream The stream to be initialized
      */
     void workspace_stream_start(workspace_stream_t& stream);
@@ -195,8 +275,10 @@ class render_manager : public wf::signal_provider_t
      * render or an overlay hook.
      *
      * @param stream The workspace stream to update
-     * @param scale_x Unused for now
-     * @param scale_y Unused for now
+     * @param scale_x The horizontal resolution of the stream relative to the
+     *   output. The stream is rendered at the larger of the two scales.
+     * @param scale_y The vertical resolution of the stream relative to the
+     *   output. If either scale changes, the whole stream is repainted.
      */
     void workspace_stream_update(workspace_stream_t& stream,
         float scale_x = 1, float scale_y = 1);
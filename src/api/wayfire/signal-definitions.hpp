@@ -449,6 +449,19 @@ struct view_minimize_request_signal : public _view_signal
     bool carried_out = false;
 };
 
+/**
+ * name: occlusion-changed
+ * on: view, output(view-)
+ * when: After the view becomes fully occluded by the views above it, or becomes
+ *   visible again. Occluded views receive frame events at a reduced rate, see
+ *   the core/occluded_frame_rate option.
+ */
+struct view_occlusion_changed_signal : public _view_signal
+{
+    /** true if the view is fully occluded, false otherwise */
+    bool occluded;
+};
+
 /**
  * name: tiled
  * on: view, output(view-)
@@ -595,13 +608,24 @@ struct view_geometry_changed_signal : public _view_signal
     wf::geometry_t old_geometry;
 };
 
+/** The view-geometry-changed signal on output and core, as a typed signal. */
+constexpr wf::signal_t<view_geometry_changed_signal>
+VIEW_GEOMETRY_CHANGED_SIGNAL{"view-geometry-changed"};
+
 /**
  * name: region-damaged
  * on: view
  * when: Whenever a region of the view becomes damaged, for ex. when the client
  *   updates its contents.
- * argument: Unused.
  */
+struct view_region_damaged_signal : public _view_signal
+{
+    /** The damaged box, in output-local coordinates */
+    wf::geometry_t box;
+};
+
+constexpr wf::signal_t<view_region_damaged_signal>
+REGION_DAMAGED_SIGNAL{"region-damaged"};
 
 /**
  * name: decoration-state-updated
@@ -32,6 +32,71 @@ struct surface_iterator_t
     wf::point_t position;
 };
 
+/**
+ * A range over the cached surface tree of a surface, see
+ * surface_interface_t::get_surface_tree(). Iterating over it does not
+ * allocate memory.
+ */
+class surface_tree_range_t
+{
+  public:
+    class iterator
+    {
+      public:
+        iterator(const surface_iterator_t *it, wf::point_t origin) :
+            it(it), origin(origin)
+        {}
+
+        surface_iterator_t operator *() const
+        {
+            return {it->surface, it->position + origin};
+        }
+
+        iterator& operator ++()
+        {
+            ++it;
+            return *this;
+        }
+
+        bool operator ==(const iterator& other) const
+        {
+            return it == other.it;
+        }
+
+        bool operator !=(const iterator& other) const
+        {
+            return it != other.it;
+        }
+
+      private:
+        const surface_iterator_t *it;
+        wf::point_t origin;
+    };
+
+    surface_tree_range_t(const std::vector<surface_iterator_t>& surfaces,
+        wf::point_t origin) : surfaces(surfaces), origin(origin)
+    {}
+
+    iterator begin() const
+    {
+        return {surfaces.data(), origin};
+    }
+
+    iterator end() const
+    {
+        return {surfaces.data() + surfaces.size(), origin};
+    }
+
+    size_t size() const
+    {
+        return surfaces.size();
+    }
+
+  private:
+    const std::vector<surface_iterator_t>& surfaces;
+    wf::point_t origin;
+};
+
 /**
  * surface_interface_t is the base class for everything that can be displayed
  * on the screen. It is the closest thing there is in Wayfire to a Window in X11.
@@ -94,6 +159,28 @@ class surface_interface_t : public wf::object_base_t
     virtual std::vector<surface_iterator_t> enumerate_surfaces(
         wf::point_t surface_origin = {0, 0});
 
+    /**
+     * Same as enumerate_surfaces(), but without allocating memory.
+     *
+     * The surface tree is flattened once and cached until it changes, i.e
+     * until a surface in it is added, removed, mapped, unmapped or moved
+     * relative to its parent. The returned range is invalidated by such
+     * changes, so the surface tree must not be modified while iterating.
+     *
+     * @param surface_origin The coordinates of the top-left corner of the
+     * surface.
+     */
+    surface_tree_range_t get_surface_tree(wf::point_t surface_origin = {0, 0});
+
+    /**
+     * Invalidate the cached surface tree of this surface and its parents.
+     *
+     * Adding and removing subsurfaces, map state changes and commits of
+     * wlr_surface-based surfaces already do this. Other surface
+     * implementations must call it when their offset changes.
+     */
+    void invalidate_surface_tree();
+
     /**
      * @return The output the surface is currently attached to. Note this
      * doesn't necessarily mean that it is visible.
@@ -201,6 +288,17 @@ class surface_interface_t : public wf::object_base_t
     /** Remove all subsurfaces that we have. Should to be called after unmapping! */
     virtual void clear_subsurfaces();
 
+    /**
+     * Called by emit_map_state_change() after the surface has been mapped or
+     * unmapped, before the map state signals are emitted.
+     *
+     * Invalidates the cached surface tree. Subclasses which cache state
+     * depending on the map state should extend it.
+     */
+    virtual void map_state_changed();
+
+    friend void emit_map_state_change(surface_interface_t *surface);
+
     /* Allow wlr surface implementation to access surface internals */
     friend class wlr_surface_base_t;
 };
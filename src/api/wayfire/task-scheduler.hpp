@@ -0,0 +1,91 @@
+#ifndef WF_TASK_SCHEDULER_HPP
+#define WF_TASK_SCHEDULER_HPP
+
+#include <functional>
+#include <memory>
+#include <wayfire/nonstd/noncopyable.hpp>
+
+namespace wf
+{
+class output_t;
+struct scheduled_task_t;
+
+/**
+ * A handle to a task submitted to the task scheduler.
+ *
+ * Destroying the handle cancels the task, so that its completion callback is
+ * never called. Plugins should keep the handles of their tasks as members,
+ * so that the tasks are cancelled when the plugin is unloaded.
+ */
+class task_handle_t
+{
+  public:
+    task_handle_t() = default;
+    task_handle_t(task_handle_t&& other) = default;
+    task_handle_t& operator =(task_handle_t&& other);
+    ~task_handle_t();
+
+    /**
+     * Cancel the task. The work function may still be running on a worker
+     * thread, but its result will be dropped.
+     */
+    void cancel();
+
+    /** @return Whether the task is submitted and not yet completed or cancelled. */
+    bool pending() const;
+
+  private:
+    friend class task_scheduler_t;
+    std::shared_ptr<scheduled_task_t> task;
+};
+
+/**
+ * The task scheduler runs CPU-heavy work on the worker threads of the
+ * compositor (see worker-pool.hpp), and delivers the results back on the
+ * main thread, so that the work doesn't delay the repaint of the outputs.
+ *
+ * The compositor has one scheduler, available as wf::get_core().scheduler.
+ *
+ * The work functions run on a worker thread. They must be thread-safe, and
+ * must not call into the compositor or use GL. The completion callbacks run
+ * on the main thread, from the event loop, and can use the compositor as
+ * usual. Typically, the work function fills a buffer owned by the task, and
+ * the completion callback uploads it or applies it to the compositor state.
+ */
+class task_scheduler_t : public noncopyable_t
+{
+  public:
+    task_scheduler_t();
+    ~task_scheduler_t();
+
+    /**
+     * Run @work on a worker thread, and then @done on the main thread.
+     *
+     * @return A handle which cancels the task when destroyed.
+     */
+    task_handle_t submit(std::function<void()> work,
+        std::function<void()> done);
+
+    /**
+     * Run @work on a worker thread, and then @apply on the main thread, at the
+     * start of the next frame of @output (as an OUTPUT_EFFECT_PRE hook).
+     *
+     * This is meant for work whose result is shown on the output, like
+     * animation steps: the result is computed while the current frame is
+     * shown, and applied in the next one. A redraw of @output is scheduled
+     * once the work is done.
+     *
+     * The task is cancelled if @output is removed.
+     *
+     * @return A handle which cancels the task when destroyed.
+     */
+    task_handle_t submit_for_frame(wf::output_t *output,
+        std::function<void()> work, std::function<void()> apply);
+
+  private:
+    class impl;
+    std::unique_ptr<impl> priv;
+};
+}
+
+#endif /* end of include guard: WF_TASK_SCHEDULER_HPP */
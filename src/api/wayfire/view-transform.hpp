@@ -45,6 +45,28 @@ class view_transformer_t
     virtual wf::region_t transform_opaque_region(
         wf::geometry_t box, wf::region_t region);
 
+    /**
+     * Transform damage to the input of the transformer to damage to its
+     * output. It is used to repaint only the changed parts of the offscreen
+     * buffers between transformers.
+     *
+     * The returned region must contain every pixel of the output which depends
+     * on the damaged input. The default implementation takes the bounding box
+     * of each transformed rectangle, extended by a pixel for filtering.
+     *
+     * Note that the output of a transformer may also change when its
+     * parameters change. Such changes must be announced by damaging the view,
+     * see view_interface_t::damage().
+     *
+     * @param box The bounding box of the view up to this transformer.
+     * @param damage The damaged region of the input, in output-local
+     *   coordinates.
+     *
+     * @return The damaged region of the output, in output-local coordinates.
+     */
+    virtual wf::region_t transform_damage(wf::geometry_t box,
+        const wf::region_t& damage);
+
     /**
      * Transform a single point.
      *
@@ -73,6 +73,15 @@ class view_interface_t : public surface_interface_t
      */
     std::vector<wayfire_view> enumerate_views(bool mapped_only = true);
 
+    /**
+     * Same as enumerate_views(), but without allocating memory.
+     *
+     * The list is cached until the view tree changes, i.e until a view in it
+     * is mapped, unmapped, or its parent changes. The returned reference is
+     * invalidated by such changes, so they must not happen while iterating.
+     */
+    const std::vector<wayfire_view>& get_view_tree(bool mapped_only = true);
+
     /**
      * Set the toplevel parent of the view, and adjust the children's list of
      * the parent.
@@ -503,6 +512,9 @@ class view_interface_t : public surface_interface_t
     /** Damage the given box, in surface-local coordinates */
     virtual void damage_surface_box(const wlr_box& box) override;
 
+    /** Also invalidates the cached view tree, see get_view_tree() */
+    virtual void map_state_changed() override;
+
     /**
      * @return the bounding box of the view before transformers,
      *  in output-local coordinates
@@ -0,0 +1,68 @@
+#ifndef WF_WORKER_POOL_HPP
+#define WF_WORKER_POOL_HPP
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <wayfire/nonstd/noncopyable.hpp>
+
+namespace wf
+{
+/**
+ * A pool of long-lived worker threads for CPU work which can be split in
+ * parts, for ex. updating many independent objects each frame.
+ *
+ * The compositor has one pool, available as wf::get_core().worker_pool.
+ * Its threads are started on first use and sleep when there is no work.
+ *
+ * Work given to parallel_for() and fork_join() is run on the workers and on
+ * the calling thread, and the calls return only when all of it is done
+ * (fork-join). Calls from inside the work functions run serially on the
+ * calling thread.
+ *
+ * Work given to submit() runs later on one of the workers. Each worker has
+ * its own queue, and idle workers steal from the queues of busy ones.
+ *
+ * In both cases, the work functions must be thread-safe, and must not call
+ * into the compositor. See task-scheduler.hpp for getting the results back
+ * on the main thread.
+ */
+class worker_pool_t : public noncopyable_t
+{
+  public:
+    /**
+     * @param num_threads The number of worker threads. -1 means one less
+     *   than the number of CPUs, since the calling thread works too.
+     */
+    worker_pool_t(int num_threads = -1);
+    ~worker_pool_t();
+
+    /** @return The number of threads which run work, including the caller. */
+    int get_concurrency() const;
+
+    /**
+     * Split [0, count) into ranges of at most @grain items, and call
+     * @func(begin, end) for each of them, in parallel.
+     */
+    void parallel_for(size_t count, size_t grain,
+        const std::function<void(size_t begin, size_t end)>& func);
+
+    /** Run all @tasks in parallel. */
+    void fork_join(const std::vector<std::function<void()>>& tasks);
+
+    /**
+     * Run @task on a worker thread, and return without waiting for it.
+     * Without worker threads, the task is run before returning.
+     *
+     * Tasks which haven't started when the pool is destroyed are dropped.
+     */
+    void submit(std::function<void()> task);
+
+  private:
+    class impl;
+    std::unique_ptr<impl> priv;
+};
+}
+
+#endif /* end of include guard: WF_WORKER_POOL_HPP */
@@ -146,6 +146,16 @@ class workspace_manager
     std::vector<wayfire_view> get_views_on_workspace(wf::point_t ws,
         uint32_t layer_mask);
 
+    /**
+     * Same as get_views_on_workspace(), but returns a list maintained by the
+     * workspace manager instead of a copy.
+     *
+     * The list is valid until the next call to get_views_on_workspace() or
+     * get_views_on_workspace_cached(), so it must not be kept around.
+     */
+    const std::vector<wayfire_view>& get_views_on_workspace_cached(
+        wf::point_t ws, uint32_t layer_mask);
+
     /**
      * Get a list of all views visible on the given workspace and in the given
      * sublayer.
@@ -229,6 +239,13 @@ class workspace_manager
      */
     std::vector<wayfire_view> get_views_in_layer(uint32_t layers_mask);
 
+    /**
+     * @return A number which changes each time the stacking order of the views
+     *   changes, including promotion of fullscreen views. It can be used to
+     *   cache data derived from get_views_in_layer().
+     */
+    uint64_t get_stack_order_version();
+
     /**
      * Get a list of reordered fullscreen views as explained in
      * get_views_in_layer().
@@ -14,9 +14,21 @@ struct workspace_stream_t
     wf::framebuffer_base_t buffer;
     bool running = false;
 
+    /**
+     * The resolution of the stream relative to the output's resolution, as
+     * requested by the last workspace_stream_update(). The stream is rendered
+     * with a uniform scale, the larger of the two.
+     */
     float scale_x = 1.0;
     float scale_y = 1.0;
 
+    /**
+     * Whether to generate mipmaps for the stream's texture after each update.
+     * Useful if the stream is displayed at a smaller size than its resolution,
+     * for ex. in perspective.
+     */
+    bool mipmaps = false;
+
     /* The background color of the stream, when there is no view above it.
      * All streams start with -1.0 alpha to indicate that the color is
      * invalid. In this case, we use the default color, which can
@@ -47,6 +59,12 @@ struct stream_signal_t : public wf::signal_data_t
     /** The framebuffer of the stream, fb has output-local geometry. */
     const wf::framebuffer_t& fb;
 };
+
+/** The workspace-stream-pre and workspace-stream-post signals, as typed signals */
+constexpr wf::signal_t<stream_signal_t>
+WORKSPACE_STREAM_PRE_SIGNAL{"workspace-stream-pre"};
+constexpr wf::signal_t<stream_signal_t>
+WORKSPACE_STREAM_POST_SIGNAL{"workspace-stream-post"};
 }
 
 #endif /* end of include guard: WF_WORKSPACE_STREAM_HPP */
@@ -123,6 +123,12 @@ class compositor_core_impl_t : public compositor_core_t
 
     void init_last_view_tracking();
 
+    /**
+     * Dump the frame timings of all outputs to core/frame_timing_file when
+     * SIGUSR2 is received.
+     */
+    void init_frame_timing_dump();
+
     wf::signal_connection_t on_view_unmap;
     wf::signal_connection_t on_new_output;
 
@@ -7,11 +7,17 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <float.h>
+#include <signal.h>
+#include <cerrno>
+#include <cstring>
 
 #include <wayfire/img.hpp>
 #include <wayfire/output.hpp>
 #include <wayfire/util/log.hpp>
 #include <wayfire/output-layout.hpp>
+#include <wayfire/worker-pool.hpp>
+#include <wayfire/task-scheduler.hpp>
+#include <wayfire/render-manager.hpp>
 #include <wayfire/workspace-manager.hpp>
 #include <wayfire/signal-definitions.hpp>
 #include <wayfire/nonstd/wlroots-full.hpp>
@@ -27,6 +33,7 @@
 #include "../output/wayfire-shell.hpp"
 #include "../output/output-impl.hpp"
 #include "../output/gtk-shell.hpp"
+#include "../output/frame-timing.hpp"
 #include "main.hpp"
 
 #include "core-impl.hpp"
@@ -190,6 +197,8 @@ void wf::compositor_core_impl_t::init()
     protocols.data_control = wlr_data_control_manager_v1_create(display);
 
     output_layout = std::make_unique<wf::output_layout_t>(backend);
+    worker_pool   = std::make_unique<wf::worker_pool_t>();
+    scheduler     = std::make_unique<wf::task_scheduler_t>();
     init_desktop_apis();
 
     /* Somehow GTK requires the tablet_v2 to be advertised pretty early */
@@ -308,6 +317,7 @@ void wf::compositor_core_impl_t::init()
     OpenGL::init();
 
     init_last_view_tracking();
+    init_frame_timing_dump();
     this->state = compositor_state_t::START_BACKEND;
 }
 
@@ -335,6 +345,88 @@ void wf::compositor_core_impl_t::init_last_view_tracking()
     });
 }
 
+/**
+ * @return The file to dump the frame timings to, by default in the user's
+ *   runtime directory.
+ */
+static std::string get_frame_timing_file()
+{
+    wf::option_wrapper_t<std::string> file{"core/frame_timing_file"};
+    if (!((std::string)file).empty())
+    {
+        return file;
+    }
+
+    const char *runtime_dir = getenv("XDG_RUNTIME_DIR");
+    if (!runtime_dir)
+    {
+        return "";
+    }
+
+    return std::string(runtime_dir) + "/wayfire-frame-timings.txt";
+}
+
+static int dump_frame_timings(int signal, void*)
+{
+    std::string file = get_frame_timing_file();
+    if (file.empty())
+    {
+        LOGE("XDG_RUNTIME_DIR is not set and core/frame_timing_file is empty, "
+             "not dumping frame timings");
+        return 0;
+    }
+
+    std::string contents;
+    for (auto& wo : wf::get_core().output_layout->get_outputs())
+    {
+        contents += "## output " + wo->to_string() + "\n";
+        contents += wf::format_frame_timings(wo->render->get_frame_timings());
+    }
+
+    /* Don't follow symlinks, the file may be in a shared directory */
+    int fd = open(file.c_str(),
+        O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd < 0)
+    {
+        LOGE("Failed to open ", file, " for dumping frame timings: ",
+            strerror(errno));
+        return 0;
+    }
+
+    size_t written = 0;
+    while (written < contents.size())
+    {
+        ssize_t r = write(fd, contents.data() + written,
+            contents.size() - written);
+        if (r < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            LOGE("Failed to write frame timings to ", file, ": ",
+                strerror(errno));
+            break;
+        }
+
+        written += r;
+    }
+
+    close(fd);
+    if (written == contents.size())
+    {
+        LOGI("Dumped frame timings to ", file);
+    }
+
+    return 0;
+}
+
+void wf::compositor_core_impl_t::init_frame_timing_dump()
+{
+    wl_event_loop_add_signal(ev_loop, SIGUSR2, dump_frame_timings, nullptr);
+}
+
 void wf::compositor_core_impl_t::post_init()
 {
     this->emit_signal("_backend_started", nullptr);
@@ -885,7 +977,9 @@ wf::compositor_core_impl_t::~compositor_core_impl_t()
      * then we destroy the input manager, and finally the rest is auto-freed */
     views.clear();
     input.reset();
+    scheduler.reset();
     output_layout.reset();
+    worker_pool.reset();
 }
 
 wf::compositor_core_impl_t& wf::compositor_core_impl_t::get()
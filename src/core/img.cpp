@@ -21,16 +21,17 @@
 
 namespace image_io
 {
-using Loader = std::function<bool (const char*, GLuint)>;
+using Decoder = std::function<bool (const char*, image_t&)>;
 using Writer = std::function<void (const char*name, uint8_t*pixels, unsigned long,
     unsigned long)>;
 namespace
 {
-std::unordered_map<std::string, Loader> loaders;
+std::unordered_map<std::string, Decoder> decoders;
 std::unordered_map<std::string, Writer> writers;
 }
 
-bool load_data_as_cubemap(unsigned char *data, int width, int height, int channels)
+bool load_data_as_cubemap(const unsigned char *data, int width, int height,
+    int channels)
 {
     width  /= 4;
     height /= 3;
@@ -120,18 +121,26 @@ bool load_data_as_cubemap(unsigned char *data, int width, int height, int channe
 #ifdef BUILD_WITH_IMAGEIO
 /* All backend functions are taken from the internet.
  * If you want to be credited, contact me */
-bool texture_from_png(const char *filename, GLuint target)
+bool decode_png(const char *filename, image_t& image)
 {
     FILE *fp = fopen(filename, "rb");
+    if (!fp)
+    {
+        image.error = "failed to read PNG file " + std::string(filename);
+        return false;
+    }
+
     int width, height;
     png_byte color_type;
     png_byte bit_depth;
-    png_bytep *row_pointers;
+    /* Declared before setjmp(), so that they are freed on errors too */
+    std::vector<png_bytep> row_pointers;
 
     png_structp png =
         png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
     if (!png)
     {
+        image.error = "failed to decode PNG file " + std::string(filename);
         fclose(fp);
         return false;
     }
@@ -139,12 +148,16 @@ bool texture_from_png(const char *filename, GLuint target)
     png_infop infos = png_create_info_struct(png);
     if (!infos)
     {
+        image.error = "failed to decode PNG file " + std::string(filename);
+        png_destroy_read_struct(&png, NULL, NULL);
         fclose(fp);
         return false;
     }
 
     if (setjmp(png_jmpbuf(png)))
     {
+        image.error = "failed to decode PNG file " + std::string(filename);
+        png_destroy_read_struct(&png, &infos, NULL);
         fclose(fp);
         return false;
     }
@@ -194,37 +207,21 @@ bool texture_from_png(const char *filename, GLuint target)
 
     png_read_update_info(png, infos);
 
-    row_pointers = new png_bytep[height];
-    png_byte *data = new png_byte[height * png_get_rowbytes(png, infos)];
-
+    size_t stride = png_get_rowbytes(png, infos);
+    image.data.resize(height * stride);
+    row_pointers.resize(height);
     for (int i = 0; i < height; i++)
     {
-        row_pointers[i] = data + i * png_get_rowbytes(png, infos);
+        row_pointers[i] = image.data.data() + i * stride;
     }
 
-    png_read_image(png, row_pointers);
+    png_read_image(png, row_pointers.data());
 
-    if (target == GL_TEXTURE_CUBE_MAP)
-    {
-        if (!load_data_as_cubemap(data, width, height,
-            png_get_channels(png, infos)))
-        {
-            png_destroy_read_struct(&png, &infos, NULL);
-            delete[] row_pointers;
-            delete[] data;
-            fclose(fp);
-            return false;
-        }
-    } else if (target == GL_TEXTURE_2D)
-    {
-        GL_CALL(glTexImage2D(target, 0, GL_RGBA, width, height, 0,
-            GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid*)data));
-    }
+    image.width    = width;
+    image.height   = height;
+    image.channels = png_get_channels(png, infos);
 
     png_destroy_read_struct(&png, &infos, NULL);
-    delete[] row_pointers;
-    delete[] data;
-
     fclose(fp);
 
     return true;
@@ -288,73 +285,55 @@ void texture_to_png(const char *name, uint8_t *pixels, int w, int h)
     delete[] rows;
 }
 
-bool texture_from_jpeg(const char *FileName, GLuint target)
+bool decode_jpeg(const char *FileName, image_t& image)
 {
-    unsigned long data_size;
     unsigned char *rowptr[1];
-    unsigned char *jdata;
     struct jpeg_decompress_struct infot;
     struct jpeg_error_mgr err;
 
     std::FILE *file = fopen(FileName, "rb");
-    infot.err = jpeg_std_error(&err);
-    jpeg_create_decompress(&infot);
-
     if (!file)
     {
-        LOGE("failed to read JPEG file ", FileName);
+        image.error = "failed to read JPEG file " + std::string(FileName);
 
         return false;
     }
 
+    infot.err = jpeg_std_error(&err);
+    jpeg_create_decompress(&infot);
+
     jpeg_stdio_src(&infot, file);
     jpeg_read_header(&infot, TRUE);
     jpeg_start_decompress(&infot);
 
-    data_size = infot.output_width * infot.output_height * 3;
-
-    jdata = new unsigned char [data_size];
+    image.width    = infot.output_width;
+    image.height   = infot.output_height;
+    image.channels = 3;
+    image.data.resize((size_t)image.width * image.height * 3);
     while (infot.output_scanline < infot.output_height)
     {
-        rowptr[0] = (unsigned char*)jdata + 3 * infot.output_width *
+        rowptr[0] = image.data.data() + 3 * infot.output_width *
             infot.output_scanline;
         jpeg_read_scanlines(&infot, rowptr, 1);
     }
 
     jpeg_finish_decompress(&infot);
-
-    GLint width  = infot.output_width;
-    GLint height = infot.output_height;
-
-    if (target == GL_TEXTURE_CUBE_MAP)
-    {
-        if (!load_data_as_cubemap(jdata, width, height, 3))
-        {
-            fclose(file);
-            delete[] jdata;
-            return false;
-        }
-    } else if (target == GL_TEXTURE_2D)
-    {
-        GL_CALL(glTexImage2D(target, 0, GL_RGB, width, height, 0,
-            GL_RGB, GL_UNSIGNED_BYTE, jdata));
-    }
-
+    jpeg_destroy_decompress(&infot);
     fclose(file);
-    delete[] jdata;
 
     return true;
 }
 
 #endif
 
-bool load_from_file(std::string name, GLuint target)
+bool decode_file(std::string name, image_t& image)
 {
+    image.error.clear();
     if (access(name.c_str(), F_OK) == -1)
     {
         if (!name.empty())
         {
-            LOGE(__func__, "() cannot access ", name);
+            image.error = "decode_file() cannot access " + name;
         }
 
         return false;
@@ -363,8 +342,8 @@ bool load_from_file(std::string name, GLuint target)
     int len = name.length();
     if ((len < 4) || (name[len - 4] != '.'))
     {
-        LOGE(
-            "load_from_file() called with file without extension or with invalid extension!");
+        image.error =
+            "decode_file() called with file without extension or with invalid extension!";
 
         return false;
     }
@@ -375,18 +354,54 @@ bool load_from_file(std::string name, GLuint target)
         ext[i] = std::tolower(ext[i]);
     }
 
-    auto it = loaders.find(ext);
-    if (it == loaders.end())
+    auto it = decoders.find(ext);
+    if (it == decoders.end())
     {
-        LOGE("load_from_file() called with unsupported extension ", ext);
+        image.error = "decode_file() called with unsupported extension " + ext;
 
         return false;
     } else
     {
-        return it->second(name.c_str(), target);
+        return it->second(name.c_str(), image);
     }
 }
 
+bool upload_to_texture(const image_t& image, GLuint target)
+{
+    if (!image.error.empty())
+    {
+        LOGE(image.error);
+
+        return false;
+    }
+
+    if (image.data.empty())
+    {
+        return false;
+    }
+
+    if (target == GL_TEXTURE_CUBE_MAP)
+    {
+        return load_data_as_cubemap(image.data.data(), image.width,
+            image.height, image.channels);
+    } else if (target == GL_TEXTURE_2D)
+    {
+        auto format = (image.channels == 4 ? GL_RGBA : GL_RGB);
+        GL_CALL(glTexImage2D(target, 0, format, image.width, image.height, 0,
+            format, GL_UNSIGNED_BYTE, image.data.data()));
+    }
+
+    return true;
+}
+
+bool load_from_file(std::string name, GLuint target)
+{
+    image_t image;
+    decode_file(name, image);
+
+    return upload_to_texture(image, target);
+}
+
 void write_to_file(std::string name, uint8_t *pixels, int w, int h, std::string type)
 {
     auto it = writers.find(type);
@@ -404,8 +419,8 @@ void init()
 {
     LOGD("init ImageIO");
 #ifdef BUILD_WITH_IMAGEIO
-    loaders["png"] = Loader(texture_from_png);
-    loaders["jpg"] = Loader(texture_from_jpeg);
+    decoders["png"] = Decoder(decode_png);
+    decoders["jpg"] = Decoder(decode_jpeg);
     writers["png"] = Writer(texture_to_png);
 #endif
 }
@@ -1,30 +1,134 @@
 #include "wayfire/object.hpp"
-#include "wayfire/nonstd/safe-list.hpp"
+#include <algorithm>
 #include <unordered_map>
-#include <set>
+#include <vector>
 
 /* Implementation note: because of circular dependencies between
  * signal_connection_t and signal_provider_t, the chosen way to resolve
  * them is to have signal_provider_t directly modify signal_connection_t
- * private data when needed. */
+ * private data when needed.
+ *
+ * Each provider keeps one slot per signal. A slot stores its connections in a
+ * vector, and each connection remembers where it is stored, so that it can
+ * be disconnected without searching for it. Disconnected entries are set to
+ * nullptr and removed later, when the slot is not being emitted. */
+
+namespace
+{
+struct signal_slot_t;
+
+/** A place where a connection is stored */
+struct connection_ref_t
+{
+    wf::signal_provider_t *provider;
+    signal_slot_t *slot;
+    size_t index;
+};
+
+struct signal_slot_t
+{
+    signal_slot_t(wf::signal_id_t id) : id(id)
+    {}
+
+    wf::signal_id_t id;
+    std::vector<wf::signal_connection_t*> connections;
+    /* Number of nullptr entries in connections */
+    size_t num_removed = 0;
+
+    /* Deprecated: */
+    std::vector<wf::signal_callback_t*> deprecated;
+    bool deprecated_removed = false;
+
+    /* Number of emissions of the signal in progress */
+    int emitting = 0;
+
+    /** Remove the connection at the given index */
+    void remove_at(size_t index);
+    /** Remove the nullptr entries left by disconnected connections */
+    void compact();
+    /** Called when an emission of the signal ends */
+    void finish_emit();
+};
+}
 
 class wf::signal_connection_t::impl
 {
   public:
     signal_callback_t callback;
-    std::set<nonstd::observer_ptr<signal_provider_t>> connected_providers;
+    std::vector<connection_ref_t> refs;
 
-    void add(signal_provider_t *provider)
+    connection_ref_t& find(signal_slot_t *slot, size_t index)
     {
-        connected_providers.insert(provider);
+        return *std::find_if(refs.begin(), refs.end(), [=] (auto& ref)
+        {
+            return ref.slot == slot && ref.index == index;
+        });
     }
 
-    void remove(signal_provider_t *provider)
+    void remove(signal_slot_t *slot, size_t index)
     {
-        connected_providers.erase(provider);
+        auto& ref = find(slot, index);
+        ref = refs.back();
+        refs.pop_back();
     }
 };
 
+void signal_slot_t::remove_at(size_t index)
+{
+    connections[index]->priv->remove(this, index);
+    connections[index] = nullptr;
+    ++num_removed;
+
+    if (!emitting && (num_removed * 2 >= connections.size()))
+    {
+        compact();
+    }
+}
+
+void signal_slot_t::compact()
+{
+    size_t j = 0;
+    for (size_t i = 0; i < connections.size(); i++)
+    {
+        auto connection = connections[i];
+        if (!connection)
+        {
+            continue;
+        }
+
+        if (i != j)
+        {
+            connection->priv->find(this, i).index = j;
+            connections[j] = connection;
+        }
+
+        ++j;
+    }
+
+    connections.resize(j);
+    num_removed = 0;
+}
+
+void signal_slot_t::finish_emit()
+{
+    if (--emitting > 0)
+    {
+        return;
+    }
+
+    if (num_removed && (num_removed * 2 >= connections.size()))
+    {
+        compact();
+    }
+
+    if (deprecated_removed)
+    {
+        deprecated.erase(std::remove(deprecated.begin(), deprecated.end(),
+            nullptr), deprecated.end());
+        deprecated_removed = false;
+    }
+}
+
 wf::signal_connection_t::signal_connection_t()
 {
     this->priv = std::make_unique<impl>();
@@ -50,21 +154,46 @@ void wf::signal_connection_t::emit(signal_data_t *data)
 
 void wf::signal_connection_t::disconnect()
 {
-    auto connected = this->priv->connected_providers;
-    for (auto& provider : connected)
+    while (!priv->refs.empty())
     {
-        provider->disconnect_signal(this);
+        auto ref = priv->refs.back();
+        ref.slot->remove_at(ref.index);
     }
 }
 
 class wf::signal_provider_t::sprovider_impl
 {
   public:
-    std::unordered_map<std::string,
-        wf::safe_list_t<signal_connection_t*>> signals;
+    /* The IDs are kept apart from the slots, so that looking up a slot goes
+     * through contiguous memory. */
+    std::vector<signal_id_t> slot_ids;
+    std::vector<std::unique_ptr<signal_slot_t>> slots;
+
+    signal_slot_t *find_slot(signal_id_t id)
+    {
+        for (size_t i = 0; i < slot_ids.size(); i++)
+        {
+            if (slot_ids[i] == id)
+            {
+                return slots[i].get();
+            }
+        }
+
+        return nullptr;
+    }
 
-    std::unordered_map<std::string,
-        wf::safe_list_t<signal_callback_t*>> deprecated_signals;
+    signal_slot_t *get_slot(signal_id_t id)
+    {
+        if (auto slot = find_slot(id))
+        {
+            return slot;
+        }
+
+        slot_ids.push_back(id);
+        slots.push_back(std::make_unique<signal_slot_t>(id));
+
+        return slots.back().get();
+    }
 };
 
 wf::signal_provider_t::signal_provider_t()
@@ -74,37 +203,50 @@ wf::signal_provider_t::signal_provider_t()
 
 wf::signal_provider_t::~signal_provider_t()
 {
-    for (auto& s : sprovider_priv->signals)
+    for (auto& slot : sprovider_priv->slots)
     {
-        s.second.for_each([=] (signal_connection_t *connection)
+        for (auto connection : slot->connections)
         {
-            connection->priv->remove(this);
-        });
+            if (!connection)
+            {
+                continue;
+            }
+
+            auto& refs = connection->priv->refs;
+            refs.erase(std::remove_if(refs.begin(), refs.end(), [&] (auto& ref)
+            {
+                return ref.slot == slot.get();
+            }), refs.end());
+        }
     }
 }
 
 void wf::signal_provider_t::connect_signal(std::string name,
     signal_connection_t *callback)
 {
-    sprovider_priv->signals[name].push_back(callback);
-    callback->priv->add(this);
+    connect_signal(signal_id_t{name}, callback);
+}
+
+void wf::signal_provider_t::connect_signal(signal_id_t id,
+    signal_connection_t *callback)
+{
+    auto slot = sprovider_priv->get_slot(id);
+    slot->connections.push_back(callback);
+    callback->priv->refs.push_back({this, slot, slot->connections.size() - 1});
 }
 
 void wf::signal_provider_t::disconnect_signal(signal_connection_t *connection)
 {
-    for (auto& s : sprovider_priv->signals)
+    /* remove_at() replaces the removed ref with the last one, which has
+     * already been visited */
+    auto& refs = connection->priv->refs;
+    for (size_t i = refs.size(); i-- > 0;)
     {
-        s.second.remove_if([=] (signal_connection_t *connected)
+        if (refs[i].provider == this)
         {
-            if (connected == connection)
-            {
-                connected->priv->remove(this);
-
-                return true;
-            }
-
-            return false;
-        });
+            auto ref = refs[i];
+            ref.slot->remove_at(ref.index);
+        }
     }
 }
 
@@ -112,29 +254,68 @@ void wf::signal_provider_t::disconnect_signal(signal_connection_t *connection)
 void wf::signal_provider_t::connect_signal(std::string name,
     signal_callback_t *callback)
 {
-    sprovider_priv->deprecated_signals[name].push_back(callback);
+    sprovider_priv->get_slot(signal_id_t{name})->deprecated.push_back(callback);
 }
 
 /* Deprecated: */
 void wf::signal_provider_t::disconnect_signal(std::string name,
     signal_callback_t *callback)
 {
-    sprovider_priv->deprecated_signals[name].remove_all(callback);
+    auto slot = sprovider_priv->find_slot(signal_id_t{name});
+    if (!slot)
+    {
+        return;
+    }
+
+    if (slot->emitting)
+    {
+        std::replace(slot->deprecated.begin(), slot->deprecated.end(),
+            callback, (signal_callback_t*)nullptr);
+        slot->deprecated_removed = true;
+    } else
+    {
+        slot->deprecated.erase(std::remove(slot->deprecated.begin(),
+            slot->deprecated.end(), callback), slot->deprecated.end());
+    }
 }
 
 /* Emit the given signal. No type checking for data is required */
 void wf::signal_provider_t::emit_signal(std::string name, wf::signal_data_t *data)
 {
-    sprovider_priv->signals[name].for_each([data] (auto call)
+    emit_signal(signal_id_t{name}, data);
+}
+
+void wf::signal_provider_t::emit_signal(signal_id_t id, wf::signal_data_t *data)
+{
+    auto slot = sprovider_priv->find_slot(id);
+    if (!slot)
+    {
+        return;
+    }
+
+    /* Connections added during the emission are not called, and the entries
+     * of removed connections are kept until the emission ends. */
+    ++slot->emitting;
+    const size_t num_connections = slot->connections.size();
+    for (size_t i = 0; i < num_connections; i++)
     {
-        call->emit(data);
-    });
+        if (auto connection = slot->connections[i])
+        {
+            connection->emit(data);
+        }
+    }
 
     /* Deprecated: */
-    sprovider_priv->deprecated_signals[name].for_each([data] (auto call)
+    const size_t num_deprecated = slot->deprecated.size();
+    for (size_t i = 0; i < num_deprecated; i++)
     {
-        (*call)(data);
-    });
+        if (auto callback = slot->deprecated[i])
+        {
+            (*callback)(data);
+        }
+    }
+
+    slot->finish_emit();
 }
 
 class wf::object_base_t::obase_impl
@@ -1,5 +1,8 @@
 #include <wayfire/util/log.hpp>
+#include <array>
+#include <cstddef>
 #include <map>
+#include <unordered_map>
 #include "opengl-priv.hpp"
 #include "wayfire/output.hpp"
 #include "core-impl.hpp"
@@ -45,6 +48,31 @@ void gl_call(const char *func, uint32_t line, const char *glfunc)
 
 namespace OpenGL
 {
+/**
+ * Calculate the values of the builtin _wayfire_uv_base and _wayfire_uv_scale
+ * uniforms for the given texture.
+ */
+static void get_texture_uv_transform(const wf::texture_t& texture,
+    glm::vec2& base, glm::vec2& scale)
+{
+    base  = {0.0f, 0.0f};
+    scale = {1.0f, 1.0f};
+
+    if (texture.has_viewport)
+    {
+        scale.x = texture.viewport_box.x2 - texture.viewport_box.x1;
+        scale.y = texture.viewport_box.y2 - texture.viewport_box.y1;
+        base.x  = texture.viewport_box.x1;
+        base.y  = texture.viewport_box.y1;
+    }
+
+    if (texture.invert_y)
+    {
+        scale.y *= -1;
+        base.y   = 1.0 - base.y;
+    }
+}
+
 /*
  * Different Context is kept for each output
  * Each of the following functions uses the currently bound context
@@ -92,16 +120,55 @@ GLuint compile_program(std::string vertex_source, std::string frag_source)
     return result_program;
 }
 
+namespace
+{
+/** A vertex of a textured quad, as stored in the vertex buffer */
+struct quad_vertex_t
+{
+    GLfloat x, y;
+    GLfloat u, v;
+};
+
+/** Uniform and attribute handles of the default program, resolved once. */
+struct default_program_handles_t
+{
+    uniform_t mvp;
+    uniform_t color;
+    attrib_t position;
+    attrib_t uv_position;
+} default_handles;
+
+/** Uniform and attribute handles of the color program */
+struct color_program_handles_t
+{
+    uniform_t mvp;
+    uniform_t color;
+    attrib_t position;
+} color_handles;
+
+/* Persistent vertex buffer for textured quads */
+GLuint quad_vbo = 0;
+size_t quad_vbo_capacity = 0;
+}
+
 void init()
 {
     render_begin();
     // enable_gl_synchronuous_debug()
     program.compile(default_vertex_shader_source,
         default_fragment_shader_source);
+    default_handles.mvp   = program.get_uniform("MVP");
+    default_handles.color = program.get_uniform("color");
+    default_handles.position    = program.get_attrib("position");
+    default_handles.uv_position = program.get_attrib("uvPosition");
 
     color_program.set_simple(compile_program(default_vertex_shader_source,
         color_rect_fragment_source));
+    color_handles.mvp   = color_program.get_uniform("MVP");
+    color_handles.color = color_program.get_uniform("color");
+    color_handles.position = color_program.get_attrib("position");
 
+    GL_CALL(glGenBuffers(1, &quad_vbo));
     render_end();
 }
 
@@ -110,9 +177,84 @@ void fini()
     render_begin();
     program.free_resources();
     color_program.free_resources();
+    GL_CALL(glDeleteBuffers(1, &quad_vbo));
+    quad_vbo = 0;
+    quad_vbo_capacity = 0;
     render_end();
 }
 
+namespace
+{
+/* Cached blending state, -1 means unknown */
+int cached_blend_enabled = -1;
+GLenum cached_blend_sfactor = 0;
+GLenum cached_blend_dfactor = 0;
+}
+
+void set_blend_state(bool enabled, GLenum sfactor, GLenum dfactor)
+{
+    if (cached_blend_enabled != (int)enabled)
+    {
+        if (enabled)
+        {
+            GL_CALL(glEnable(GL_BLEND));
+        } else
+        {
+            GL_CALL(glDisable(GL_BLEND));
+        }
+
+        cached_blend_enabled = enabled;
+    }
+
+    if (enabled &&
+        ((cached_blend_sfactor != sfactor) || (cached_blend_dfactor != dfactor)))
+    {
+        GL_CALL(glBlendFunc(sfactor, dfactor));
+        cached_blend_sfactor = sfactor;
+        cached_blend_dfactor = dfactor;
+    }
+}
+
+void invalidate_state_cache()
+{
+    cached_blend_enabled = -1;
+    cached_blend_sfactor = 0;
+    cached_blend_dfactor = 0;
+}
+
+/**
+ * Upload the given vertices to the persistent quad vertex buffer and set up
+ * the attributes of the default program. The buffer stays bound until
+ * unbind_quad_vertices() is called.
+ */
+static void upload_quad_vertices(const quad_vertex_t *vertices, size_t count)
+{
+    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, quad_vbo));
+    size_t size = count * sizeof(quad_vertex_t);
+    if (size > quad_vbo_capacity)
+    {
+        quad_vbo_capacity = std::max(size, 2 * quad_vbo_capacity);
+    }
+
+    /* Orphan the old storage, so that the driver doesn't have to wait for
+     * draws which still read from it before the update */
+    GL_CALL(glBufferData(GL_ARRAY_BUFFER, quad_vbo_capacity, NULL,
+        GL_STREAM_DRAW));
+    GL_CALL(glBufferSubData(GL_ARRAY_BUFFER, 0, size, vertices));
+
+    program.attrib_pointer(default_handles.position, 2, sizeof(quad_vertex_t),
+        (void*)offsetof(quad_vertex_t, x));
+    program.attrib_pointer(default_handles.uv_position, 2, sizeof(quad_vertex_t),
+        (void*)offsetof(quad_vertex_t, u));
+}
+
+/** Unbind the quad vertex buffer and deactivate the default program. */
+static void unbind_quad_vertices()
+{
+    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    program.deactivate();
+}
+
 namespace
 {
 wf::output_t *current_output = NULL;
@@ -131,9 +273,6 @@ void unbind_output(wf::output_t *output)
     current_output_fb = 0;
 }
 
-std::vector<GLfloat> vertexData;
-std::vector<GLfloat> coordData;
-
 void render_transformed_texture(wf::texture_t tex,
     const gl_geometry& g, const gl_geometry& texg,
     glm::mat4 model, glm::vec4 color, uint32_t bits)
@@ -143,13 +282,6 @@ void render_transformed_texture(wf::texture_t tex,
 
     program.use(tex.type);
 
-    vertexData = {
-        g.x1, g.y2,
-        g.x2, g.y2,
-        g.x2, g.y1,
-        g.x1, g.y1,
-    };
-
     gl_geometry final_texg = (bits & TEXTURE_USE_TEX_GEOMETRY) ?
         texg : gl_geometry{0.0f, 0.0f, 1.0f, 1.0f};
 
@@ -165,21 +297,19 @@ void render_transformed_texture(wf::texture_t tex,
         final_texg.x2 = 1.0 - final_texg.x2;
     }
 
-    coordData = {
-        final_texg.x1, final_texg.y1,
-        final_texg.x2, final_texg.y1,
-        final_texg.x2, final_texg.y2,
-        final_texg.x1, final_texg.y2,
+    const quad_vertex_t vertices[] = {
+        {g.x1, g.y2, final_texg.x1, final_texg.y1},
+        {g.x2, g.y2, final_texg.x2, final_texg.y1},
+        {g.x2, g.y1, final_texg.x2, final_texg.y2},
+        {g.x1, g.y1, final_texg.x1, final_texg.y2},
     };
 
     program.set_active_texture(tex);
-    program.attrib_pointer("position", 2, 0, vertexData.data());
-    program.attrib_pointer("uvPosition", 2, 0, coordData.data());
-    program.uniformMatrix4f("MVP", model);
-    program.uniform4f("color", color);
+    upload_quad_vertices(vertices, 4);
+    program.uniformMatrix4f(default_handles.mvp, model);
+    program.uniform4f(default_handles.color, color);
 
-    GL_CALL(glEnable(GL_BLEND));
-    GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+    set_blend_state(true);
 
     if (bits & RENDER_FLAG_CACHED)
     {
@@ -198,6 +328,137 @@ void draw_cached()
 void clear_cached()
 {
     disable_gl_call = false;
+    unbind_quad_vertices();
+}
+
+namespace
+{
+/** The state of the current batch, see batch_begin() */
+struct quad_batch_t
+{
+    bool active = false;
+    glm::mat4 projection;
+
+    /* Parameters of the quads in the vertex list */
+    wf::texture_t texture;
+    glm::vec4 color;
+    uint32_t bits = 0;
+
+    std::vector<quad_vertex_t> vertices;
+} batch;
+
+bool same_texture(const wf::texture_t& a, const wf::texture_t& b)
+{
+    return a.type == b.type && a.target == b.target && a.tex_id == b.tex_id &&
+           a.invert_y == b.invert_y && a.has_viewport == b.has_viewport &&
+           (!a.has_viewport ||
+            (a.viewport_box.x1 == b.viewport_box.x1 &&
+             a.viewport_box.y1 == b.viewport_box.y1 &&
+             a.viewport_box.x2 == b.viewport_box.x2 &&
+             a.viewport_box.y2 == b.viewport_box.y2));
+}
+
+/** Draw all quads collected so far in a single draw call */
+void flush_batch()
+{
+    if (batch.vertices.empty())
+    {
+        return;
+    }
+
+    program.use(batch.texture.type);
+    program.set_active_texture(batch.texture);
+    upload_quad_vertices(batch.vertices.data(), batch.vertices.size());
+    program.uniformMatrix4f(default_handles.mvp, batch.projection);
+    program.uniform4f(default_handles.color, batch.color);
+
+    set_blend_state(true);
+    GL_CALL(glDrawArrays(GL_TRIANGLES, 0, batch.vertices.size()));
+    unbind_quad_vertices();
+
+    batch.vertices.clear();
+}
+}
+
+void batch_begin(const wf::framebuffer_t& fb)
+{
+    assert(!batch.active);
+    batch.active     = true;
+    batch.projection = fb.get_orthographic_projection();
+    batch.vertices.clear();
+}
+
+void batch_texture(const wf::texture_t& texture, const wf::geometry_t& geometry,
+    const wf::region_t& damage, glm::vec4 color, uint32_t bits)
+{
+    assert(batch.active);
+    if ((geometry.width <= 0) || (geometry.height <= 0))
+    {
+        return;
+    }
+
+    bits &= TEXTURE_TRANSFORM_INVERT_X | TEXTURE_TRANSFORM_INVERT_Y;
+    if (!batch.vertices.empty() &&
+        (!same_texture(texture, batch.texture) ||
+         (color != batch.color) || (bits != batch.bits)))
+    {
+        flush_batch();
+    }
+
+    batch.texture = texture;
+    batch.color   = color;
+    batch.bits    = bits;
+
+    const float gx1 = geometry.x;
+    const float gy1 = geometry.y;
+    const float gx2 = geometry.x + geometry.width;
+    const float gy2 = geometry.y + geometry.height;
+
+    /* Texture coordinates are the same as in render_transformed_texture():
+     * (0, 0) corresponds to the lower-left corner of the quad. */
+    auto make_vertex = [&] (float x, float y)
+    {
+        float u = (x - gx1) / geometry.width;
+        float v = (gy2 - y) / geometry.height;
+        if (bits & TEXTURE_TRANSFORM_INVERT_X)
+        {
+            u = 1.0 - u;
+        }
+
+        if (bits & TEXTURE_TRANSFORM_INVERT_Y)
+        {
+            v = 1.0 - v;
+        }
+
+        return quad_vertex_t{x, y, u, v};
+    };
+
+    for (const auto& rect : damage)
+    {
+        /* Clip the quad to the damaged rectangle instead of scissoring */
+        const float x1 = std::max<float>(rect.x1, gx1);
+        const float y1 = std::max<float>(rect.y1, gy1);
+        const float x2 = std::min<float>(rect.x2, gx2);
+        const float y2 = std::min<float>(rect.y2, gy2);
+        if ((x1 >= x2) || (y1 >= y2))
+        {
+            continue;
+        }
+
+        batch.vertices.push_back(make_vertex(x1, y1));
+        batch.vertices.push_back(make_vertex(x2, y1));
+        batch.vertices.push_back(make_vertex(x2, y2));
+        batch.vertices.push_back(make_vertex(x1, y1));
+        batch.vertices.push_back(make_vertex(x2, y2));
+        batch.vertices.push_back(make_vertex(x1, y2));
+    }
+}
+
+void batch_end()
+{
+    assert(batch.active);
+    flush_batch();
+    batch.active = false;
     program.deactivate();
 }
 
@@ -237,12 +498,12 @@ void render_rectangle(wf::geometry_t geometry, wf::color_t color,
         x, y,
     };
 
-    color_program.attrib_pointer("position", 2, 0, vertexData);
-    color_program.uniformMatrix4f("MVP", matrix);
-    color_program.uniform4f("color", {color.r, color.g, color.b, color.a});
+    color_program.attrib_pointer(color_handles.position, 2, 0, vertexData);
+    color_program.uniformMatrix4f(color_handles.mvp, matrix);
+    color_program.uniform4f(color_handles.color,
+        {color.r, color.g, color.b, color.a});
 
-    GL_CALL(glEnable(GL_BLEND));
-    GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+    set_blend_state(true);
     GL_CALL(glDrawArrays(GL_TRIANGLE_FAN, 0, 4));
 
     color_program.deactivate();
@@ -255,8 +516,9 @@ void render_begin()
         wlr_egl_make_current(wf::get_core_impl().egl);
     }
 
-    GL_CALL(glEnable(GL_BLEND));
-    GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+    /* Plugins may have changed the state directly since the last block */
+    invalidate_state_cache();
+    set_blend_state(true);
 }
 
 void render_begin(const wf::framebuffer_base_t& fb)
@@ -574,46 +836,162 @@ namespace OpenGL
 class program_t::impl
 {
   public:
-    std::set<int> active_attrs;
-    std::set<int> active_attrs_divisors;
+    /** Vertex attribute locations enabled by attrib_pointer(), as a bitmask */
+    uint64_t active_attrs = 0;
+    /** Vertex attribute locations with a divisor set by attrib_divisor() */
+    uint64_t active_attrs_divisors = 0;
 
     int active_program_idx = 0;
 
     int id[wf::TEXTURE_TYPE_ALL];
-    std::unordered_map<std::string, int> uniforms[wf::TEXTURE_TYPE_ALL];
 
-    /** Find the uniform location for the currently bound program */
-    int find_uniform_loc(const std::string& name)
+    /**
+     * The uniforms or attributes which were resolved so far. Each entry is
+     * a handle index, and its location is stored for every texture type, so
+     * that handles stay valid when the program is recompiled.
+     */
+    struct location_table_t
     {
-        auto it = uniforms[active_program_idx].find(name);
-        if (it != uniforms[active_program_idx].end())
+        std::vector<std::string> names;
+        std::vector<std::array<int, wf::TEXTURE_TYPE_ALL>> locations;
+        std::unordered_map<uint32_t, int> by_hash;
+        /* The handle index and the hash of each hashed_name_t seen so far,
+         * by the address of its name */
+        std::unordered_map<const char*, std::pair<uint32_t, int>> by_pointer;
+    };
+
+    location_table_t uniforms;
+    location_table_t attribs;
+
+    /* Handles of the builtin uniforms used by set_active_texture() */
+    uniform_t uv_base;
+    uniform_t uv_scale;
+    bool builtins_resolved = false;
+
+    int get_location(bool uniform, int program_id, const std::string& name)
+    {
+        if (program_id == 0)
         {
-            return it->second;
+            return -1;
         }
 
-        uniforms[active_program_idx][name] =
-            GL_CALL(glGetUniformLocation(id[active_program_idx], name.c_str()));
+        return uniform ?
+               GL_CALL(glGetUniformLocation(program_id, name.c_str())) :
+               GL_CALL(glGetAttribLocation(program_id, name.c_str()));
+    }
+
+    /** Add a handle index for the given name and resolve its locations */
+    int resolve(location_table_t& table, bool uniform, const std::string& name,
+        uint32_t hash)
+    {
+        int index = table.names.size();
+        table.names.push_back(name);
+        table.locations.emplace_back();
+        for (int i = 0; i < wf::TEXTURE_TYPE_ALL; i++)
+        {
+            table.locations[index][i] = get_location(uniform, id[i], name);
+        }
+
+        auto [hash_it, inserted] = table.by_hash.emplace(hash, index);
+        if (!inserted)
+        {
+            LOGE("Hash collision between program_t names ", name, " and ",
+                table.names[hash_it->second]);
+        }
 
-        return uniforms[active_program_idx][name];
+        return index;
     }
 
-    std::map<std::string, int> attribs[wf::TEXTURE_TYPE_ALL];
-    /** Find the attrib location for the currently bound program */
-    int find_attrib_loc(const std::string& name)
+    /** Find the handle index for the given name, resolving it if needed */
+    int find_or_resolve(location_table_t& table, bool uniform,
+        hashed_name_t name)
     {
-        auto it = attribs[active_program_idx].find(name);
-        if (it != attribs[active_program_idx].end())
+        auto it = table.by_hash.find(name.hash);
+        if (it == table.by_hash.end())
+        {
+            return resolve(table, uniform, name.name, name.hash);
+        }
+
+        if (table.names[it->second] == name.name)
         {
             return it->second;
         }
 
-        attribs[active_program_idx][name] =
-            GL_CALL(glGetAttribLocation(id[active_program_idx], name.c_str()));
+        /* Hash collision, the name is not in by_hash */
+        for (size_t index = 0; index < table.names.size(); index++)
+        {
+            if (table.names[index] == name.name)
+            {
+                return index;
+            }
+        }
+
+        return resolve(table, uniform, name.name, name.hash);
+    }
+
+    /**
+     * Same as find_or_resolve(), but remembers the result by the address of
+     * the name, so that using the same name again needs no string compare.
+     */
+    int resolve_hashed(location_table_t& table, bool uniform, hashed_name_t name)
+    {
+        auto it = table.by_pointer.find(name.name);
+        if ((it != table.by_pointer.end()) && (it->second.first == name.hash))
+        {
+            return it->second.second;
+        }
+
+        int index = find_or_resolve(table, uniform, name);
+        table.by_pointer[name.name] = {name.hash, index};
+
+        return index;
+    }
+
+    /** Re-resolve all known locations after the programs have changed */
+    void refresh_locations()
+    {
+        auto refresh = [&] (location_table_t& table, bool uniform)
+        {
+            for (size_t index = 0; index < table.names.size(); index++)
+            {
+                for (int i = 0; i < wf::TEXTURE_TYPE_ALL; i++)
+                {
+                    table.locations[index][i] =
+                        get_location(uniform, id[i], table.names[index]);
+                }
+            }
+        };
+
+        refresh(uniforms, true);
+        refresh(attribs, false);
+    }
+
+    int uniform_loc(uniform_t uniform)
+    {
+        if (uniform.index < 0)
+        {
+            return -1;
+        }
+
+        return uniforms.locations[uniform.index][active_program_idx];
+    }
+
+    int attrib_loc(attrib_t attrib)
+    {
+        if (attrib.index < 0)
+        {
+            return -1;
+        }
 
-        return attribs[active_program_idx][name];
+        return attribs.locations[attrib.index][active_program_idx];
     }
 };
 
+static uint32_t hash_name(const std::string& name)
+{
+    return hash_name(name.c_str(), name.length());
+}
+
 program_t::program_t()
 {
     this->priv = std::make_unique<impl>();
@@ -628,6 +1006,7 @@ void program_t::set_simple(GLuint program_id, wf::texture_type_t type)
     free_resources();
     assert(type < wf::TEXTURE_TYPE_ALL);
     this->priv->id[type] = program_id;
+    this->priv->refresh_locations();
 }
 
 program_t::~program_t()
@@ -674,6 +1053,8 @@ void program_t::compile(const std::string& vertex_source,
         this->priv->id[program_type.first] =
             compile_program(vertex_source, fragment);
     }
+
+    this->priv->refresh_locations();
 }
 
 void program_t::free_resources()
@@ -705,100 +1086,171 @@ int program_t::get_program_id(wf::texture_type_t type)
     return priv->id[type];
 }
 
+uniform_t program_t::get_uniform(const std::string& name)
+{
+    /* The string may not outlive the call, so its address isn't remembered */
+    return {priv->find_or_resolve(priv->uniforms, true,
+        hashed_name_t{name.c_str(), hash_name(name)})};
+}
+
+uniform_t program_t::get_uniform(hashed_name_t name)
+{
+    return {priv->resolve_hashed(priv->uniforms, true, name)};
+}
+
+attrib_t program_t::get_attrib(const std::string& name)
+{
+    return {priv->find_or_resolve(priv->attribs, false,
+        hashed_name_t{name.c_str(), hash_name(name)})};
+}
+
+attrib_t program_t::get_attrib(hashed_name_t name)
+{
+    return {priv->resolve_hashed(priv->attribs, false, name)};
+}
+
+void program_t::uniform1i(uniform_t uniform, int value)
+{
+    GL_CALL(glUniform1i(priv->uniform_loc(uniform), value));
+}
+
+void program_t::uniform1f(uniform_t uniform, float value)
+{
+    GL_CALL(glUniform1f(priv->uniform_loc(uniform), value));
+}
+
+void program_t::uniform2f(uniform_t uniform, float x, float y)
+{
+    GL_CALL(glUniform2f(priv->uniform_loc(uniform), x, y));
+}
+
+void program_t::uniform3f(uniform_t uniform, float x, float y, float z)
+{
+    GL_CALL(glUniform3f(priv->uniform_loc(uniform), x, y, z));
+}
+
+void program_t::uniform4f(uniform_t uniform, const glm::vec4& value)
+{
+    GL_CALL(glUniform4f(priv->uniform_loc(uniform),
+        value.r, value.g, value.b, value.a));
+}
+
+void program_t::uniformMatrix4f(uniform_t uniform, const glm::mat4& value)
+{
+    GL_CALL(glUniformMatrix4fv(priv->uniform_loc(uniform), 1, GL_FALSE,
+        &value[0][0]));
+}
+
 void program_t::uniform1i(const std::string& name, int value)
 {
-    int loc = priv->find_uniform_loc(name);
-    GL_CALL(glUniform1i(loc, value));
+    uniform1i(get_uniform(name), value);
 }
 
 void program_t::uniform1f(const std::string& name, float value)
 {
-    int loc = priv->find_uniform_loc(name);
-    GL_CALL(glUniform1f(loc, value));
+    uniform1f(get_uniform(name), value);
 }
 
 void program_t::uniform2f(const std::string& name, float x, float y)
 {
-    int loc = priv->find_uniform_loc(name);
-    GL_CALL(glUniform2f(loc, x, y));
+    uniform2f(get_uniform(name), x, y);
 }
 
 void program_t::uniform3f(const std::string& name, float x, float y, float z)
 {
-    int loc = priv->find_uniform_loc(name);
-    GL_CALL(glUniform3f(loc, x, y, z));
+    uniform3f(get_uniform(name), x, y, z);
 }
 
 void program_t::uniform4f(const std::string& name, const glm::vec4& value)
 {
-    int loc = priv->find_uniform_loc(name);
-    GL_CALL(glUniform4f(loc, value.r, value.g, value.b, value.a));
+    uniform4f(get_uniform(name), value);
 }
 
 void program_t::uniformMatrix4f(const std::string& name, const glm::mat4& value)
 {
-    int loc = priv->find_uniform_loc(name);
-    GL_CALL(glUniformMatrix4fv(loc, 1, GL_FALSE, &value[0][0]));
+    uniformMatrix4f(get_uniform(name), value);
 }
 
-void program_t::attrib_pointer(const std::string& attrib,
+void program_t::attrib_pointer(attrib_t attrib,
     int size, int stride, const void *ptr, GLenum type)
 {
-    int loc = priv->find_attrib_loc(attrib);
-    priv->active_attrs.insert(loc);
+    int loc = priv->attrib_loc(attrib);
+    if (loc < 0)
+    {
+        return;
+    }
+
+    assert(loc < 64);
+    priv->active_attrs |= (uint64_t(1) << loc);
 
     GL_CALL(glEnableVertexAttribArray(loc));
     GL_CALL(glVertexAttribPointer(loc, size, type, GL_FALSE, stride, ptr));
 }
 
-void program_t::attrib_divisor(const std::string& attrib, int divisor)
+void program_t::attrib_pointer(const std::string& attrib,
+    int size, int stride, const void *ptr, GLenum type)
+{
+    attrib_pointer(get_attrib(attrib), size, stride, ptr, type);
+}
+
+void program_t::attrib_divisor(attrib_t attrib, int divisor)
 {
-    int loc = priv->find_attrib_loc(attrib);
-    priv->active_attrs_divisors.insert(loc);
+    int loc = priv->attrib_loc(attrib);
+    if (loc < 0)
+    {
+        return;
+    }
+
+    assert(loc < 64);
+    priv->active_attrs_divisors |= (uint64_t(1) << loc);
     GL_CALL(glVertexAttribDivisor(loc, divisor));
 }
 
+void program_t::attrib_divisor(const std::string& attrib, int divisor)
+{
+    attrib_divisor(get_attrib(attrib), divisor);
+}
+
 void program_t::set_active_texture(const wf::texture_t& texture)
 {
     GL_CALL(glActiveTexture(GL_TEXTURE0));
     GL_CALL(glBindTexture(texture.target, texture.tex_id));
     GL_CALL(glTexParameteri(texture.target, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
 
-    glm::vec2 base{0.0f, 0.0f};
-    glm::vec2 scale{1.0f, 1.0f};
+    glm::vec2 base, scale;
+    get_texture_uv_transform(texture, base, scale);
 
-    if (texture.has_viewport)
+    if (!priv->builtins_resolved)
     {
-        scale.x = texture.viewport_box.x2 - texture.viewport_box.x1;
-        scale.y = texture.viewport_box.y2 - texture.viewport_box.y1;
-        base.x  = texture.viewport_box.x1;
-        base.y  = texture.viewport_box.y1;
+        priv->uv_base  = get_uniform("_wayfire_uv_base");
+        priv->uv_scale = get_uniform("_wayfire_uv_scale");
+        priv->builtins_resolved = true;
     }
 
-    if (texture.invert_y)
-    {
-        scale.y *= -1;
-        base.y   = 1.0 - base.y;
-    }
-
-    uniform2f("_wayfire_uv_base", base.x, base.y);
-    uniform2f("_wayfire_uv_scale", scale.x, scale.y);
+    uniform2f(priv->uv_base, base.x, base.y);
+    uniform2f(priv->uv_scale, scale.x, scale.y);
 }
 
 void program_t::deactivate()
 {
-    for (int loc : priv->active_attrs_divisors)
+    for (int loc = 0; priv->active_attrs_divisors; loc++)
     {
-        GL_CALL(glVertexAttribDivisor(loc, 0));
+        if (priv->active_attrs_divisors & (uint64_t(1) << loc))
+        {
+            GL_CALL(glVertexAttribDivisor(loc, 0));
+            priv->active_attrs_divisors &= ~(uint64_t(1) << loc);
+        }
     }
 
-    for (int loc : priv->active_attrs)
+    for (int loc = 0; priv->active_attrs; loc++)
     {
-        GL_CALL(glDisableVertexAttribArray(loc));
+        if (priv->active_attrs & (uint64_t(1) << loc))
+        {
+            GL_CALL(glDisableVertexAttribArray(loc));
+            priv->active_attrs &= ~(uint64_t(1) << loc);
+        }
     }
 
-    priv->active_attrs_divisors.clear();
-    priv->active_attrs.clear();
     GL_CALL(glUseProgram(0));
 }
 }
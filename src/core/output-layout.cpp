@@ -9,9 +9,12 @@
 #include "../output/output-impl.hpp"
 #include "seat/seat.hpp"
 #include "seat/cursor.hpp"
+#include "output-lookup.hpp"
 #include "core-impl.hpp"
 
 #include <xf86drmMode.h>
+#include <algorithm>
+#include <cmath>
 #include <sstream>
 #include <cstring>
 #include <unordered_set>
@@ -630,19 +633,44 @@ struct output_layout_output_t
     wl_listener_wrapper on_frame;
     wlr_output *locked_cursors_on = NULL;
 
-    /** Render the output using texture as source */
+    /**
+     * The last buffer committed by the mirrored output, locked until a newer
+     * one is committed. Textures for it come from wlr_texture_from_buffer(),
+     * which reuses the texture of each swapchain buffer, and makes sure that
+     * it shows the buffer's current contents.
+     */
+    wlr_buffer *mirrored_buffer = NULL;
+    /* Whether the mirrored output has shown a new buffer since our last
+     * frame */
+    bool mirrored_has_new_frame = false;
+    wf::dimensions_t mirror_rendered_size = {0, 0};
+
+    /**
+     * Render the output using texture as source. The texture is scaled
+     * directly to the output's mode, keeping its aspect ratio.
+     */
     void render_output(wlr_texture *texture)
     {
         auto renderer = get_core().renderer;
         wlr_output_attach_render(handle, NULL);
         wlr_renderer_begin(renderer, handle->width, handle->height);
 
-        /* Project a box filling the whole screen */
         float projection[9], box[9];
         wlr_matrix_projection(projection, handle->width, handle->height,
             WL_OUTPUT_TRANSFORM_NORMAL);
 
-        wlr_box geometry = {0, 0, handle->width, handle->height};
+        double scale = std::min(1.0 * handle->width / texture->width,
+            1.0 * handle->height / texture->height);
+        int width  = std::round(texture->width * scale);
+        int height = std::round(texture->height * scale);
+        wlr_box geometry = {(handle->width - width) / 2,
+            (handle->height - height) / 2, width, height};
+        if ((width != handle->width) || (height != handle->height))
+        {
+            const float black[4] = {0, 0, 0, 1};
+            wlr_renderer_clear(renderer, black);
+        }
+
         wlr_matrix_project_box(box, &geometry, WL_OUTPUT_TRANSFORM_NORMAL,
             0.0, projection);
 
@@ -664,22 +692,48 @@ struct output_layout_output_t
             return;
         }
 
-        wlr_dmabuf_attributes attributes;
-        if (!wlr_output_export_dmabuf(wo->handle, &attributes))
+        /* Nothing changed since the last frame, keep showing it */
+        wf::dimensions_t size = {handle->width, handle->height};
+        if (!mirrored_has_new_frame && (size == mirror_rendered_size))
         {
-            LOGE("Failed reading mirrored output contents from ", wo->handle);
+            return;
+        }
+
+        wlr_texture *texture = NULL;
+        if (mirrored_buffer)
+        {
+            texture = wlr_texture_from_buffer(get_core().renderer,
+                mirrored_buffer);
+        } else
+        {
+            /* The mirrored output hasn't committed since mirroring started,
+             * so export its current buffer */
+            wlr_dmabuf_attributes attributes;
+            if (!wlr_output_export_dmabuf(wo->handle, &attributes))
+            {
+                LOGE("Failed reading mirrored output contents from ",
+                    wo->handle->name);
+
+                return;
+            }
+
+            texture = wlr_texture_from_dmabuf(get_core().renderer, &attributes);
+            wlr_dmabuf_attributes_finish(&attributes);
+        }
+
+        if (!texture)
+        {
+            LOGE("Failed importing mirrored output contents from ",
+                wo->handle->name);
 
             return;
         }
 
-        /* We export the output to mirror from to a dmabuf, then create
-         * a texture from this and use it to render "our" output */
-        auto texture = wlr_texture_from_dmabuf(
-            get_core().renderer, &attributes);
         render_output(texture);
-
+        /* Textures of buffers are only released, and reused next time */
         wlr_texture_destroy(texture);
-        wlr_dmabuf_attributes_finish(&attributes);
+        mirrored_has_new_frame = false;
+        mirror_rendered_size   = size;
     }
 
     void set_enabled(bool enabled)
@@ -732,14 +786,23 @@ struct output_layout_output_t
         wlr_output_lock_software_cursors(wo->handle, true);
         locked_cursors_on = wo->handle;
 
+        mirrored_has_new_frame = true;
         wlr_output_schedule_frame(handle);
+        wlr_output *mirrored = wo->handle;
         on_mirrored_frame.set_callback([=] (void*)
         {
             /* The mirrored output was repainted, schedule repaint
-             * for us as well */
-            wlr_output_schedule_frame(handle);
+             * for us as well. Commits without a new buffer don't change
+             * what we show. */
+            if ((mirrored->pending.committed & WLR_OUTPUT_STATE_BUFFER) &&
+                mirrored->pending.buffer)
+            {
+                set_mirrored_buffer(mirrored->pending.buffer);
+                mirrored_has_new_frame = true;
+                wlr_output_schedule_frame(handle);
+            }
         });
-        on_mirrored_frame.connect(&wo->handle->events.precommit);
+        on_mirrored_frame.connect(&mirrored->events.precommit);
 
         on_frame.set_callback([=] (void*) { handle_frame(); });
         on_frame.connect(&handle->events.frame);
@@ -755,6 +818,23 @@ struct output_layout_output_t
 
         on_mirrored_frame.disconnect();
         on_frame.disconnect();
+        set_mirrored_buffer(NULL);
+        mirror_rendered_size = {0, 0};
+    }
+
+    void set_mirrored_buffer(wlr_buffer *buffer)
+    {
+        if (buffer)
+        {
+            wlr_buffer_lock(buffer);
+        }
+
+        if (mirrored_buffer)
+        {
+            wlr_buffer_unlock(mirrored_buffer);
+        }
+
+        mirrored_buffer = buffer;
     }
 
     wf::dimensions_t get_effective_size()
@@ -888,6 +968,31 @@ class output_layout_t::impl
      * virtual output with the noop backend. */
     std::unique_ptr<output_layout_output_t> noop_output;
 
+    /* Lookup of the outputs by position. It is rebuilt on the first query
+     * after the layout has changed, i.e. when layout_version has moved on. */
+    wl_listener_wrapper on_layout_change;
+    uint64_t layout_version = 1;
+    uint64_t lookup_version = 0;
+    output_lookup_t output_lookup;
+    std::vector<wlr_output*> lookup_outputs;
+
+    void rebuild_output_lookup()
+    {
+        std::vector<wf::geometry_t> boxes;
+        lookup_outputs.clear();
+
+        wlr_output_layout_output *l_output;
+        wl_list_for_each(l_output, &output_layout->outputs, link)
+        {
+            lookup_outputs.push_back(l_output->output);
+            boxes.push_back(
+                *wlr_output_layout_get_box(output_layout, l_output->output));
+        }
+
+        output_lookup.rebuild(std::move(boxes));
+        lookup_version = layout_version;
+    }
+
     signal_callback_t on_config_reload;
     signal_connection_t on_backend_started = [=] (wf::signal_data_t*)
     {
@@ -930,6 +1035,8 @@ class output_layout_t::impl
         on_backend_destroy.connect(&wf::get_core().renderer->events.destroy);
 
         output_layout = wlr_output_layout_create();
+        on_layout_change.set_callback([=] (void*) { ++layout_version; });
+        on_layout_change.connect(&output_layout->events.change);
 
         on_config_reload = [=] (void*) { reconfigure_from_config(); };
         get_core().connect_signal("reload-config", &on_config_reload);
@@ -1541,17 +1648,20 @@ class output_layout_t::impl
     wf::output_t *get_output_coords_at(const wf::pointf_t& origin,
         wf::pointf_t& closest)
     {
-        wlr_output_layout_closest_point(output_layout, NULL,
-            origin.x, origin.y, &closest.x, &closest.y);
+        if (lookup_version != layout_version)
+        {
+            rebuild_output_lookup();
+        }
 
-        auto handle =
-            wlr_output_layout_output_at(output_layout, closest.x, closest.y);
-        assert(handle || is_shutting_down());
-        if (!handle)
+        int index = output_lookup.find_closest(origin, closest);
+        assert(index >= 0 || is_shutting_down());
+        if (index < 0)
         {
             return nullptr;
         }
 
+        auto handle = lookup_outputs[index];
+
         if (noop_output && (handle == noop_output->handle))
         {
             return noop_output->output.get();
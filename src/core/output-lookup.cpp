@@ -0,0 +1,103 @@
+#include "output-lookup.hpp"
+#include <wayfire/nonstd/wlroots-full.hpp>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+/* The grid has at most about this many cells in each direction */
+static constexpr int MAX_GRID_CELLS = 32;
+static constexpr int MIN_CELL_SIZE  = 256;
+
+void wf::output_lookup_t::rebuild(std::vector<wf::geometry_t> boxes)
+{
+    this->boxes = std::move(boxes);
+    last_found  = -1;
+    has_overlaps = false;
+
+    wf::geometry_t extents = {0, 0, 0, 0};
+    for (size_t i = 0; i < this->boxes.size(); i++)
+    {
+        auto& box = this->boxes[i];
+        for (size_t j = 0; j < i; j++)
+        {
+            has_overlaps |= (box & this->boxes[j]);
+        }
+
+        if ((box.width <= 0) || (box.height <= 0))
+        {
+            continue;
+        }
+
+        if ((extents.width <= 0) || (extents.height <= 0))
+        {
+            extents = box;
+            continue;
+        }
+
+        int x2 = std::max(extents.x + extents.width, box.x + box.width);
+        int y2 = std::max(extents.y + extents.height, box.y + box.height);
+        extents.x = std::min(extents.x, box.x);
+        extents.y = std::min(extents.y, box.y);
+        extents.width  = x2 - extents.x;
+        extents.height = y2 - extents.y;
+    }
+
+    int cell_size = std::max(MIN_CELL_SIZE,
+        std::max(extents.width, extents.height) / MAX_GRID_CELLS);
+    grid = hit_test_grid_t{cell_size};
+    grid.rebuild(extents, this->boxes);
+}
+
+int wf::output_lookup_t::find_at(wf::pointf_t point)
+{
+    /* Without overlaps, a box containing the point is the only one */
+    if ((last_found >= 0) && !has_overlaps && (boxes[last_found] & point))
+    {
+        return last_found;
+    }
+
+    int found = grid.find_box_at(point, [] (int) { return true; });
+    if (found >= 0)
+    {
+        last_found = found;
+    }
+
+    return found;
+}
+
+int wf::output_lookup_t::find_closest(wf::pointf_t point,
+    wf::pointf_t& closest)
+{
+    int found = find_at(point);
+    if (found >= 0)
+    {
+        closest = point;
+        return found;
+    }
+
+    /* The point is outside of all outputs, for ex. in a gap between them. */
+    double min_distance = DBL_MAX;
+    for (size_t i = 0; i < boxes.size(); i++)
+    {
+        double x, y;
+        wlr_box_closest_point(&boxes[i], point.x, point.y, &x, &y);
+        double distance = (point.x - x) * (point.x - x) +
+            (point.y - y) * (point.y - y);
+        if (std::isfinite(distance) && (distance < min_distance))
+        {
+            min_distance = distance;
+            closest = {x, y};
+            found   = i;
+        }
+    }
+
+    if (found < 0)
+    {
+        closest = point;
+        return -1;
+    }
+
+    /* An earlier box may contain the closest point as well */
+    int at_closest = find_at(closest);
+    return at_closest >= 0 ? at_closest : found;
+}
@@ -0,0 +1,46 @@
+#ifndef WF_OUTPUT_LOOKUP_HPP
+#define WF_OUTPUT_LOOKUP_HPP
+
+#include <vector>
+#include <wayfire/geometry.hpp>
+#include "seat/hit-test-grid.hpp"
+
+namespace wf
+{
+/**
+ * Finds the output box at a point of the output layout.
+ *
+ * The boxes are kept in a hit_test_grid_t, which is rebuilt only when the
+ * layout changes, and the box found last is checked first, since consecutive
+ * input events are most often on the same output.
+ *
+ * The results are the same as those of wlr_output_layout_closest_point() and
+ * wlr_output_layout_output_at(): where boxes overlap, the one earlier in the
+ * layout wins.
+ */
+class output_lookup_t
+{
+  public:
+    /** @param boxes The boxes of the outputs, in layout order. */
+    void rebuild(std::vector<wf::geometry_t> boxes);
+
+    /** @return The index of the first box which contains @point, or -1. */
+    int find_at(wf::pointf_t point);
+
+    /**
+     * Find the box closest to @point.
+     *
+     * @param closest Set to the point in that box closest to @point.
+     * @return The index of the box, or -1 if there are no boxes.
+     */
+    int find_closest(wf::pointf_t point, wf::pointf_t& closest);
+
+  private:
+    std::vector<wf::geometry_t> boxes;
+    hit_test_grid_t grid;
+    bool has_overlaps = false;
+    int last_found    = -1;
+};
+}
+
+#endif /* end of include guard: WF_OUTPUT_LOOKUP_HPP */
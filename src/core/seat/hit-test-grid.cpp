@@ -0,0 +1,75 @@
+#include "hit-test-grid.hpp"
+#include <algorithm>
+#include <cmath>
+
+wf::hit_test_grid_t::hit_test_grid_t(int cell_size) : cell_size(cell_size)
+{}
+
+template<class Callback>
+void wf::hit_test_grid_t::for_each_cell(wf::geometry_t box,
+    Callback callback) const
+{
+    int x1 = std::max(box.x, area.x) - area.x;
+    int y1 = std::max(box.y, area.y) - area.y;
+    int x2 = std::min(box.x + box.width, area.x + area.width) - area.x;
+    int y2 = std::min(box.y + box.height, area.y + area.height) - area.y;
+    if ((x1 >= x2) || (y1 >= y2))
+    {
+        return;
+    }
+
+    for (int row = y1 / cell_size; row <= (y2 - 1) / cell_size; row++)
+    {
+        for (int col = x1 / cell_size; col <= (x2 - 1) / cell_size; col++)
+        {
+            callback(row * columns + col);
+        }
+    }
+}
+
+void wf::hit_test_grid_t::rebuild(wf::geometry_t area,
+    std::vector<wf::geometry_t> boxes)
+{
+    this->area  = area;
+    this->boxes = std::move(boxes);
+    columns = std::max(0, (area.width + cell_size - 1) / cell_size);
+    rows    = std::max(0, (area.height + cell_size - 1) / cell_size);
+
+    /* Count the boxes in each cell, then fill the cells in box order, so that
+     * each cell lists its boxes in priority order. */
+    cell_start.assign(columns * rows + 1, 0);
+    for (auto& box : this->boxes)
+    {
+        for_each_cell(box, [&] (int cell) { ++cell_start[cell + 1]; });
+    }
+
+    for (size_t i = 1; i < cell_start.size(); i++)
+    {
+        cell_start[i] += cell_start[i - 1];
+    }
+
+    cell_boxes.resize(cell_start.back());
+    std::vector<uint32_t> next(cell_start.begin(), cell_start.end() - 1);
+    for (uint32_t index = 0; index < this->boxes.size(); index++)
+    {
+        for_each_cell(this->boxes[index], [&] (int cell)
+        {
+            cell_boxes[next[cell]++] = index;
+        });
+    }
+}
+
+int wf::hit_test_grid_t::get_cell_at(wf::pointf_t point) const
+{
+    double x = point.x - area.x;
+    double y = point.y - area.y;
+    if ((x < 0) || (y < 0) || (x >= area.width) || (y >= area.height))
+    {
+        return -1;
+    }
+
+    int col = std::floor(x) / cell_size;
+    int row = std::floor(y) / cell_size;
+
+    return row * columns + col;
+}
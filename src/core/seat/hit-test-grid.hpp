@@ -0,0 +1,87 @@
+#ifndef WF_HIT_TEST_GRID_HPP
+#define WF_HIT_TEST_GRID_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <wayfire/geometry.hpp>
+
+namespace wf
+{
+/**
+ * A uniform grid over a rectangular area, used to find the boxes which
+ * contain a given point without looking at all of them.
+ *
+ * Each cell of the grid lists the boxes which overlap it. The boxes are given
+ * in priority order, for ex. in stacking order, and the lists preserve that
+ * order, so that a lookup can stop at the first box which matches.
+ */
+class hit_test_grid_t
+{
+  public:
+    /** @param cell_size The width and height of a cell. */
+    hit_test_grid_t(int cell_size = 128);
+
+    /**
+     * Build the grid for the given boxes.
+     *
+     * @param area The area covered by the grid. Parts of the boxes outside of
+     *   it cannot be found by lookups.
+     * @param boxes The boxes, in priority order.
+     */
+    void rebuild(wf::geometry_t area, std::vector<wf::geometry_t> boxes);
+
+    /**
+     * Call @callback with the index of each box which contains the point, in
+     * priority order, until it returns true.
+     *
+     * @return The index for which @callback returned true, or -1.
+     */
+    template<class Callback>
+    int find_box_at(wf::pointf_t point, Callback callback) const
+    {
+        int cell = get_cell_at(point);
+        if (cell < 0)
+        {
+            return -1;
+        }
+
+        for (uint32_t i = cell_start[cell]; i < cell_start[cell + 1]; i++)
+        {
+            uint32_t index = cell_boxes[i];
+            if ((boxes[index] & point) && callback(index))
+            {
+                return index;
+            }
+        }
+
+        return -1;
+    }
+
+    /** @return The number of boxes in the grid. */
+    size_t size() const
+    {
+        return boxes.size();
+    }
+
+  private:
+    int cell_size;
+    wf::geometry_t area = {0, 0, 0, 0};
+    int columns = 0;
+    int rows    = 0;
+
+    std::vector<wf::geometry_t> boxes;
+    /* The boxes of cell i are cell_boxes[cell_start[i]..cell_start[i + 1]) */
+    std::vector<uint32_t> cell_start;
+    std::vector<uint32_t> cell_boxes;
+
+    /** @return The index of the cell containing the point, or -1. */
+    int get_cell_at(wf::pointf_t point) const;
+
+    /** Call @callback with the index of each cell which overlaps @box */
+    template<class Callback>
+    void for_each_cell(wf::geometry_t box, Callback callback) const;
+};
+}
+
+#endif /* end of include guard: WF_HIT_TEST_GRID_HPP */
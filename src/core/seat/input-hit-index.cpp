@@ -0,0 +1,82 @@
+#include "input-hit-index.hpp"
+#include <wayfire/output.hpp>
+#include <wayfire/workspace-manager.hpp>
+
+wf::input_hit_index_t::input_hit_index_t(wf::output_t *output)
+{
+    this->output = output;
+
+    /* Everything which can change the set of views, their order or their
+     * visibility. Changes of their geometry are caught by damage. */
+    for (auto signal : {"view-layer-attached", "view-layer-detached",
+        "stack-order-changed", "view-mapped", "view-unmapped",
+        "view-minimized", "view-set-sticky", "view-focused",
+        "view-geometry-changed", "workspace-changed", "configuration-changed"})
+    {
+        output->connect_signal(signal, &on_changed);
+    }
+}
+
+void wf::input_hit_index_t::invalidate()
+{
+    dirty = true;
+}
+
+void wf::input_hit_index_t::handle_view_damage(wayfire_view view)
+{
+    if (dirty)
+    {
+        return;
+    }
+
+    auto it = indexed_boxes.find(view.get());
+    if ((it != indexed_boxes.end()) && (it->second != view->get_bounding_box()))
+    {
+        dirty = true;
+    }
+}
+
+void wf::input_hit_index_t::rebuild()
+{
+    views.clear();
+    indexed_boxes.clear();
+
+    std::vector<wf::geometry_t> boxes;
+    for (auto& v : output->workspace->get_views_in_layer(wf::VISIBLE_LAYERS))
+    {
+        for (auto& view : v->get_view_tree())
+        {
+            auto box = view->get_bounding_box();
+            views.push_back(view);
+            boxes.push_back(box);
+            indexed_boxes[view.get()] = box;
+        }
+    }
+
+    grid.rebuild(output->get_relative_geometry(), std::move(boxes));
+    dirty = false;
+}
+
+wf::surface_interface_t*wf::input_hit_index_t::surface_at(wf::pointf_t point,
+    wf::pointf_t& local, const std::function<bool(wayfire_view)>& can_focus)
+{
+    if (dirty)
+    {
+        rebuild();
+    }
+
+    wf::surface_interface_t *result = nullptr;
+    grid.find_box_at(point, [&] (uint32_t index)
+    {
+        auto& view = views[index];
+        if (view->minimized || !view->is_visible() || !can_focus(view))
+        {
+            return false;
+        }
+
+        result = view->map_input_coordinates(point, local);
+        return result != nullptr;
+    });
+
+    return result;
+}
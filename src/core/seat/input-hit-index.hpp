@@ -0,0 +1,65 @@
+#ifndef WF_INPUT_HIT_INDEX_HPP
+#define WF_INPUT_HIT_INDEX_HPP
+
+#include <functional>
+#include <unordered_map>
+#include <wayfire/object.hpp>
+#include <wayfire/view.hpp>
+#include <wayfire/util.hpp>
+#include "hit-test-grid.hpp"
+
+namespace wf
+{
+/**
+ * An index of the views of an output which can receive input, used to find
+ * the surface under the cursor without going through all views.
+ *
+ * The index holds the bounding boxes of all views in the visible layers, in
+ * stacking order, in a hit_test_grid_t. It is rebuilt lazily on the first
+ * lookup after it has been invalidated. It is invalidated when the set of
+ * views or their stacking order changes, and when a view is damaged and its
+ * bounding box is not the indexed one anymore, which covers moving,
+ * resizing and transformers.
+ */
+class input_hit_index_t
+{
+  public:
+    input_hit_index_t(wf::output_t *output);
+
+    /**
+     * Find the topmost surface which accepts input at the given point.
+     *
+     * @param point The point, in output-local coordinates.
+     * @param local Set to the point in surface-local coordinates, if a
+     *   surface was found.
+     * @param can_focus Only views for which it returns true are considered.
+     */
+    wf::surface_interface_t *surface_at(wf::pointf_t point, wf::pointf_t& local,
+        const std::function<bool(wayfire_view)>& can_focus);
+
+    /** Called when the view is damaged. See view_damage_raw(). */
+    void handle_view_damage(wayfire_view view);
+
+    /** Invalidate the whole index. */
+    void invalidate();
+
+  private:
+    wf::output_t *output;
+    bool dirty = true;
+
+    hit_test_grid_t grid;
+    /* The views in the grid, in stacking order */
+    std::vector<wayfire_view> views;
+    /* The indexed bounding box of each view */
+    std::unordered_map<wf::view_interface_t*, wf::geometry_t> indexed_boxes;
+
+    void rebuild();
+
+    wf::signal_connection_t on_changed = [=] (wf::signal_data_t*)
+    {
+        invalidate();
+    };
+};
+}
+
+#endif /* end of include guard: WF_INPUT_HIT_INDEX_HPP */
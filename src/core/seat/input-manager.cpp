@@ -270,23 +270,9 @@ wf::surface_interface_t*wf::input_manager_t::input_surface_at(
     global.x -= og.x;
     global.y -= og.y;
 
-    for (auto& v : output->workspace->get_views_in_layer(wf::VISIBLE_LAYERS))
-    {
-        for (auto& view : v->enumerate_views())
-        {
-            if (!view->minimized && view->is_visible() &&
-                can_focus_surface(view.get()))
-            {
-                auto surface = view->map_input_coordinates(global, local);
-                if (surface)
-                {
-                    return surface;
-                }
-            }
-        }
-    }
-
-    return nullptr;
+    auto impl = (wf::output_impl_t*)output;
+    return impl->get_input_hit_index().surface_at(global, local,
+        [=] (wayfire_view view) { return can_focus_surface(view.get()); });
 }
 
 void wf::input_manager_t::set_exclusive_focus(wl_client *client)
@@ -30,7 +30,8 @@ wf::pointer_t::pointer_t(nonstd::observer_ptr<wf::input_manager_t> input,
         update_cursor_position(get_current_time(), false);
     };
     wf::get_core().connect_signal("output-stack-order-changed", &on_views_updated);
-    wf::get_core().connect_signal("view-geometry-changed", &on_views_updated);
+    wf::get_core().connect_signal(wf::VIEW_GEOMETRY_CHANGED_SIGNAL,
+        &on_views_updated);
 }
 
 wf::pointer_t::~pointer_t()
@@ -201,7 +202,7 @@ wf::pointf_t wf::pointer_t::get_absolute_position_from_relative(
     auto output_geometry = view->get_output_geometry();
     wf::point_t origin   = {output_geometry.x, output_geometry.y};
 
-    for (auto& surf : view->enumerate_surfaces(origin))
+    for (auto surf : view->get_surface_tree(origin))
     {
         if (surf.surface == this->cursor_focus)
         {
@@ -55,7 +55,8 @@ wf::tablet_tool_t::tablet_tool_t(wlr_tablet_tool *tool,
     });
 
     wf::get_core().connect_signal("output-stack-order-changed", &on_views_updated);
-    wf::get_core().connect_signal("view-geometry-changed", &on_views_updated);
+    wf::get_core().connect_signal(wf::VIEW_GEOMETRY_CHANGED_SIGNAL,
+        &on_views_updated);
 
     /* Just pass cursor set requests to core, but translate them to
      * regular pointer set requests */
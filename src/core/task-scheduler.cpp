@@ -0,0 +1,320 @@
+#include <wayfire/task-scheduler.hpp>
+#include <wayfire/worker-pool.hpp>
+#include <wayfire/core.hpp>
+#include <wayfire/output.hpp>
+#include <wayfire/output-layout.hpp>
+#include <wayfire/render-manager.hpp>
+#include <wayfire/signal-definitions.hpp>
+#include <wayfire/util/log.hpp>
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <wayland-server-core.h>
+
+namespace wf
+{
+struct scheduled_task_t
+{
+    /* Runs on a worker thread */
+    std::function<void()> work;
+    /* Runs on the main thread, after work */
+    std::function<void()> done;
+    /* The output for submit_for_frame(), or nullptr */
+    wf::output_t *output = nullptr;
+
+    std::atomic<bool> cancelled{false};
+    /* Whether done was called, or the task was dropped. Main thread only. */
+    bool completed = false;
+    /* Whether work is done and the task waits for the next frame */
+    bool ready = false;
+};
+}
+
+namespace
+{
+/**
+ * The tasks whose work is done, passed from the workers to the main thread.
+ * The workers wake up the main thread by writing to an eventfd.
+ *
+ * It is shared with the tasks still running, so that it outlives the
+ * scheduler if the compositor shuts down before they finish.
+ */
+struct completion_queue_t
+{
+    int fd;
+    std::mutex mutex;
+    std::vector<std::shared_ptr<wf::scheduled_task_t>> tasks;
+    bool closed = false;
+
+    ~completion_queue_t()
+    {
+        close(fd);
+    }
+
+    void push(std::shared_ptr<wf::scheduled_task_t> task)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (closed)
+        {
+            return;
+        }
+
+        tasks.push_back(std::move(task));
+        uint64_t one = 1;
+        if (write(fd, &one, sizeof(one)) < 0)
+        {
+            /* Can only fail if the counter overflows, in which case the
+             * main thread will wake up anyway. */
+        }
+    }
+};
+
+/** The frame tasks of an output. */
+struct output_tasks_t
+{
+    wf::effect_hook_t apply_ready;
+    bool hook_added = false;
+    std::vector<std::shared_ptr<wf::scheduled_task_t>> tasks;
+};
+}
+
+class wf::task_scheduler_t::impl
+{
+  public:
+    std::shared_ptr<completion_queue_t> completions;
+    wl_event_source *completion_source = nullptr;
+
+    std::map<wf::output_t*, std::unique_ptr<output_tasks_t>> outputs;
+
+    wf::signal_connection_t on_output_pre_remove = [=] (wf::signal_data_t *data)
+    {
+        auto output = get_signaled_output(data);
+        auto it     = outputs.find(output);
+        if (it == outputs.end())
+        {
+            return;
+        }
+
+        if (it->second->hook_added)
+        {
+            output->render->rem_effect(&it->second->apply_ready);
+        }
+
+        for (auto& task : it->second->tasks)
+        {
+            task->cancelled = true;
+        }
+
+        outputs.erase(it);
+    };
+
+    static int handle_completions(int fd, uint32_t mask, void *data)
+    {
+        uint64_t count;
+        if (read(fd, &count, sizeof(count)) < 0)
+        {
+            LOGE("Failed to read task completions");
+        }
+
+        ((impl*)data)->run_completions();
+        return 0;
+    }
+
+    void run_completions()
+    {
+        std::vector<std::shared_ptr<wf::scheduled_task_t>> tasks;
+        {
+            std::lock_guard<std::mutex> lock(completions->mutex);
+            std::swap(tasks, completions->tasks);
+        }
+
+        for (auto& task : tasks)
+        {
+            if (task->output)
+            {
+                frame_task_ready(task);
+            } else if (!task->cancelled)
+            {
+                task->completed = true;
+                auto done = std::move(task->done);
+                if (done)
+                {
+                    done();
+                }
+            } else
+            {
+                task->completed = true;
+            }
+        }
+    }
+
+    output_tasks_t& get_output_tasks(wf::output_t *output)
+    {
+        auto& tasks = outputs[output];
+        if (!tasks)
+        {
+            tasks = std::make_unique<output_tasks_t>();
+            tasks->apply_ready = [=] () { apply_ready_tasks(output); };
+        }
+
+        return *tasks;
+    }
+
+    void frame_task_ready(const std::shared_ptr<wf::scheduled_task_t>& task)
+    {
+        task->ready = true;
+        if (task->cancelled)
+        {
+            /* The task may be left in the list of an output. Drop it with
+             * the other cancelled tasks on the next frame. */
+            task->completed = true;
+            return;
+        }
+
+        auto& tasks = get_output_tasks(task->output);
+        if (!tasks.hook_added)
+        {
+            task->output->render->add_effect(&tasks.apply_ready,
+                wf::OUTPUT_EFFECT_PRE);
+            tasks.hook_added = true;
+        }
+
+        task->output->render->schedule_redraw();
+    }
+
+    void apply_ready_tasks(wf::output_t *output)
+    {
+        auto& tasks = get_output_tasks(output);
+        output->render->rem_effect(&tasks.apply_ready);
+        tasks.hook_added = false;
+
+        /* Apply functions may submit new tasks, so take the ready ones out
+         * of the list first. */
+        std::vector<std::shared_ptr<wf::scheduled_task_t>> ready, waiting;
+        for (auto& task : tasks.tasks)
+        {
+            if (task->cancelled)
+            {
+                continue;
+            }
+
+            (task->ready ? ready : waiting).push_back(task);
+        }
+
+        tasks.tasks = std::move(waiting);
+        for (auto& task : ready)
+        {
+            /* An earlier apply function may have cancelled it */
+            if (!task->cancelled)
+            {
+                task->completed = true;
+                auto apply = std::move(task->done);
+                if (apply)
+                {
+                    apply();
+                }
+            }
+        }
+    }
+
+    task_handle_t submit(std::shared_ptr<wf::scheduled_task_t> task)
+    {
+        auto queue = completions;
+        wf::get_core().worker_pool->submit([task, queue] ()
+        {
+            if (!task->cancelled)
+            {
+                task->work();
+            }
+
+            task->work = nullptr;
+            queue->push(task);
+        });
+
+        task_handle_t handle;
+        handle.task = std::move(task);
+        return handle;
+    }
+};
+
+wf::task_scheduler_t::task_scheduler_t() : priv(new impl)
+{
+    priv->completions     = std::make_shared<completion_queue_t>();
+    priv->completions->fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    priv->completion_source = wl_event_loop_add_fd(wf::get_core().ev_loop,
+        priv->completions->fd, WL_EVENT_READABLE, impl::handle_completions,
+        priv.get());
+
+    wf::get_core().output_layout->connect_signal("output-pre-remove",
+        &priv->on_output_pre_remove);
+}
+
+wf::task_scheduler_t::~task_scheduler_t()
+{
+    wl_event_source_remove(priv->completion_source);
+    for (auto& [output, tasks] : priv->outputs)
+    {
+        if (tasks->hook_added)
+        {
+            output->render->rem_effect(&tasks->apply_ready);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(priv->completions->mutex);
+    priv->completions->closed = true;
+    priv->completions->tasks.clear();
+}
+
+wf::task_handle_t wf::task_scheduler_t::submit(std::function<void()> work,
+    std::function<void()> done)
+{
+    auto task = std::make_shared<scheduled_task_t>();
+    task->work = std::move(work);
+    task->done = std::move(done);
+    return priv->submit(std::move(task));
+}
+
+wf::task_handle_t wf::task_scheduler_t::submit_for_frame(wf::output_t *output,
+    std::function<void()> work, std::function<void()> apply)
+{
+    auto task = std::make_shared<scheduled_task_t>();
+    task->work   = std::move(work);
+    task->done   = std::move(apply);
+    task->output = output;
+    priv->get_output_tasks(output).tasks.push_back(task);
+    return priv->submit(std::move(task));
+}
+
+wf::task_handle_t& wf::task_handle_t::operator =(task_handle_t&& other)
+{
+    if (this != &other)
+    {
+        cancel();
+        task = std::move(other.task);
+    }
+
+    return *this;
+}
+
+wf::task_handle_t::~task_handle_t()
+{
+    cancel();
+}
+
+void wf::task_handle_t::cancel()
+{
+    if (task)
+    {
+        task->cancelled = true;
+        task.reset();
+    }
+}
+
+bool wf::task_handle_t::pending() const
+{
+    return task && !task->completed && !task->cancelled;
+}
@@ -0,0 +1,305 @@
+#include <wayfire/worker-pool.hpp>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+/* Whether the current thread is running parallel work, either as a worker
+ * or as the caller of parallel_for() */
+static thread_local bool in_parallel_work = false;
+
+namespace
+{
+/** A parallel_for() call, shared by the caller and the workers. */
+struct job_t
+{
+    const std::function<void(size_t, size_t)> *func;
+    size_t count;
+    size_t grain;
+    size_t num_chunks;
+
+    /* The next chunk to be taken by a thread */
+    std::atomic<size_t> next_chunk{0};
+    /* The number of workers which took the job, guarded by the pool mutex */
+    int users = 0;
+
+    void run_chunks()
+    {
+        while (true)
+        {
+            size_t chunk = next_chunk.fetch_add(1, std::memory_order_relaxed);
+            if (chunk >= num_chunks)
+            {
+                return;
+            }
+
+            size_t begin = chunk * grain;
+            (*func)(begin, std::min(count, begin + grain));
+        }
+    }
+};
+
+/** The tasks submitted to a worker, which other workers can steal. */
+struct task_queue_t
+{
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+};
+}
+
+class wf::worker_pool_t::impl
+{
+  public:
+    /* The pool the current thread is a worker of, and its index in the
+     * workers of that pool */
+    static inline thread_local impl *worker_pool = nullptr;
+    static inline thread_local int worker_index  = -1;
+
+    int num_threads;
+    std::vector<std::thread> threads;
+    std::once_flag threads_started;
+
+    /* Only one job runs at a time */
+    std::mutex job_mutex;
+
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::condition_variable work_done;
+    job_t *job = nullptr;
+    uint64_t generation = 0;
+    bool stopping = false;
+
+    /* One queue per worker. A worker runs the newest task of its own queue
+     * first, and steals the oldest tasks of the other queues when its own
+     * is empty. */
+    std::vector<std::unique_ptr<task_queue_t>> queues;
+    std::atomic<size_t> next_queue{0};
+    /* The number of tasks in all queues, changed under the pool mutex */
+    size_t queued_tasks = 0;
+
+    std::function<void()> take_task(int index)
+    {
+        for (int i = 0; i < num_threads; i++)
+        {
+            auto& queue = *queues[(index + i) % num_threads];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty())
+            {
+                continue;
+            }
+
+            std::function<void()> task;
+            if (i == 0)
+            {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            } else
+            {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+
+            return task;
+        }
+
+        return {};
+    }
+
+    void worker_loop(int index)
+    {
+        in_parallel_work = true;
+        worker_pool  = this;
+        worker_index = index;
+        uint64_t seen_generation = 0;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            work_available.wait(lock, [&] ()
+            {
+                return stopping || (queued_tasks > 0) ||
+                       (job && (generation != seen_generation));
+            });
+
+            if (stopping)
+            {
+                return;
+            }
+
+            /* A waiting parallel_for() comes first, since its caller is
+             * blocked until it is done. */
+            if (job && (generation != seen_generation))
+            {
+                seen_generation = generation;
+                auto current = job;
+                ++current->users;
+
+                lock.unlock();
+                current->run_chunks();
+                lock.lock();
+
+                if (--current->users == 0)
+                {
+                    work_done.notify_all();
+                }
+
+                continue;
+            }
+
+            --queued_tasks;
+            lock.unlock();
+            /* The count reserves a task for this worker, so one is always
+             * queued. But the queues are scanned one at a time, and another
+             * worker may take the task this one would have found, while a new
+             * task is queued where it has already looked. */
+            std::function<void()> task;
+            while (!(task = take_task(index)))
+            {
+                std::this_thread::yield();
+            }
+
+            task();
+            task = nullptr;
+            lock.lock();
+        }
+    }
+
+    void start_threads()
+    {
+        std::call_once(threads_started, [=] ()
+        {
+            for (int i = 0; i < num_threads; i++)
+            {
+                queues.push_back(std::make_unique<task_queue_t>());
+            }
+
+            for (int i = 0; i < num_threads; i++)
+            {
+                threads.emplace_back([=] () { worker_loop(i); });
+            }
+        });
+    }
+
+    void submit(std::function<void()> task)
+    {
+        start_threads();
+
+        /* Tasks submitted by a task stay on the same worker if possible. The
+         * index of a worker of another pool means nothing here. */
+        size_t index = (worker_pool == this) ? worker_index :
+            next_queue.fetch_add(1, std::memory_order_relaxed) % num_threads;
+        {
+            auto& queue = *queues[index];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++queued_tasks;
+        }
+
+        work_available.notify_one();
+    }
+
+    void run(job_t& new_job)
+    {
+        std::lock_guard<std::mutex> job_lock(job_mutex);
+        start_threads();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &new_job;
+            ++generation;
+        }
+
+        work_available.notify_all();
+        in_parallel_work = true;
+        new_job.run_chunks();
+        in_parallel_work = false;
+
+        /* All chunks are taken, wait for the workers still running them. */
+        std::unique_lock<std::mutex> lock(mutex);
+        job = nullptr;
+        work_done.wait(lock, [&] () { return new_job.users == 0; });
+    }
+
+    ~impl()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+
+        /* Tasks which haven't started yet are dropped */
+        work_available.notify_all();
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+    }
+};
+
+wf::worker_pool_t::worker_pool_t(int num_threads) : priv(new impl)
+{
+    if (num_threads < 0)
+    {
+        num_threads = (int)std::thread::hardware_concurrency() - 1;
+    }
+
+    priv->num_threads = std::max(num_threads, 0);
+}
+
+wf::worker_pool_t::~worker_pool_t() = default;
+
+int wf::worker_pool_t::get_concurrency() const
+{
+    return priv->num_threads + 1;
+}
+
+void wf::worker_pool_t::parallel_for(size_t count, size_t grain,
+    const std::function<void(size_t, size_t)>& func)
+{
+    grain = std::max<size_t>(grain, 1);
+    size_t num_chunks = (count + grain - 1) / grain;
+    if ((num_chunks <= 1) || (priv->num_threads == 0) || in_parallel_work)
+    {
+        for (size_t begin = 0; begin < count; begin += grain)
+        {
+            func(begin, std::min(count, begin + grain));
+        }
+
+        return;
+    }
+
+    job_t job;
+    job.func  = &func;
+    job.count = count;
+    job.grain = grain;
+    job.num_chunks = num_chunks;
+    priv->run(job);
+}
+
+void wf::worker_pool_t::fork_join(const std::vector<std::function<void()>>& tasks)
+{
+    parallel_for(tasks.size(), 1, [&] (size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            tasks[i]();
+        }
+    });
+}
+
+void wf::worker_pool_t::submit(std::function<void()> task)
+{
+    if (priv->num_threads == 0)
+    {
+        task();
+        return;
+    }
+
+    priv->submit(std::move(task));
+}
@@ -0,0 +1,200 @@
+#include "damage-coalescer.hpp"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+/** A box of the result together with the damaged area it covers */
+struct merged_box_t
+{
+    pixman_box32_t box;
+    int64_t covered;
+};
+
+int64_t box_area(const pixman_box32_t& box)
+{
+    return int64_t(box.x2 - box.x1) * (box.y2 - box.y1);
+}
+
+pixman_box32_t box_union(const pixman_box32_t& a, const pixman_box32_t& b)
+{
+    return {
+        std::min(a.x1, b.x1), std::min(a.y1, b.y1),
+        std::max(a.x2, b.x2), std::max(a.y2, b.y2),
+    };
+}
+
+int64_t region_area(const wf::region_t& region)
+{
+    int64_t area = 0;
+    for (const auto& box : region)
+    {
+        area += box_area(box);
+    }
+
+    return area;
+}
+
+int count_boxes(const wf::region_t& region)
+{
+    return std::distance(region.begin(), region.end());
+}
+
+/**
+ * Merge each box of the region into the first merged box which stays within
+ * the allowed waste, or add it as a new box.
+ *
+ * The boxes of a region are sorted by y, then x, so neighbouring boxes are
+ * close to each other in the list and the most recent merged boxes are the
+ * most likely to accept the next one. Only those are tried, which keeps the
+ * cost linear in the number of boxes.
+ */
+wf::region_t merge_boxes(const wf::region_t& damage, double max_waste)
+{
+    static constexpr size_t MAX_CANDIDATES = 16;
+
+    std::vector<merged_box_t> merged;
+    for (const auto& box : damage)
+    {
+        int64_t area = box_area(box);
+        auto last = merged.rbegin() + std::min(merged.size(), MAX_CANDIDATES);
+        auto it   = std::find_if(merged.rbegin(), last, [&] (auto& m)
+        {
+            double bounding = box_area(box_union(m.box, box));
+            return (bounding - m.covered - area) <= max_waste * bounding;
+        });
+
+        if (it == last)
+        {
+            merged.push_back({box, area});
+        } else
+        {
+            it->box = box_union(it->box, box);
+            it->covered += area;
+        }
+    }
+
+    wf::region_t result;
+    for (auto& m : merged)
+    {
+        pixman_region32_union_rect(result.to_pixman(), result.to_pixman(),
+            m.box.x1, m.box.y1, m.box.x2 - m.box.x1, m.box.y2 - m.box.y1);
+    }
+
+    return result;
+}
+
+/**
+ * Split the extents of the damage in at most @max_rects tiles, arranged in
+ * rows, and replace the damage in each tile with its bounding box.
+ *
+ * All boxes in a row get the height of the damage in the row, so that the
+ * row is a single band of the result and doesn't get split into more boxes.
+ */
+wf::region_t merge_into_tiles(const wf::region_t& damage, int max_rects)
+{
+    const int rows = std::max(1, (int)std::sqrt(max_rects));
+    const int cols = std::max(1, max_rects / rows);
+
+    auto extents = damage.get_extents();
+    const int64_t width  = std::max(1, extents.x2 - extents.x1);
+    const int64_t height = std::max(1, extents.y2 - extents.y1);
+    auto tile_x = [&] (int col) -> int32_t
+    {
+        return extents.x1 + width * col / cols;
+    };
+    auto tile_y = [&] (int row) -> int32_t
+    {
+        return extents.y1 + height * row / rows;
+    };
+
+    /* The damaged range of each row in y and of each tile in x */
+    const pixman_box32_t none = {INT32_MAX, INT32_MAX, INT32_MIN, INT32_MIN};
+    std::vector<pixman_box32_t> tiles(rows * cols, none);
+    std::vector<pixman_box32_t> row_ranges(rows, none);
+
+    for (const auto& box : damage)
+    {
+        int first_row = (box.y1 - extents.y1) * rows / height;
+        int first_col = (box.x1 - extents.x1) * cols / width;
+        for (int row = first_row; row < rows && tile_y(row) < box.y2; row++)
+        {
+            int32_t y1 = std::max(box.y1, tile_y(row));
+            int32_t y2 = std::min(box.y2, tile_y(row + 1));
+            if (y1 >= y2)
+            {
+                continue;
+            }
+
+            row_ranges[row] = box_union(row_ranges[row], {0, y1, 0, y2});
+            for (int col = first_col; col < cols && tile_x(col) < box.x2; col++)
+            {
+                int32_t x1 = std::max(box.x1, tile_x(col));
+                int32_t x2 = std::min(box.x2, tile_x(col + 1));
+                if (x1 < x2)
+                {
+                    auto& tile = tiles[row * cols + col];
+                    tile = box_union(tile, {x1, 0, x2, 0});
+                }
+            }
+        }
+    }
+
+    wf::region_t result;
+    for (int row = 0; row < rows; row++)
+    {
+        for (int col = 0; col < cols; col++)
+        {
+            auto& tile = tiles[row * cols + col];
+            if (tile.x1 < tile.x2)
+            {
+                pixman_region32_union_rect(result.to_pixman(), result.to_pixman(),
+                    tile.x1, row_ranges[row].y1, tile.x2 - tile.x1,
+                    row_ranges[row].y2 - row_ranges[row].y1);
+            }
+        }
+    }
+
+    return result;
+}
+}
+
+wf::damage_coalesce_stats_t wf::coalesce_damage(wf::region_t& damage,
+    const damage_coalesce_policy_t& policy)
+{
+    damage_coalesce_stats_t stats;
+    stats.rects_before = stats.rects_after = count_boxes(damage);
+
+    const bool over_limit = (policy.max_rects > 0) &&
+        (stats.rects_before > policy.max_rects);
+    if ((stats.rects_before <= 1) || ((policy.max_waste < 0) && !over_limit))
+    {
+        return stats;
+    }
+
+    const int64_t original_area = region_area(damage);
+
+    wf::region_t result = damage;
+    if (policy.max_waste >= 0)
+    {
+        result = merge_boxes(damage, policy.max_waste);
+        /* Merged boxes may overlap, and their union may need more boxes */
+        if (count_boxes(result) > stats.rects_before)
+        {
+            result = damage;
+        }
+    }
+
+    if ((policy.max_rects > 0) && (count_boxes(result) > policy.max_rects))
+    {
+        result = merge_into_tiles(result, policy.max_rects);
+    }
+
+    damage = std::move(result);
+    stats.rects_after = count_boxes(damage);
+    stats.area_added  = region_area(damage) - original_area;
+
+    return stats;
+}
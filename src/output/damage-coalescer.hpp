@@ -0,0 +1,55 @@
+#ifndef WF_DAMAGE_COALESCER_HPP
+#define WF_DAMAGE_COALESCER_HPP
+
+#include <cstdint>
+#include <wayfire/util.hpp>
+
+namespace wf
+{
+/**
+ * Decides which boxes of a damaged region are merged.
+ */
+struct damage_coalesce_policy_t
+{
+    /**
+     * Two boxes are merged if their bounding box is at most this fraction
+     * larger than the damage they cover, for ex. 0.25 allows 25% of the
+     * bounding box to be undamaged. A negative value disables merging
+     * on this criterion.
+     */
+    double max_waste = 0.25;
+    /**
+     * The maximal number of boxes in the result. When there are still more
+     * after merging, the extents of the damage are split into at most this
+     * many tiles, and the damage in each tile is replaced by its bounding
+     * box. 0 means no limit.
+     */
+    int max_rects = 32;
+};
+
+/**
+ * What coalesce_damage() did to a region.
+ */
+struct damage_coalesce_stats_t
+{
+    /** The number of boxes in the region before coalescing. */
+    int rects_before = 0;
+    /** The number of boxes in the region after coalescing. */
+    int rects_after  = 0;
+    /** The area which was not damaged but is part of the result. */
+    int64_t area_added = 0;
+};
+
+/**
+ * Replace the damaged region with a region made of fewer, larger boxes.
+ *
+ * The result always contains the original region. Each of its boxes costs a
+ * separate scissored draw for each surface, so a few slightly larger boxes
+ * are usually cheaper to repaint than many tiny ones, as produced for ex. by
+ * a blinking cursor in a terminal.
+ */
+damage_coalesce_stats_t coalesce_damage(wf::region_t& damage,
+    const damage_coalesce_policy_t& policy);
+}
+
+#endif /* end of include guard: WF_DAMAGE_COALESCER_HPP */
@@ -0,0 +1,96 @@
+#ifndef WF_FRAME_POOL_HPP
+#define WF_FRAME_POOL_HPP
+
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include <wayfire/nonstd/noncopyable.hpp>
+
+namespace wf
+{
+namespace detail
+{
+template<class T, class = void>
+struct has_capacity : std::false_type
+{};
+
+template<class T>
+struct has_capacity<T, std::void_t<decltype(std::declval<const T&>().capacity())>> :
+    std::true_type
+{};
+}
+
+/**
+ * A pool of objects which are used only for the duration of a single frame.
+ *
+ * Objects are never freed when the frame ends, instead they are handed out
+ * again in the next frames. Once the pool has grown to the size needed by the
+ * scene, acquiring objects does not need any heap allocations.
+ *
+ * If T is a container (has capacity()), its capacity is kept between frames as
+ * well, and growing it is counted as an allocation.
+ */
+template<class T>
+class frame_pool_t : public noncopyable_t
+{
+  public:
+    /**
+     * Get an unused object from the pool. Containers are cleared, other objects
+     * keep their state from the last frame they were used in.
+     *
+     * The returned pointer is valid until the next reset().
+     */
+    T *acquire()
+    {
+        if (used == objects.size())
+        {
+            objects.push_back(std::make_unique<T>());
+            ++allocations;
+        }
+
+        T *object = objects[used++].get();
+        if constexpr (detail::has_capacity<T>::value)
+        {
+            object->clear();
+        }
+
+        return object;
+    }
+
+    /**
+     * Mark all objects as unused. Should be called once per frame.
+     *
+     * @return The number of allocations done since the last reset.
+     */
+    size_t reset()
+    {
+        if constexpr (detail::has_capacity<T>::value)
+        {
+            capacities.resize(objects.size(), 0);
+            for (size_t i = 0; i < used; i++)
+            {
+                if (objects[i]->capacity() != capacities[i])
+                {
+                    capacities[i] = objects[i]->capacity();
+                    ++allocations;
+                }
+            }
+        }
+
+        used = 0;
+        size_t count = allocations;
+        allocations = 0;
+
+        return count;
+    }
+
+  private:
+    std::vector<std::unique_ptr<T>> objects;
+    /* Capacity of each pooled container at the end of the last frame */
+    std::vector<size_t> capacities;
+    size_t used = 0;
+    size_t allocations = 0;
+};
+}
+
+#endif /* end of include guard: WF_FRAME_POOL_HPP */
@@ -0,0 +1,341 @@
+#include "frame-timing.hpp"
+#include <wayfire/opengl.hpp>
+#include <wayfire/util/log.hpp>
+
+#include <EGL/egl.h>
+#include <GLES2/gl2ext.h>
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+const char*wf::get_frame_phase_name(frame_phase_t phase)
+{
+    switch (phase)
+    {
+      case FRAME_PHASE_EFFECT_PRE:
+        return "pre";
+
+      case FRAME_PHASE_EFFECT_DAMAGE:
+        return "damage";
+
+      case FRAME_PHASE_RENDER:
+        return "render";
+
+      case FRAME_PHASE_WORKSPACE_STREAM:
+        return "stream";
+
+      case FRAME_PHASE_EFFECT_OVERLAY:
+        return "overlay";
+
+      case FRAME_PHASE_POSTPROCESSING:
+        return "post";
+
+      case FRAME_PHASE_SOFTWARE_CURSOR:
+        return "cursor";
+
+      case FRAME_PHASE_COMMIT:
+        return "commit";
+
+      case FRAME_PHASE_EFFECT_POST:
+        return "post-effect";
+
+      default:
+        return "unknown";
+    }
+}
+
+void wf::frame_timing_ring_t::push(const frame_timing_t& timing)
+{
+    uint64_t index = total_written.load(std::memory_order_relaxed);
+    auto& slot     = slots[index % CAPACITY];
+
+    slot.written.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.timing = timing;
+    slot.written.store(index + 1, std::memory_order_release);
+
+    total_written.store(index + 1, std::memory_order_release);
+}
+
+std::vector<wf::frame_timing_t> wf::frame_timing_ring_t::snapshot(
+    size_t max_count) const
+{
+    uint64_t end   = total_written.load(std::memory_order_acquire);
+    uint64_t count = std::min<uint64_t>({end, max_count, CAPACITY});
+
+    std::vector<frame_timing_t> result;
+    result.reserve(count);
+    for (uint64_t index = end - count; index < end; index++)
+    {
+        const auto& slot = slots[index % CAPACITY];
+        if (slot.written.load(std::memory_order_acquire) != index + 1)
+        {
+            continue;
+        }
+
+        frame_timing_t copy = slot.timing;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.written.load(std::memory_order_relaxed) != index + 1)
+        {
+            /* Overwritten by the writer while copying */
+            continue;
+        }
+
+        result.push_back(copy);
+    }
+
+    return result;
+}
+
+namespace
+{
+/* Entry points of GL_EXT_disjoint_timer_query. The core GLES3 functions
+ * can't be used, because the context may be GLES2. */
+PFNGLGENQUERIESEXTPROC gen_queries;
+PFNGLDELETEQUERIESEXTPROC delete_queries;
+PFNGLQUERYCOUNTEREXTPROC query_counter;
+PFNGLGETQUERYOBJECTUIVEXTPROC get_query_object_uiv;
+PFNGLGETQUERYOBJECTUI64VEXTPROC get_query_object_ui64v;
+
+int64_t nsec_since_epoch(std::chrono::steady_clock::time_point point)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        point.time_since_epoch()).count();
+}
+
+int64_t nsec_between(std::chrono::steady_clock::time_point a,
+    std::chrono::steady_clock::time_point b)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(b - a).count();
+}
+}
+
+wf::frame_timing_recorder_t::frame_timing_recorder_t()
+{
+    const char *extensions = (const char*)glGetString(GL_EXTENSIONS);
+    if (extensions && strstr(extensions, "GL_EXT_disjoint_timer_query"))
+    {
+        gen_queries = (PFNGLGENQUERIESEXTPROC)
+            eglGetProcAddress("glGenQueriesEXT");
+        delete_queries = (PFNGLDELETEQUERIESEXTPROC)
+            eglGetProcAddress("glDeleteQueriesEXT");
+        query_counter = (PFNGLQUERYCOUNTEREXTPROC)
+            eglGetProcAddress("glQueryCounterEXT");
+        get_query_object_uiv = (PFNGLGETQUERYOBJECTUIVEXTPROC)
+            eglGetProcAddress("glGetQueryObjectuivEXT");
+        get_query_object_ui64v = (PFNGLGETQUERYOBJECTUI64VEXTPROC)
+            eglGetProcAddress("glGetQueryObjectui64vEXT");
+        gpu_timer_supported = gen_queries && delete_queries && query_counter &&
+            get_query_object_uiv && get_query_object_ui64v;
+    }
+
+    if (gpu_timer_supported)
+    {
+        gen_queries(queries.size(), queries.data());
+    } else
+    {
+        LOGD("GL_EXT_disjoint_timer_query is not supported, "
+             "frame timings will not include GPU times.");
+    }
+}
+
+wf::frame_timing_recorder_t::~frame_timing_recorder_t()
+{
+    if (gpu_timer_supported)
+    {
+        delete_queries(queries.size(), queries.data());
+    }
+}
+
+GLuint wf::frame_timing_recorder_t::get_query(size_t slot, frame_phase_t phase,
+    bool end) const
+{
+    return queries[slot * QUERIES_PER_FRAME + 2 * phase + end];
+}
+
+void wf::frame_timing_recorder_t::begin_frame()
+{
+    frame_active = true;
+    frame_start  = std::chrono::steady_clock::now();
+
+    auto& frame = current();
+    frame.issued_queries = 0;
+    frame.timing = {};
+    frame.timing.sequence   = next_sequence++;
+    frame.timing.start_nsec = nsec_since_epoch(frame_start);
+    std::fill(std::begin(frame.timing.gpu_nsec), std::end(frame.timing.gpu_nsec),
+        -1);
+}
+
+int64_t wf::frame_timing_recorder_t::get_frame_elapsed_nsec() const
+{
+    return nsec_between(frame_start, std::chrono::steady_clock::now());
+}
+
+void wf::frame_timing_recorder_t::begin_phase(frame_phase_t phase, bool gpu)
+{
+    if (!frame_active)
+    {
+        return;
+    }
+
+    phase_start[phase] = std::chrono::steady_clock::now();
+    if (gpu && gpu_timer_supported)
+    {
+        size_t slot = (pending_first + pending_count) % MAX_PENDING;
+        query_counter(get_query(slot, phase, false), GL_TIMESTAMP_EXT);
+        current().issued_queries |= (1u << (2 * phase));
+    }
+}
+
+void wf::frame_timing_recorder_t::end_phase(frame_phase_t phase, bool gpu)
+{
+    if (!frame_active)
+    {
+        return;
+    }
+
+    auto& frame = current();
+    frame.timing.cpu_nsec[phase] +=
+        nsec_between(phase_start[phase], std::chrono::steady_clock::now());
+
+    if (gpu && gpu_timer_supported)
+    {
+        size_t slot = (pending_first + pending_count) % MAX_PENDING;
+        query_counter(get_query(slot, phase, true), GL_TIMESTAMP_EXT);
+        frame.issued_queries |= (1u << (2 * phase + 1));
+    }
+}
+
+void wf::frame_timing_recorder_t::set_damage_stats(int rects, int rects_merged,
+    int64_t area_added)
+{
+    if (!frame_active)
+    {
+        return;
+    }
+
+    auto& timing = current().timing;
+    timing.damage_rects = rects;
+    timing.damage_rects_merged = rects_merged;
+    timing.damage_area_added   = area_added;
+}
+
+void wf::frame_timing_recorder_t::end_frame(frame_result_t result,
+    int repaint_delay)
+{
+    if (!frame_active)
+    {
+        return;
+    }
+
+    auto& frame = current();
+    frame.timing.result = result;
+    frame.timing.repaint_delay  = repaint_delay;
+    frame.timing.total_cpu_nsec =
+        nsec_between(frame_start, std::chrono::steady_clock::now());
+
+    frame_active = false;
+    ++pending_count;
+    collect_frames(pending_count == MAX_PENDING);
+}
+
+void wf::frame_timing_recorder_t::collect_frames(bool wait_for_oldest)
+{
+    bool needs_gl = false;
+    for (size_t i = 0; i < pending_count; i++)
+    {
+        needs_gl |= pending[(pending_first + i) % MAX_PENDING].issued_queries;
+    }
+
+    GLint disjoint = 0;
+    if (needs_gl)
+    {
+        OpenGL::render_begin();
+        GL_CALL(glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint));
+    }
+
+    while (pending_count > 0)
+    {
+        auto& frame = pending[pending_first];
+        if (frame.issued_queries)
+        {
+            /* GPU phases are measured in the order they are declared, so the
+             * query with the highest bit is issued last. If its result is
+             * available, all results of the frame are. */
+            int last = 31 - __builtin_clz(frame.issued_queries);
+            GLuint available = 0;
+            get_query_object_uiv(queries[pending_first * QUERIES_PER_FRAME + last],
+                GL_QUERY_RESULT_AVAILABLE_EXT, &available);
+
+            if (!available && !wait_for_oldest)
+            {
+                break;
+            }
+
+            for (int phase = 0; phase < FRAME_PHASE_TOTAL; phase++)
+            {
+                uint32_t both = 0b11u << (2 * phase);
+                if ((frame.issued_queries & both) != both)
+                {
+                    continue;
+                }
+
+                GLuint64 begin = 0, end = 0;
+                get_query_object_ui64v(get_query(pending_first,
+                    (frame_phase_t)phase, false), GL_QUERY_RESULT_EXT, &begin);
+                get_query_object_ui64v(get_query(pending_first,
+                    (frame_phase_t)phase, true), GL_QUERY_RESULT_EXT, &end);
+                frame.timing.gpu_nsec[phase] = disjoint ? -1 : (end - begin);
+            }
+        }
+
+        ring.push(frame.timing);
+        pending_first = (pending_first + 1) % MAX_PENDING;
+        --pending_count;
+        wait_for_oldest = false;
+    }
+
+    if (needs_gl)
+    {
+        OpenGL::render_end();
+    }
+}
+
+std::vector<wf::frame_timing_t> wf::frame_timing_recorder_t::get_timings(
+    size_t max_count) const
+{
+    return ring.snapshot(max_count);
+}
+
+std::string wf::format_frame_timings(const std::vector<frame_timing_t>& timings)
+{
+    static const char *result_names[] = {"rendered", "scanout", "skipped"};
+
+    std::ostringstream out;
+    out << "# sequence start_usec result delay_msec total_usec";
+    for (int phase = 0; phase < FRAME_PHASE_TOTAL; phase++)
+    {
+        const char *name = get_frame_phase_name((frame_phase_t)phase);
+        out << " " << name << "_cpu_usec " << name << "_gpu_usec";
+    }
+
+    out << " damage_rects damage_rects_merged damage_area_added\n";
+    for (auto& timing : timings)
+    {
+        out << timing.sequence << " " << timing.start_nsec / 1000 << " " <<
+            result_names[timing.result] << " " << timing.repaint_delay << " " <<
+            timing.total_cpu_nsec / 1000;
+        for (int phase = 0; phase < FRAME_PHASE_TOTAL; phase++)
+        {
+            int64_t gpu = timing.gpu_nsec[phase];
+            out << " " << timing.cpu_nsec[phase] / 1000 << " " <<
+            (gpu < 0 ? -1 : gpu / 1000);
+        }
+
+        out << " " << timing.damage_rects << " " << timing.damage_rects_merged <<
+            " " << timing.damage_area_added << "\n";
+    }
+
+    return out.str();
+}
@@ -0,0 +1,155 @@
+#ifndef WF_FRAME_TIMING_RECORDER_HPP
+#define WF_FRAME_TIMING_RECORDER_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <GLES3/gl3.h>
+#include <wayfire/frame-timing.hpp>
+#include <wayfire/nonstd/noncopyable.hpp>
+
+namespace wf
+{
+/**
+ * A fixed-size ring buffer of frame timings with a single writer.
+ *
+ * The writer never blocks, and readers can take a snapshot of the latest
+ * entries at any time, also from other threads. Each slot carries the
+ * sequence number of the entry stored in it, so readers can detect and skip
+ * slots which were overwritten while they were being copied.
+ */
+class frame_timing_ring_t : public noncopyable_t
+{
+  public:
+    static constexpr size_t CAPACITY = 256;
+
+    /** Add a new entry, overwriting the oldest one if the ring is full. */
+    void push(const frame_timing_t& timing);
+
+    /** @return Up to @max_count of the latest entries, oldest first. */
+    std::vector<frame_timing_t> snapshot(size_t max_count) const;
+
+  private:
+    struct slot_t
+    {
+        /* Index of the stored entry + 1, or 0 while it is being written */
+        std::atomic<uint64_t> written{0};
+        frame_timing_t timing;
+    };
+
+    std::array<slot_t, CAPACITY> slots;
+    std::atomic<uint64_t> total_written{0};
+};
+
+/**
+ * Measures the phases of an output's repaint cycle.
+ *
+ * CPU times are measured with a monotonic clock. GPU times are measured with
+ * timer queries (GL_EXT_disjoint_timer_query) if the driver supports them.
+ * Query results become available a few frames later, so finished frames are
+ * kept in a small queue and published to the ring buffer in order once all
+ * their results are known.
+ */
+class frame_timing_recorder_t : public noncopyable_t
+{
+  public:
+    /** Needs a current GL context, see OpenGL::render_begin(). */
+    frame_timing_recorder_t();
+    /** Needs a current GL context, see OpenGL::render_begin(). */
+    ~frame_timing_recorder_t();
+
+    /** Start measuring a new repaint cycle. */
+    void begin_frame();
+
+    /**
+     * Start measuring the given phase. Phases may be measured several times
+     * in a frame, in which case their times are summed up.
+     *
+     * @param gpu Whether to measure the GPU time of the phase as well. The
+     *   output must be bound for rendering if set.
+     */
+    void begin_phase(frame_phase_t phase, bool gpu = false);
+    /** Stop measuring the given phase. @gpu must match begin_phase(). */
+    void end_phase(frame_phase_t phase, bool gpu = false);
+
+    /**
+     * Record what happened to the damage of the current frame, see
+     * frame_timing_t::damage_rects.
+     */
+    void set_damage_stats(int rects, int rects_merged, int64_t area_added);
+
+    /** Finish the current repaint cycle. */
+    void end_frame(frame_result_t result, int repaint_delay);
+
+    /** @return The time since begin_frame() in nanoseconds. */
+    int64_t get_frame_elapsed_nsec() const;
+
+    /** @return Whether a repaint cycle is being measured. */
+    bool in_frame() const
+    {
+        return frame_active;
+    }
+
+    /** @return Whether GPU times are measured. */
+    bool has_gpu_timer() const
+    {
+        return gpu_timer_supported;
+    }
+
+    /** @return Up to @max_count of the latest published frame timings. */
+    std::vector<frame_timing_t> get_timings(size_t max_count) const;
+
+  private:
+    static constexpr size_t MAX_PENDING = 8;
+    static constexpr size_t QUERIES_PER_FRAME = 2 * FRAME_PHASE_TOTAL;
+
+    struct pending_frame_t
+    {
+        frame_timing_t timing;
+        /* Bit 2*phase+{0,1} is set if the begin/end query was issued */
+        uint32_t issued_queries = 0;
+    };
+
+    frame_timing_ring_t ring;
+
+    bool frame_active = false;
+    uint64_t next_sequence = 0;
+    std::chrono::steady_clock::time_point frame_start;
+    std::array<std::chrono::steady_clock::time_point, FRAME_PHASE_TOTAL>
+    phase_start;
+
+    /* Finished frames waiting for GPU results, a FIFO queue */
+    std::array<pending_frame_t, MAX_PENDING> pending;
+    size_t pending_first = 0;
+    size_t pending_count = 0;
+
+    /* The slot in pending for the frame being measured */
+    pending_frame_t& current()
+    {
+        return pending[(pending_first + pending_count) % MAX_PENDING];
+    }
+
+    bool gpu_timer_supported = false;
+    std::array<GLuint, MAX_PENDING * QUERIES_PER_FRAME> queries;
+
+    GLuint get_query(size_t slot, frame_phase_t phase, bool end) const;
+
+    /**
+     * Publish finished frames whose GPU results are available.
+     *
+     * @param wait_for_oldest Block until the results of the oldest frame are
+     *   available, so that its slot can be reused.
+     */
+    void collect_frames(bool wait_for_oldest);
+};
+
+/**
+ * Format the given timings as text, one frame per line, with times in
+ * microseconds. The first line is a header with the column names.
+ */
+std::string format_frame_timings(const std::vector<frame_timing_t>& timings);
+}
+
+#endif /* end of include guard: WF_FRAME_TIMING_RECORDER_HPP */
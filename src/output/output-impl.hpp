@@ -1,6 +1,7 @@
 #include "wayfire/output.hpp"
 #include "plugin-loader.hpp"
 #include "../core/seat/bindings-repository.hpp"
+#include "../core/seat/input-hit-index.hpp"
 
 #include <unordered_set>
 #include <wayfire/nonstd/safe-list.hpp>
@@ -13,6 +14,7 @@ class output_impl_t : public output_t
     std::unordered_multiset<wf::plugin_grab_interface_t*> active_plugins;
     std::unique_ptr<plugin_manager> plugin;
     std::unique_ptr<wf::bindings_repository_t> bindings;
+    std::unique_ptr<wf::input_hit_index_t> input_hit_index;
 
     signal_callback_t view_disappeared_cb;
     bool inhibited = false;
@@ -106,6 +108,9 @@ class output_impl_t : public output_t
     /** @return The bindings repository of the output */
     bindings_repository_t& get_bindings();
 
+    /** @return The index used to find the surface under the cursor */
+    input_hit_index_t& get_input_hit_index();
+
     /** Set the effective resolution of the output */
     void set_effective_size(const wf::dimensions_t& size);
 };
@@ -25,6 +25,7 @@ wf::output_impl_t::output_impl_t(wlr_output *handle,
     this->handle = handle;
     workspace    = std::make_unique<workspace_manager>(this);
     render = std::make_unique<render_manager>(this);
+    input_hit_index = std::make_unique<input_hit_index_t>(this);
 
     view_disappeared_cb = [=] (wf::signal_data_t *data)
     {
@@ -576,6 +577,11 @@ bindings_repository_t& output_impl_t::get_bindings()
     return *bindings;
 }
 
+input_hit_index_t& output_impl_t::get_input_hit_index()
+{
+    return *input_hit_index;
+}
+
 bool output_impl_t::call_plugin(
     const std::string& activator, const wf::activator_data_t& data) const
 {
@@ -0,0 +1,67 @@
+#include "plane-assignment.hpp"
+
+wf::plane_assignment_t wf::assign_planes(
+    const std::vector<plane_candidate_t>& candidates, wf::geometry_t output_box,
+    plane_backend_t& backend)
+{
+    plane_assignment_t result;
+    result.overlays.assign(std::max(0, backend.get_overlay_plane_count()), -1);
+
+    /* Overlay planes are filled from the topmost one, as we go down */
+    int next_overlay = (int)result.overlays.size() - 1;
+
+    /* The part of the output which is not yet hidden by opaque surfaces */
+    wf::region_t visible = output_box;
+    /* The part of the output covered by composited surfaces so far */
+    wf::region_t composited_above;
+
+    for (int i = 0; i < (int)candidates.size(); i++)
+    {
+        const auto& candidate = candidates[i];
+        wf::region_t candidate_visible = visible & candidate.geometry;
+        if (candidate_visible.empty())
+        {
+            continue;
+        }
+
+        /* A candidate which fills the whole plane and hides everything below
+         * it can go on the primary plane, if nothing above is composited. */
+        if (candidate.scanout_capable && result.composited.empty() &&
+            (candidate.geometry == output_box) &&
+            (candidate_visible ^ candidate.opaque).empty())
+        {
+            result.primary = i;
+            if (backend.test(candidates, result))
+            {
+                return result;
+            }
+
+            result.primary = -1;
+        }
+
+        bool on_overlay = false;
+        if (candidate.scanout_capable && (next_overlay >= 0) &&
+            (composited_above & candidate.geometry).empty())
+        {
+            result.overlays[next_overlay] = i;
+            on_overlay = backend.test(candidates, result);
+            if (on_overlay)
+            {
+                --next_overlay;
+            } else
+            {
+                result.overlays[next_overlay] = -1;
+            }
+        }
+
+        if (!on_overlay)
+        {
+            result.composited.push_back(i);
+            composited_above |= candidate_visible;
+        }
+
+        visible ^= candidate.opaque;
+    }
+
+    return result;
+}
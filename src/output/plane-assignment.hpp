@@ -0,0 +1,99 @@
+#ifndef WF_PLANE_ASSIGNMENT_HPP
+#define WF_PLANE_ASSIGNMENT_HPP
+
+#include <vector>
+#include <wayfire/geometry.hpp>
+#include <wayfire/util.hpp>
+
+struct wlr_buffer;
+
+namespace wf
+{
+/**
+ * A surface which is visible on the output, as seen by plane assignment.
+ */
+struct plane_candidate_t
+{
+    /** Identifies the surface for the caller, not used for the assignment. */
+    const void *id = nullptr;
+    /** The buffer which would be shown on a hardware plane. */
+    wlr_buffer *buffer = nullptr;
+    /** The box of the surface in output-local coordinates. */
+    wf::geometry_t geometry;
+    /** The opaque region of the surface in output-local coordinates. */
+    wf::region_t opaque;
+    /**
+     * Whether the buffer can be shown as-is on a plane, i.e the surface has
+     * a buffer, no transformers, and the output's scale and transform.
+     */
+    bool scanout_capable = false;
+};
+
+/**
+ * The result of plane assignment. Candidates are referenced by their index.
+ */
+struct plane_assignment_t
+{
+    /** The candidate on the primary plane, or -1 if it is composited. */
+    int primary = -1;
+    /**
+     * The candidate on each overlay plane, or -1 if the plane is unused.
+     * Overlay planes are stacked above the primary plane, in the order of
+     * their index (the last one is the topmost).
+     */
+    std::vector<int> overlays;
+    /** Visible candidates which need to be composited, from top to bottom. */
+    std::vector<int> composited;
+};
+
+/**
+ * The hardware side of plane assignment.
+ */
+class plane_backend_t
+{
+  public:
+    virtual ~plane_backend_t() = default;
+
+    /** @return The number of overlay planes available for surfaces. */
+    virtual int get_overlay_plane_count() = 0;
+
+    /**
+     * Check whether the hardware accepts the given (possibly partial)
+     * assignment. Must not change the state of the output.
+     */
+    virtual bool test(const std::vector<plane_candidate_t>& candidates,
+        const plane_assignment_t& assignment) = 0;
+
+    /**
+     * Show the given assignment, which does not need composition, i.e it has
+     * a primary candidate.
+     *
+     * @return Whether the commit succeeded.
+     */
+    virtual bool commit(const std::vector<plane_candidate_t>& candidates,
+        const plane_assignment_t& assignment) = 0;
+};
+
+/**
+ * Assign the visible surfaces of an output to hardware planes.
+ *
+ * Candidates are walked from top to bottom. Candidates fully hidden by opaque
+ * surfaces above them are dropped. For each scanout-capable candidate:
+ *
+ * 1. If nothing above it is composited, it covers the whole output and it is
+ *    opaque wherever it is visible, it goes on the primary plane. Everything
+ *    below it is hidden, so no composition is needed at all.
+ * 2. Otherwise, it goes on the next free overlay plane, provided no
+ *    composited candidate above it overlaps it.
+ *
+ * Each step is checked with the backend. If the backend rejects it, or if
+ * the candidate cannot be scanned out, it falls back to composition.
+ *
+ * @param candidates The visible surfaces, from the topmost to the bottommost.
+ * @param output_box The box of the output, in output-local coordinates.
+ */
+plane_assignment_t assign_planes(const std::vector<plane_candidate_t>& candidates,
+    wf::geometry_t output_box, plane_backend_t& backend);
+}
+
+#endif /* end of include guard: WF_PLANE_ASSIGNMENT_HPP */
@@ -9,7 +9,14 @@
 #include "../core/seat/seat.hpp"
 #include "../core/opengl-priv.hpp"
 #include "../main.hpp"
+#include "damage-coalescer.hpp"
+#include "frame-pool.hpp"
+#include "frame-timing.hpp"
+#include "plane-assignment.hpp"
 #include <algorithm>
+#include <array>
+#include <cmath>
+#include <unordered_set>
 #include <wayfire/nonstd/reverse.hpp>
 #include <wayfire/nonstd/safe-list.hpp>
 #include <wayfire/util/log.hpp>
@@ -110,6 +117,30 @@ struct output_damage_t
         }
     }
 
+    wf::option_wrapper_t<int> coalesce_waste{"core/damage_coalesce_waste"};
+    wf::option_wrapper_t<int> max_damage_rects{"core/damage_max_rects"};
+
+    /**
+     * Merge the boxes of the damage for the current frame, see
+     * coalesce_damage(). Needs to be called after accumulate_damage().
+     *
+     * Only the damage on the visible part of the output is coalesced. The
+     * damage on other workspaces is left as it is, so that it isn't merged
+     * with the visible damage into boxes which span several workspaces.
+     */
+    damage_coalesce_stats_t coalesce()
+    {
+        damage_coalesce_policy_t policy;
+        policy.max_waste = coalesce_waste / 100.0;
+        policy.max_rects = max_damage_rects;
+
+        auto visible = frame_damage & get_wlr_damage_box();
+        auto stats   = coalesce_damage(visible, policy);
+        frame_damage |= visible;
+
+        return stats;
+    }
+
     /**
      * Return the damage that has been scheduled for the next frame up to now,
      * or, if in a repaint, the damage for the current frame
@@ -531,6 +562,14 @@ class depth_buffer_manager_t : public noncopyable_t
  * delay is increased by one. If the next frame is delayed, then
  * `increase_window` is doubled, otherwise, it is halved
  * (but it must stay between `MIN_INCREASE_WINDOW` and `MAX_INCREASE_WINDOW`).
+ *
+ * Alternatively, if core/predictive_repaint_delay is set, the delay is
+ * calculated from the measured render times instead: the time from the start
+ * of the repaint until the commit is recorded for the last
+ * `RENDER_TIME_WINDOW` frames, and the delay is set so that a frame which
+ * takes as long as the 99th percentile of them plus `RENDER_TIME_MARGIN` is
+ * still on time. Because the window is short, the delay follows changes of
+ * the workload within a few frames.
  */
 struct repaint_delay_manager_t
 {
@@ -554,11 +593,32 @@ struct repaint_delay_manager_t
         last_pageflip = -1;
     }
 
+    /**
+     * Record how long it took to render and commit the last frame.
+     */
+    void add_render_time(int64_t nsec)
+    {
+        render_times[next_render_time] = nsec;
+        next_render_time = (next_render_time + 1) % RENDER_TIME_WINDOW;
+        num_render_times = std::min(num_render_times + 1, RENDER_TIME_WINDOW);
+
+        if (predictive_delay)
+        {
+            update_predicted_delay();
+        }
+    }
+
     /**
      * Starting a new frame.
      */
     void start_frame()
     {
+        if (predictive_delay)
+        {
+            /* The delay is updated when render times are added */
+            return;
+        }
+
         if (last_pageflip == -1)
         {
             last_pageflip = get_current_time();
@@ -616,6 +676,15 @@ struct repaint_delay_manager_t
         return delay;
     }
 
+    /**
+     * @return The refresh interval of the output in nanoseconds, or 0 if it
+     *   is not known yet.
+     */
+    int64_t get_refresh_nsec() const
+    {
+        return refresh_nsec;
+    }
+
   private:
     int delay = 0;
 
@@ -638,6 +707,33 @@ struct repaint_delay_manager_t
         delay = clamp(delay + delta, min, max);
     }
 
+    void update_predicted_delay()
+    {
+        if ((max_render_time == -1) || (refresh_nsec <= 0))
+        {
+            delay = 0;
+            return;
+        }
+
+        std::array<int64_t, RENDER_TIME_WINDOW> sorted;
+        auto end = std::copy_n(render_times.begin(), num_render_times,
+            sorted.begin());
+        auto p99 = sorted.begin() + (num_render_times * 99 + 99) / 100 - 1;
+        std::nth_element(sorted.begin(), p99, end);
+
+        const int64_t delay_nsec = refresh_nsec - *p99 - RENDER_TIME_MARGIN;
+        const int config_delay   = std::max(0,
+            (int)(this->refresh_nsec / 1e6) - max_render_time);
+
+        delay = clamp((int)(delay_nsec / 1'000'000), 0, config_delay);
+    }
+
+    static constexpr int RENDER_TIME_WINDOW    = 32; // frames
+    static constexpr int64_t RENDER_TIME_MARGIN = 1'000'000; // 1ms
+    std::array<int64_t, RENDER_TIME_WINDOW> render_times;
+    int next_render_time = 0;
+    int num_render_times = 0;
+
     void reset_increase_timer()
     {
         last_increase = get_current_time();
@@ -657,13 +753,175 @@ struct repaint_delay_manager_t
     // Time of last frame
     int64_t last_pageflip = -1; // -1 is invalid
 
-    int64_t refresh_nsec;
+    int64_t refresh_nsec = 0;
     wf::option_wrapper_t<int> max_render_time{"core/max_render_time"};
+    wf::option_wrapper_t<bool> predictive_delay{"core/predictive_repaint_delay"};
     wf::option_wrapper_t<bool> dynamic_delay{"workarounds/dynamic_repaint_delay"};
 
     wf::wl_listener_wrapper on_present;
 };
 
+/**
+ * Adjusts the quality of expensive effects, so that the output can keep up
+ * with its refresh rate.
+ *
+ * After each frame, the time needed to render it is compared to the budget,
+ * which is the part of the refresh interval left after the repaint delay.
+ *
+ * If at least OVERRUN_THRESHOLD of the last OVERRUN_WINDOW frames were over
+ * budget, the control with the highest relative quality is stepped down. If
+ * the last HEADROOM_FRAMES frames all took less than HEADROOM_FRACTION of the
+ * budget, the control with the lowest relative quality is stepped up again.
+ * After each change, measuring starts anew, so that the effect of the change
+ * is known before the next one. Going up is deliberately much slower than
+ * going down, to avoid oscillating between two levels.
+ */
+struct render_budget_manager_t
+{
+    render_budget_manager_t()
+    {
+        adaptive_quality.set_callback([=] ()
+        {
+            if (!adaptive_quality)
+            {
+                restore_full_quality();
+            }
+        });
+    }
+
+    void add_control(quality_control_t *control)
+    {
+        control->level = std::max(control->num_levels - 1, 0);
+        controls.push_back(control);
+    }
+
+    void rem_control(quality_control_t *control)
+    {
+        controls.remove_all(control);
+    }
+
+    /**
+     * Record the time it took to render the last frame.
+     *
+     * @param budget_nsec The time which was available for rendering, or 0 if
+     *   it is not known.
+     */
+    void add_frame(int64_t render_nsec, int64_t budget_nsec)
+    {
+        if (!adaptive_quality || (budget_nsec <= 0) || (controls.size() == 0))
+        {
+            reset_window();
+            return;
+        }
+
+        ++window_frames;
+        if (render_nsec > budget_nsec)
+        {
+            ++window_overruns;
+            headroom_frames = 0;
+        } else if (render_nsec < budget_nsec * HEADROOM_FRACTION)
+        {
+            ++headroom_frames;
+        } else
+        {
+            headroom_frames = 0;
+        }
+
+        if (window_overruns >= OVERRUN_THRESHOLD)
+        {
+            step(-1);
+            reset_window();
+        } else if (headroom_frames >= HEADROOM_FRAMES)
+        {
+            step(+1);
+            reset_window();
+        } else if (window_frames >= OVERRUN_WINDOW)
+        {
+            window_frames   = 0;
+            window_overruns = 0;
+        }
+    }
+
+  private:
+    static constexpr int OVERRUN_WINDOW    = 16; // frames
+    static constexpr int OVERRUN_THRESHOLD = 4; // frames
+    static constexpr int HEADROOM_FRAMES   = 120; // frames
+    static constexpr double HEADROOM_FRACTION = 0.6;
+
+    wf::safe_list_t<quality_control_t*> controls;
+    int window_frames   = 0;
+    int window_overruns = 0;
+    int headroom_frames = 0;
+
+    wf::option_wrapper_t<bool> adaptive_quality{"core/adaptive_quality"};
+
+    void reset_window()
+    {
+        window_frames   = 0;
+        window_overruns = 0;
+        headroom_frames = 0;
+    }
+
+    static double relative_level(quality_control_t *control)
+    {
+        if (control->num_levels <= 1)
+        {
+            return 1.0;
+        }
+
+        return 1.0 * control->level / (control->num_levels - 1);
+    }
+
+    /** Lower (-1) or raise (+1) the level of a single control */
+    void step(int direction)
+    {
+        quality_control_t *best = nullptr;
+        controls.for_each([&] (quality_control_t *control)
+        {
+            int next = control->level + direction;
+            if ((next < 0) || (next >= control->num_levels))
+            {
+                return;
+            }
+
+            if (!best ||
+                (direction * relative_level(control) <
+                 direction * relative_level(best)))
+            {
+                best = control;
+            }
+        });
+
+        if (best)
+        {
+            set_level(best, best->level + direction);
+        }
+    }
+
+    void restore_full_quality()
+    {
+        controls.for_each([&] (quality_control_t *control)
+        {
+            set_level(control, std::max(control->num_levels - 1, 0));
+        });
+    }
+
+    void set_level(quality_control_t *control, int level)
+    {
+        if (control->level == level)
+        {
+            return;
+        }
+
+        LOGD("Changing quality level from ", control->level, " to ", level);
+        control->level = level;
+        if (control->set_level)
+        {
+            control->set_level(level);
+        }
+    }
+};
+
 class wf::render_manager::impl
 {
   public:
@@ -677,6 +935,8 @@ class wf::render_manager::impl
     std::unique_ptr<postprocessing_manager_t> postprocessing;
     std::unique_ptr<depth_buffer_manager_t> depth_buffer_manager;
     std::unique_ptr<repaint_delay_manager_t> delay_manager;
+    std::unique_ptr<frame_timing_recorder_t> frame_timing;
+    std::unique_ptr<render_budget_manager_t> render_budget;
 
     wf::option_wrapper_t<wf::color_t> background_color_opt;
 
@@ -688,6 +948,11 @@ class wf::render_manager::impl
         postprocessing = std::make_unique<postprocessing_manager_t>(o);
         depth_buffer_manager = std::make_unique<depth_buffer_manager_t>();
         delay_manager = std::make_unique<repaint_delay_manager_t>(o);
+        render_budget = std::make_unique<render_budget_manager_t>();
+
+        OpenGL::render_begin();
+        frame_timing = std::make_unique<frame_timing_recorder_t>();
+        OpenGL::render_end();
 
         on_frame.set_callback([&] (void*)
         {
@@ -723,9 +988,17 @@ class wf::render_manager::impl
             output_damage->damage_whole_idle();
         });
 
+        output->connect_signal("view-disappeared", &on_view_disappeared);
         output_damage->schedule_repaint();
     }
 
+    ~impl()
+    {
+        OpenGL::render_begin();
+        frame_timing.reset();
+        OpenGL::render_end();
+    }
+
     // Workspace stream for the current workspace, drawn on the output's buffer
     workspace_stream_t default_stream;
 
@@ -805,9 +1078,52 @@ class wf::render_manager::impl
         workspace_stream_update(default_stream);
     }
 
-    wayfire_view last_scanout;
     /**
-     * Try to directly scanout a view
+     * Plane backend for the output. wlroots does not expose overlay planes, so
+     * only the primary plane is used.
+     */
+    class wlr_plane_backend_t : public wf::plane_backend_t
+    {
+      public:
+        wlr_output *handle;
+        wlr_plane_backend_t(wlr_output *handle) : handle(handle)
+        {}
+
+        int get_overlay_plane_count() override
+        {
+            return 0;
+        }
+
+        bool test(const std::vector<wf::plane_candidate_t>& candidates,
+            const wf::plane_assignment_t& assignment) override
+        {
+            if (assignment.primary < 0)
+            {
+                return false;
+            }
+
+            wlr_output_attach_buffer(handle, candidates[assignment.primary].buffer);
+            bool result = wlr_output_test(handle);
+            wlr_output_rollback(handle);
+            return result;
+        }
+
+        bool commit(const std::vector<wf::plane_candidate_t>& candidates,
+            const wf::plane_assignment_t& assignment) override
+        {
+            wlr_output_attach_buffer(handle, candidates[assignment.primary].buffer);
+            return wlr_output_commit(handle);
+        }
+    };
+
+    const void *last_scanout = nullptr;
+    /* The candidates of do_direct_scanout(), kept to reuse their storage */
+    std::vector<wf::plane_candidate_t> scanout_candidates;
+    std::vector<wlr_surface*> scanout_surfaces;
+
+    /**
+     * Try to show the visible surfaces directly on the output's planes,
+     * without compositing them.
      */
     bool do_direct_scanout()
     {
@@ -823,64 +1139,70 @@ class wf::render_manager::impl
             return false;
         }
 
-        auto views = output->workspace->get_views_on_workspace(
-            output->workspace->get_current_workspace(), wf::VISIBLE_LAYERS);
-
-        if (views.empty())
-        {
-            return false;
-        }
-
-        auto candidate = views.front();
-
-        // The candidate must cover the whole output
-        if (candidate->get_output_geometry() != output->get_relative_geometry())
-        {
-            return false;
-        }
+        scanout_candidates.clear();
+        scanout_surfaces.clear();
+        for_each_visible_surface(output->workspace->get_current_workspace(),
+            {0, 0},
+            [&] (wayfire_view view, wf::point_t view_delta)
+        {
+            wf::plane_candidate_t candidate;
+            candidate.id = view.get();
+            candidate.geometry = view->get_bounding_box();
+            candidate.opaque   = view->get_transformed_opaque_region();
+            scanout_candidates.push_back(std::move(candidate));
+            scanout_surfaces.push_back(nullptr);
+        },
+            [&] (wf::surface_interface_t *surface, wf::point_t pos)
+        {
+            auto wlr_surf = surface->get_wlr_surface();
+
+            wf::plane_candidate_t candidate;
+            candidate.id = surface;
+            candidate.geometry = {pos.x, pos.y,
+                surface->get_size().width, surface->get_size().height};
+            candidate.opaque = surface->get_opaque_region(pos);
+            candidate.scanout_capable = wlr_surf && wlr_surf->buffer &&
+                (wlr_surf->current.scale == output->handle->scale) &&
+                (wlr_surf->current.transform == output->handle->transform);
+            if (candidate.scanout_capable)
+            {
+                candidate.buffer = &wlr_surf->buffer->base;
+            }
 
-        // The view must have only a single surface and no transformers
-        if (candidate->has_transformer() ||
-            !candidate->priv->surface_children_above.empty() ||
-            !candidate->children.empty())
-        {
-            return false;
-        }
+            scanout_candidates.push_back(std::move(candidate));
+            scanout_surfaces.push_back(wlr_surf);
+        });
 
-        // Must have a wlr surface with the correct scale and transform
-        auto surface = candidate->get_wlr_surface();
-        if (!surface ||
-            (surface->current.scale != output->handle->scale) ||
-            (surface->current.transform != output->handle->transform))
+        if (scanout_candidates.empty())
         {
             return false;
         }
 
-        // Finally, the opaque region must be the full surface.
-        wf::region_t non_opaque = output->get_relative_geometry();
-        non_opaque ^= candidate->get_opaque_region(wf::point_t{0, 0});
-        if (!non_opaque.empty())
+        wlr_plane_backend_t backend{output->handle};
+        auto assignment = wf::assign_planes(scanout_candidates,
+            output->get_relative_geometry(), backend);
+        if (assignment.primary < 0)
         {
             return false;
         }
 
         wlr_presentation_surface_sampled_on_output(
-            wf::get_core().protocols.presentation, surface, output->handle);
-        wlr_output_attach_buffer(output->handle, &surface->buffer->base);
+            wf::get_core().protocols.presentation,
+            scanout_surfaces[assignment.primary], output->handle);
 
-        if (wlr_output_commit(output->handle))
+        const void *id = scanout_candidates[assignment.primary].id;
+        if (backend.commit(scanout_candidates, assignment))
         {
-            if (candidate != last_scanout)
+            if (id != last_scanout)
             {
-                last_scanout = candidate;
-                LOGD("Scanned out ",
-                    candidate->get_title(), ",", candidate->get_app_id());
+                last_scanout = id;
+                LOGD("Scanned out surface ", id, " on ", output->to_string());
             }
 
             return true;
         } else
         {
-            LOGD("Failed to scan out view ", candidate->get_title());
+            LOGD("Failed to scan out surface ", id);
             return false;
         }
     }
@@ -933,14 +1255,26 @@ class wf::render_manager::impl
      */
     void paint()
     {
+        frame_timing->begin_frame();
+
         /* Part 1: frame setup: query damage, etc. */
+        frame_timing->begin_phase(FRAME_PHASE_EFFECT_PRE);
         effects->run_effects(OUTPUT_EFFECT_PRE);
+        frame_timing->end_phase(FRAME_PHASE_EFFECT_PRE);
+
+        frame_timing->begin_phase(FRAME_PHASE_EFFECT_DAMAGE);
         effects->run_effects(OUTPUT_EFFECT_DAMAGE);
+        frame_timing->end_phase(FRAME_PHASE_EFFECT_DAMAGE);
 
-        if (do_direct_scanout())
+        frame_timing->begin_phase(FRAME_PHASE_COMMIT);
+        bool scanned_out = do_direct_scanout();
+        frame_timing->end_phase(FRAME_PHASE_COMMIT);
+        if (scanned_out)
         {
             // Yet another optimization: if we can directly scanout, we should
             // stop the rest of the repaint cycle.
+            release_frame_arena();
+            end_frame(FRAME_RESULT_SCANOUT);
             return;
         } else
         {
@@ -952,6 +1286,8 @@ class wf::render_manager::impl
         {
             wlr_output_rollback(output->handle);
             delay_manager->skip_frame();
+            release_frame_arena();
+            end_frame(FRAME_RESULT_SKIPPED);
             return;
         }
 
@@ -962,6 +1298,8 @@ class wf::render_manager::impl
              * repaint */
             wlr_output_rollback(output->handle);
             delay_manager->skip_frame();
+            release_frame_arena();
+            end_frame(FRAME_RESULT_SKIPPED);
             return;
         }
 
@@ -969,15 +1307,23 @@ class wf::render_manager::impl
         // Doing this earlier may mean that the damage from the previous frames
         // creeps into the current frame damage, if we had skipped a frame.
         output_damage->accumulate_damage();
+        auto coalesce_stats = output_damage->coalesce();
+        frame_timing->set_damage_stats(coalesce_stats.rects_after,
+            coalesce_stats.rects_before - coalesce_stats.rects_after,
+            coalesce_stats.area_added);
 
         update_bound_output();
 
         /* Part 2: call the renderer, which sets swap_damage and
          * draws the scenegraph */
+        frame_timing->begin_phase(FRAME_PHASE_RENDER, true);
         render_output();
+        frame_timing->end_phase(FRAME_PHASE_RENDER, true);
 
         /* Part 3: overlay effects */
+        frame_timing->begin_phase(FRAME_PHASE_EFFECT_OVERLAY, true);
         effects->run_effects(OUTPUT_EFFECT_OVERLAY);
+        frame_timing->end_phase(FRAME_PHASE_EFFECT_OVERLAY, true);
 
         if (postprocessing->post_effects.size())
         {
@@ -985,6 +1331,7 @@ class wf::render_manager::impl
         }
 
         /* Part 4: finalize the scene: postprocessing effects */
+        frame_timing->begin_phase(FRAME_PHASE_POSTPROCESSING, true);
         postprocessing->run_post_effects();
         if (output_inhibit_counter)
         {
@@ -994,9 +1341,12 @@ class wf::render_manager::impl
             OpenGL::render_end();
         }
 
+        frame_timing->end_phase(FRAME_PHASE_POSTPROCESSING, true);
+
         /* Part 5: render sw cursors
          * We render software cursors after everything else
          * for consistency with hardware cursor planes */
+        frame_timing->begin_phase(FRAME_PHASE_SOFTWARE_CURSOR, true);
         OpenGL::render_begin();
         wlr_renderer_begin(wf::get_core().renderer,
             output->handle->width, output->handle->height);
@@ -1004,12 +1354,21 @@ class wf::render_manager::impl
             swap_damage.to_pixman());
         wlr_renderer_end(wf::get_core().renderer);
         OpenGL::render_end();
+        frame_timing->end_phase(FRAME_PHASE_SOFTWARE_CURSOR, true);
 
         /* Part 6: finalize frame: swap buffers, send frame_done, etc */
         OpenGL::unbind_output(output);
+        frame_timing->begin_phase(FRAME_PHASE_COMMIT);
         output_damage->swap_buffers(swap_damage);
+        frame_timing->end_phase(FRAME_PHASE_COMMIT);
+        const int64_t render_nsec = frame_timing->get_frame_elapsed_nsec();
+        delay_manager->add_render_time(render_nsec);
+        render_budget->add_frame(render_nsec, delay_manager->get_refresh_nsec() -
+            delay_manager->get_delay() * 1'000'000ll);
         swap_damage.clear();
+        release_frame_arena();
         post_paint();
+        end_frame(FRAME_RESULT_RENDERED);
     }
 
     /**
@@ -1017,7 +1376,9 @@ class wf::render_manager::impl
      */
     void post_paint()
     {
+        frame_timing->begin_phase(FRAME_PHASE_EFFECT_POST);
         effects->run_effects(OUTPUT_EFFECT_POST);
+        frame_timing->end_phase(FRAME_PHASE_EFFECT_POST);
 
         if (constant_redraw_counter)
         {
@@ -1025,12 +1386,116 @@ class wf::render_manager::impl
         }
     }
 
+    /**
+     * Finish measuring the current repaint cycle.
+     */
+    void end_frame(frame_result_t result)
+    {
+        frame_timing->end_frame(result, delay_manager->get_delay());
+    }
+
+    /**
+     * Find the surfaces on the current workspace which are fully covered by the
+     * opaque regions of the surfaces above them.
+     *
+     * This runs the same opaque region subtraction as check_schedule_surfaces(),
+     * but starting with the whole workspace instead of the damaged region.
+     */
+    void find_occluded_surfaces(
+        std::unordered_set<wf::surface_interface_t*>& occluded)
+    {
+        occluded.clear();
+        if (renderer)
+        {
+            /* Custom renderers may show anything, including other workspaces */
+            return;
+        }
+
+        wf::region_t visible = output->get_relative_geometry();
+        for_each_visible_surface(output->workspace->get_current_workspace(),
+            {0, 0},
+            [&] (wayfire_view view, wf::point_t view_delta)
+        {
+            if ((visible & view->get_bounding_box()).empty())
+            {
+                for (auto child : view->get_surface_tree())
+                {
+                    occluded.insert(child.surface);
+                }
+            }
+
+            visible ^= view->get_transformed_opaque_region();
+        },
+            [&] (wf::surface_interface_t *surface, wf::point_t pos)
+        {
+            wlr_box box = {
+                .x     = pos.x,
+                .y     = pos.y,
+                .width = surface->get_size().width,
+                .height = surface->get_size().height
+            };
+
+            if ((visible & box).empty())
+            {
+                occluded.insert(surface);
+            }
+
+            visible ^= surface->get_opaque_region(pos);
+        });
+    }
+
+    /**
+     * Update the occlusion state of a view and notify plugins if it changed.
+     */
+    void set_view_occluded(wayfire_view view, bool occluded)
+    {
+        if (view->view_impl->occluded == occluded)
+        {
+            return;
+        }
+
+        view->view_impl->occluded = occluded;
+
+        view_occlusion_changed_signal data;
+        data.view     = view;
+        data.occluded = occluded;
+        view->emit_signal("occlusion-changed", &data);
+        output->emit_signal("view-occlusion-changed", &data);
+    }
+
+    wf::option_wrapper_t<int> occluded_frame_rate{"core/occluded_frame_rate"};
+    wf::wl_timer occluded_frame_timer;
+
+    /** The surfaces found by find_occluded_surfaces() for the current frame */
+    std::unordered_set<wf::surface_interface_t*> occluded_surfaces;
+    /**
+     * The views which were occluded in the last frame. They are the only views
+     * of the output whose occluded flag may be set.
+     */
+    std::vector<wayfire_view> occluded_views;
+    std::vector<wayfire_view> next_occluded_views;
+    /** Occlusion state changes, emitted after all views have been visited */
+    std::vector<std::pair<wayfire_view, bool>> occlusion_changes;
+
+    wf::signal_connection_t on_view_disappeared = [=] (wf::signal_data_t *data)
+    {
+        auto view = get_signaled_view(data);
+        auto it   = std::find(occluded_views.begin(), occluded_views.end(), view);
+        if (it != occluded_views.end())
+        {
+            occluded_views.erase(it);
+            set_view_occluded(view, false);
+        }
+    };
+
     /**
      * Send frame_done to clients.
+     *
+     * Surfaces which are fully occluded receive frame events at most
+     * core/occluded_frame_rate times per second.
      */
     void send_frame_done()
     {
-        /* TODO: do this only if the view isn't fully occluded by another */
         std::vector<wayfire_view> visible_views;
         if (renderer)
         {
@@ -1050,37 +1515,121 @@ class wf::render_manager::impl
                 additional_views.begin(), additional_views.end());
         }
 
+        const int rate = occluded_frame_rate;
+        auto& occluded = occluded_surfaces;
+        if (rate > 0)
+        {
+            find_occluded_surfaces(occluded);
+        } else
+        {
+            occluded.clear();
+        }
+
+        occlusion_changes.clear();
+        next_occluded_views.clear();
+
+        const uint32_t now = get_current_time();
+        const uint32_t occluded_interval = rate > 0 ? 1000 / rate : 0;
+        bool throttled = false;
+
         timespec repaint_ended;
         clockid_t presentation_clock =
             wlr_backend_get_presentation_clock(wf::get_core_impl().backend);
         clock_gettime(presentation_clock, &repaint_ended);
         for (auto& v : visible_views)
         {
-            for (auto& view : v->enumerate_views())
+            for (auto& view : v->get_view_tree())
             {
                 if (!view->is_mapped())
                 {
                     continue;
                 }
 
-                for (auto& child : view->enumerate_surfaces())
+                bool view_occluded = true;
+                for (auto child : view->get_surface_tree())
                 {
+                    auto& last_frame_done = child.surface->priv->last_frame_done;
+                    if (occluded.count(child.surface))
+                    {
+                        if (now - last_frame_done < occluded_interval)
+                        {
+                            throttled = true;
+                            continue;
+                        }
+                    } else
+                    {
+                        view_occluded = false;
+                    }
+
+                    last_frame_done = now;
                     child.surface->send_frame_done(repaint_ended);
                 }
+
+                if (view_occluded)
+                {
+                    next_occluded_views.push_back(view);
+                }
+
+                if (view->view_impl->occluded != view_occluded)
+                {
+                    occlusion_changes.push_back({view, view_occluded});
+                }
+            }
+        }
+
+        /* Views which were occluded but weren't visited this time, for ex.
+         * because they are on another workspace now, aren't occluded anymore */
+        for (auto& view : occluded_views)
+        {
+            bool visited = std::any_of(occlusion_changes.begin(),
+                occlusion_changes.end(), [&] (const auto& change)
+            {
+                return change.first == view;
+            });
+            visited |= std::find(next_occluded_views.begin(),
+                next_occluded_views.end(), view) != next_occluded_views.end();
+
+            if (!visited)
+            {
+                occlusion_changes.push_back({view, false});
             }
         }
+
+        std::swap(occluded_views, next_occluded_views);
+
+        /* Emit the signals only now, as plugins may change the view tree in
+         * response to them */
+        for (auto& [view, view_occluded] : occlusion_changes)
+        {
+            /* An earlier handler may have unmapped the view */
+            if (view->is_mapped() || !view_occluded)
+            {
+                set_view_occluded(view, view_occluded);
+            }
+        }
+
+        if (throttled && !occluded_frame_timer.is_connected())
+        {
+            /* Occluded clients are waiting for a frame event, so we need to
+             * make sure we get a frame even if nothing else is damaged. There
+             * is no need to force a repaint though. */
+            occluded_frame_timer.set_timeout(occluded_interval, [=] ()
+            {
+                wlr_output_schedule_frame(output->handle);
+                return false;
+            });
+        }
     }
 
     /* Workspace stream implementation */
     void workspace_stream_start(workspace_stream_t& stream)
     {
         stream.running = true;
-        stream.scale_x = stream.scale_y = 1;
 
         /* damage the whole workspace region, so that we get a full repaint
          * when updating the workspace */
         output_damage->damage(output_damage->get_ws_box(stream.ws));
-        workspace_stream_update(stream, 1, 1);
+        workspace_stream_update(stream, stream.scale_x, stream.scale_y);
     }
 
     /**
@@ -1098,7 +1647,45 @@ class wf::render_manager::impl
         wf::region_t damage;
     };
 
-    using damaged_surface = std::unique_ptr<damaged_surface_t>;
+    /**
+     * Storage for the temporary data needed while repainting.
+     *
+     * Everything allocated from the arena is valid until the frame has been
+     * submitted (see release_frame_arena()), afterwards it is reused for the
+     * next frames.
+     */
+    struct frame_arena_t
+    {
+        frame_pool_t<damaged_surface_t> damaged_surfaces;
+        frame_pool_t<std::vector<damaged_surface_t*>> render_lists;
+
+        damaged_surface_t *alloc_damaged_surface()
+        {
+            auto ds = damaged_surfaces.acquire();
+            ds->surface = nullptr;
+            ds->view    = nullptr;
+
+            return ds;
+        }
+
+        /** @return How many times the arena grew since the last reset */
+        size_t reset()
+        {
+            return damaged_surfaces.reset() + render_lists.reset();
+        }
+    } frame_arena;
+
+    /* How many times the frame arena grew in the last frame */
+    size_t last_frame_arena_growth = 0;
+
+    /**
+     * Release all objects allocated from the frame arena. Must be called at the
+     * end of each frame, whether it was rendered or not.
+     */
+    void release_frame_arena()
+    {
+        last_frame_arena_growth = frame_arena.reset();
+    }
 
     /**
      * Represents the state while calculating what parts of the output
@@ -1106,7 +1693,8 @@ class wf::render_manager::impl
      */
     struct workspace_stream_repaint_t
     {
-        std::vector<damaged_surface> to_render;
+        /* Allocated from the frame arena */
+        std::vector<damaged_surface_t*> *to_render;
         wf::region_t ws_damage;
         wf::framebuffer_t fb;
 
@@ -1123,17 +1711,22 @@ class wf::render_manager::impl
     void schedule_snapshotted_view(workspace_stream_repaint_t& repaint,
         wayfire_view view, wf::point_t view_delta)
     {
-        auto ds = damaged_surface(new damaged_surface_t);
+        auto ds = frame_arena.alloc_damaged_surface();
 
+        /* Intersect directly into the pooled region, so that its storage is
+         * reused between frames */
         auto bbox = view->get_bounding_box() + view_delta;
-        ds->damage = (repaint.ws_damage & bbox) + -view_delta;
+        pixman_region32_intersect_rect(ds->damage.to_pixman(),
+            repaint.ws_damage.to_pixman(),
+            bbox.x, bbox.y, bbox.width, bbox.height);
+        ds->damage += -view_delta;
         if (!ds->damage.empty())
         {
             ds->pos  = -view_delta;
             ds->view = view.get();
             repaint.ws_damage ^=
                 view->get_transformed_opaque_region() + view_delta;
-            repaint.to_render.push_back(std::move(ds));
+            repaint.to_render->push_back(ds);
         }
     }
 
@@ -1154,7 +1747,7 @@ class wf::render_manager::impl
             return;
         }
 
-        auto ds = damaged_surface(new damaged_surface_t);
+        auto ds = frame_arena.alloc_damaged_surface();
         wlr_box obox = {
             .x     = pos.x,
             .y     = pos.y,
@@ -1162,7 +1755,9 @@ class wf::render_manager::impl
             .height = surface->get_size().height
         };
 
-        ds->damage = repaint.ws_damage & obox;
+        pixman_region32_intersect_rect(ds->damage.to_pixman(),
+            repaint.ws_damage.to_pixman(),
+            obox.x, obox.y, obox.width, obox.height);
         if (!ds->damage.empty())
         {
             ds->pos     = pos;
@@ -1171,7 +1766,7 @@ class wf::render_manager::impl
             /* Subtract opaque region from workspace damage. The views below
              * won't be visible, so no need to damage them */
             repaint.ws_damage ^= ds->surface->get_opaque_region(pos);
-            repaint.to_render.push_back(std::move(ds));
+            repaint.to_render->push_back(ds);
         }
     }
 
@@ -1190,7 +1785,7 @@ class wf::render_manager::impl
             wf::point_t current_output = wf::origin(output->get_layout_geometry());
             auto origin = wf::origin(xw_dnd_icon->get_output_geometry()) +
                 dnd_output + -current_output;
-            for (auto& child : xw_dnd_icon->enumerate_surfaces(origin))
+            for (auto child : xw_dnd_icon->get_surface_tree(origin))
             {
                 schedule_surface(repaint, child.surface, child.position);
             }
@@ -1209,7 +1804,7 @@ class wf::render_manager::impl
         offset.x -= og.x;
         offset.y -= og.y;
 
-        for (auto& child : drag_icon->enumerate_surfaces(offset))
+        for (auto child : drag_icon->get_surface_tree(offset))
         {
             schedule_surface(repaint, child.surface, child.position);
         }
@@ -1228,29 +1823,36 @@ class wf::render_manager::impl
     }
 
     /**
-     * Iterate all visible surfaces on the workspace, and check whether
-     * they need repaint.
+     * Iterate all visible views and surfaces on the workspace, from the topmost
+     * to the bottom-most one.
+     *
+     * @param view_delta The offset to add to sticky views.
+     * @param for_snapshot Called for views which are rendered with their
+     *   snapshot, together with their offset.
+     * @param for_surface Called for each surface of views which are rendered
+     *   directly, together with its position on the workspace.
      */
-    void check_schedule_surfaces(workspace_stream_repaint_t& repaint,
-        workspace_stream_t& stream)
+    template<class SnapshotCallback, class SurfaceCallback>
+    void for_each_visible_surface(wf::point_t ws, wf::point_t sticky_delta,
+        SnapshotCallback for_snapshot, SurfaceCallback for_surface)
     {
-        auto views = output->workspace->get_views_on_workspace(stream.ws,
+        /* The callbacks must not query the views on other workspaces */
+        auto& views = output->workspace->get_views_on_workspace_cached(ws,
             wf::VISIBLE_LAYERS);
 
-        schedule_drag_icon(repaint);
         for (auto& v : views)
         {
-            for (auto& view : v->enumerate_views(false))
+            for (auto& view : v->get_view_tree(false))
             {
-                wf::point_t view_delta{0, 0};
-                if (!view->is_visible() || repaint.ws_damage.empty())
+                if (!view->is_visible())
                 {
                     continue;
                 }
 
+                wf::point_t view_delta{0, 0};
                 if (view->sticky)
                 {
-                    view_delta = {repaint.ws_dx, repaint.ws_dy};
+                    view_delta = sticky_delta;
                 }
 
                 /* We use the snapshot of a view on either of the following
@@ -1264,21 +1866,40 @@ class wf::render_manager::impl
                 {
                     /* Snapshotted views include all of their subsurfaces, so we
                      * don't recursively go into subsurfaces. */
-                    schedule_snapshotted_view(repaint, view, view_delta);
+                    for_snapshot(view, view_delta);
                 } else
                 {
                     /* Make sure view position is relative to the workspace
                      * being rendered */
                     auto obox = view->get_output_geometry() + view_delta;
-                    for (auto& child : view->enumerate_surfaces({obox.x, obox.y}))
+                    for (auto child : view->get_surface_tree({obox.x, obox.y}))
                     {
-                        schedule_surface(repaint, child.surface, child.position);
+                        for_surface(child.surface, child.position);
                     }
                 }
             }
         }
     }
 
+    /**
+     * Iterate all visible surfaces on the workspace, and check whether
+     * they need repaint.
+     */
+    void check_schedule_surfaces(workspace_stream_repaint_t& repaint,
+        workspace_stream_t& stream)
+    {
+        schedule_drag_icon(repaint);
+        for_each_visible_surface(stream.ws, {repaint.ws_dx, repaint.ws_dy},
+            [&] (wayfire_view view, wf::point_t view_delta)
+        {
+            schedule_snapshotted_view(repaint, view, view_delta);
+        },
+            [&] (wf::surface_interface_t *surface, wf::point_t pos)
+        {
+            schedule_surface(repaint, surface, pos);
+        });
+    }
+
     /**
      * Setup the stream, calculate damaged region, etc.
      */
@@ -1286,7 +1907,17 @@ class wf::render_manager::impl
         workspace_stream_t& stream, float scale_x, float scale_y)
     {
         workspace_stream_repaint_t repaint;
+        repaint.to_render = frame_arena.render_lists.acquire();
+
         repaint.ws_damage = output_damage->get_ws_damage(stream.ws);
+        if ((scale_x != stream.scale_x) || (scale_y != stream.scale_y))
+        {
+            /* The whole stream has to be repainted at the new resolution. This
+             * concerns only the stream's buffer, so the output isn't damaged. */
+            stream.scale_x = scale_x;
+            stream.scale_y = scale_y;
+            repaint.ws_damage |= output_damage->get_ws_box(stream.ws);
+        }
 
         /* we don't have to update anything */
         if (repaint.ws_damage.empty())
@@ -1294,17 +1925,11 @@ class wf::render_manager::impl
             return repaint;
         }
 
-        if ((scale_x != stream.scale_x) || (scale_y != stream.scale_y))
-        {
-            /* FIXME: enable scaled rendering */
-            // stream->scale_x = scale_x;
-            // stream->scale_y = scale_y;
-
-            // ws_damage |= get_damage_box();
-        }
-
+        const float scale = get_stream_scale(stream);
         OpenGL::render_begin();
-        stream.buffer.allocate(output->handle->width, output->handle->height);
+        stream.buffer.allocate(
+            std::max(1, (int)std::ceil(output->handle->width * scale)),
+            std::max(1, (int)std::ceil(output->handle->height * scale)));
         OpenGL::render_end();
 
         repaint.fb = postprocessing->get_target_framebuffer();
@@ -1313,6 +1938,9 @@ class wf::render_manager::impl
             /* Use the workspace buffers */
             repaint.fb.fb  = stream.buffer.fb;
             repaint.fb.tex = stream.buffer.tex;
+            repaint.fb.viewport_width  = stream.buffer.viewport_width;
+            repaint.fb.viewport_height = stream.buffer.viewport_height;
+            repaint.fb.scale *= scale;
         }
 
         auto g   = output->get_relative_geometry();
@@ -1326,6 +1954,44 @@ class wf::render_manager::impl
         return repaint;
     }
 
+    /**
+     * @return The scale at which the stream is rendered, relative to the
+     *   output's resolution.
+     */
+    float get_stream_scale(const workspace_stream_t& stream)
+    {
+        if (stream.buffer.tex == 0)
+        {
+            /* The default stream renders directly to the output */
+            return 1.0;
+        }
+
+        return std::clamp(std::max(stream.scale_x, stream.scale_y), 0.01f, 1.0f);
+    }
+
+    /** Regenerate the mipmaps of the stream, if it has them enabled. */
+    void update_stream_mipmaps(workspace_stream_t& stream)
+    {
+        if ((stream.buffer.tex == 0) || (stream.buffer.tex == (GLuint)-1))
+        {
+            return;
+        }
+
+        OpenGL::render_begin();
+        GL_CALL(glBindTexture(GL_TEXTURE_2D, stream.buffer.tex));
+        /* Set the filter also when mipmaps are disabled, as they might have been
+         * enabled previously, and their contents are stale now. */
+        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+            stream.mipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR));
+        if (stream.mipmaps)
+        {
+            GL_CALL(glGenerateMipmap(GL_TEXTURE_2D));
+        }
+
+        GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+        OpenGL::render_end();
+    }
+
     void clear_empty_areas(workspace_stream_repaint_t& repaint, wf::color_t color)
     {
         OpenGL::render_begin(repaint.fb);
@@ -1352,31 +2018,70 @@ class wf::render_manager::impl
     {
         wf::geometry_t fb_geometry = repaint.fb.geometry;
 
-        for (auto& ds : wf::reverse(repaint.to_render))
+        /* Consecutive surfaces which only draw their texture share a batch,
+         * which has to be drawn before anything else renders. */
+        bool batch_open = false;
+        auto close_batch = [&] ()
+        {
+            if (batch_open)
+            {
+                OpenGL::batch_end();
+                OpenGL::render_end();
+                batch_open = false;
+            }
+        };
+
+        for (auto& ds : wf::reverse(*repaint.to_render))
         {
             if (ds->view)
             {
+                close_batch();
                 repaint.fb.geometry = fb_geometry + ds->pos;
                 ds->view->render_transformed(repaint.fb, ds->damage);
-                for (auto& child : ds->view->enumerate_surfaces({0, 0}))
+                for (auto child : ds->view->get_surface_tree())
                 {
                     send_sampled_on_output(child.surface);
                 }
             } else
             {
                 repaint.fb.geometry = fb_geometry;
-                ds->surface->simple_render(repaint.fb,
-                    ds->pos.x, ds->pos.y, ds->damage);
+                if (auto source = ds->surface->priv->batch_source)
+                {
+                    if (!batch_open)
+                    {
+                        OpenGL::render_begin(repaint.fb);
+                        OpenGL::batch_begin(repaint.fb);
+                        batch_open = true;
+                    }
+
+                    source->_batch_render(ds->pos.x, ds->pos.y, ds->damage);
+                } else
+                {
+                    close_batch();
+                    ds->surface->simple_render(repaint.fb,
+                        ds->pos.x, ds->pos.y, ds->damage);
+                }
+
                 send_sampled_on_output(ds->surface);
             }
         }
 
+        close_batch();
+
         /* Restore proper geometry */
         repaint.fb.geometry = fb_geometry;
     }
 
     void workspace_stream_update(workspace_stream_t& stream,
         float scale_x = 1, float scale_y = 1)
+    {
+        frame_timing->begin_phase(FRAME_PHASE_WORKSPACE_STREAM);
+        repaint_workspace_stream(stream, scale_x, scale_y);
+        frame_timing->end_phase(FRAME_PHASE_WORKSPACE_STREAM);
+    }
+
+    void repaint_workspace_stream(workspace_stream_t& stream,
+        float scale_x, float scale_y)
     {
         workspace_stream_repaint_t repaint =
             calculate_repaint_for_stream(stream, scale_x, scale_y);
@@ -1388,7 +2093,7 @@ class wf::render_manager::impl
 
         {
             stream_signal_t data(stream.ws, repaint.ws_damage, repaint.fb);
-            output->render->emit_signal("workspace-stream-pre", &data);
+            output->render->emit_signal(wf::WORKSPACE_STREAM_PRE_SIGNAL, &data);
         }
 
         check_schedule_surfaces(repaint, stream);
@@ -1406,8 +2111,10 @@ class wf::render_manager::impl
         unschedule_drag_icon();
         {
             stream_signal_t data(stream.ws, repaint.ws_damage, repaint.fb);
-            output->render->emit_signal("workspace-stream-post", &data);
+            output->render->emit_signal(wf::WORKSPACE_STREAM_POST_SIGNAL, &data);
         }
+
+        update_stream_mipmaps(stream);
     }
 
     void workspace_stream_stop(workspace_stream_t& stream)
@@ -1455,6 +2162,16 @@ void render_manager::rem_effect(effect_hook_t *hook)
     pimpl->effects->rem_effect(hook);
 }
 
+void render_manager::add_quality_control(quality_control_t *control)
+{
+    pimpl->render_budget->add_control(control);
+}
+
+void render_manager::rem_quality_control(quality_control_t *control)
+{
+    pimpl->render_budget->rem_control(control);
+}
+
 void render_manager::add_post(post_hook_t *hook)
 {
     pimpl->postprocessing->add_post(hook);
@@ -1495,6 +2212,22 @@ wlr_box render_manager::get_ws_box(wf::point_t ws) const
     return pimpl->output_damage->get_ws_box(ws);
 }
 
+size_t render_manager::get_frame_arena_growth_count() const
+{
+    return pimpl->last_frame_arena_growth;
+}
+
+std::vector<frame_timing_t> render_manager::get_frame_timings(
+    size_t max_count) const
+{
+    return pimpl->frame_timing->get_timings(max_count);
+}
+
+bool render_manager::has_gpu_frame_timings() const
+{
+    return pimpl->frame_timing->has_gpu_timer();
+}
+
 wf::framebuffer_t render_manager::get_target_framebuffer() const
 {
     return pimpl->postprocessing->get_target_framebuffer();
@@ -1508,7 +2241,7 @@ void render_manager::workspace_stream_start(workspace_stream_t& stream)
 void render_manager::workspace_stream_update(workspace_stream_t& stream,
     float scale_x, float scale_y)
 {
-    pimpl->workspace_stream_update(stream);
+    pimpl->workspace_stream_update(stream, scale_x, scale_y);
 }
 
 void render_manager::workspace_stream_stop(workspace_stream_t& stream)
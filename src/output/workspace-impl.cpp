@@ -5,8 +5,8 @@
 #include <wayfire/render-manager.hpp>
 #include <wayfire/signal-definitions.hpp>
 #include <wayfire/opengl.hpp>
-#include <list>
 #include <algorithm>
+#include <unordered_map>
 #include <wayfire/nonstd/reverse.hpp>
 #include <wayfire/util/log.hpp>
 
@@ -15,62 +15,76 @@
 
 namespace wf
 {
-/** Find a smart pointer inside a list */
-template<class Haystack, class Needle>
-typename std::list<Haystack>::iterator find_in(std::list<Haystack>& hay,
-    const Needle& needle)
+/**
+ * An intrusive doubly-linked list, ordered from front (top) to back (bottom).
+ *
+ * The list doesn't own its elements. The links are stored in the elements
+ * themselves and are accessed through Links::prev() and Links::next(), so
+ * that inserting, removing and moving an element are O(1).
+ */
+template<class T, class Links>
+class intrusive_list_t
 {
-    return std::find_if(std::begin(hay), std::end(hay), [=] (const auto& elem)
+    T *first = nullptr;
+    T *last  = nullptr;
+
+  public:
+    T *front() const
     {
-        return elem.get() == needle.get();
-    });
-}
+        return first;
+    }
 
-/** Bring to front or lower to back inside a container of smart pointers */
-template<class Haystack, class Needle>
-void raise_to_front(std::list<Haystack>& hay, const Needle& needle,
-    bool reverse = false)
-{
-    auto it = find_in(hay, needle);
-    hay.splice(reverse ? hay.end() : hay.begin(), hay, it);
-}
+    T *back() const
+    {
+        return last;
+    }
 
-/** Reorder list so that @element is directly above @below. */
-template<class Haystack, class Needle>
-void reorder_above(
-    std::list<Haystack>& list, const Needle& element, const Needle& below)
-{
-    auto element_it = find_in(list, element);
-    auto pos = find_in(list, below);
-    list.splice(pos, list, element_it);
-}
+    /** Insert @element directly before @pos, or at the back if @pos is null */
+    void insert_before(T *pos, T *element)
+    {
+        T *prev = pos ? Links::prev(pos) : last;
+        Links::prev(element) = prev;
+        Links::next(element) = pos;
+        (prev ? Links::next(prev) : first) = element;
+        (pos ? Links::prev(pos) : last)    = element;
+    }
 
-/** Reorder list so that @element is directly below @above. */
-template<class Haystack, class Needle>
-void reorder_below(
-    std::list<Haystack>& list, const Needle& element, const Needle& above)
-{
-    auto element_it = find_in(list, element);
-    auto pos = find_in(list, above);
-    assert(pos != list.end());
-    list.splice(std::next(pos), list, element_it);
-}
+    /** Insert @element directly after @pos, or at the front if @pos is null */
+    void insert_after(T *pos, T *element)
+    {
+        insert_before(pos ? Links::next(pos) : first, element);
+    }
 
-/**
- * Remove needle from haystack, where both needle and elements in haystack are
- * smart pointers.
- */
-template<class Haystack, class Needle>
-void remove_from(Haystack& haystack, Needle& n)
-{
-    auto it = std::remove_if(std::begin(haystack), std::end(haystack),
-        [=] (const auto& contained)
+    void push_front(T *element)
     {
-        return contained.get() == n.get();
-    });
+        insert_before(first, element);
+    }
 
-    haystack.erase(it, std::end(haystack));
-}
+    void push_back(T *element)
+    {
+        insert_before(nullptr, element);
+    }
+
+    /** Precondition: @element is in the list */
+    void remove(T *element)
+    {
+        T *prev = Links::prev(element);
+        T *next = Links::next(element);
+        (prev ? Links::next(prev) : first) = next;
+        (next ? Links::prev(next) : last)  = prev;
+        Links::prev(element) = Links::next(element) = nullptr;
+    }
+
+    /** Call @callback for each element, from front to back */
+    template<class Callback>
+    void for_each(Callback callback) const
+    {
+        for (T *element = first; element; element = Links::next(element))
+        {
+            callback(element);
+        }
+    }
+};
 
 /** Damage the entire view tree including the view itself. */
 void damage_views(wayfire_view view)
@@ -81,6 +95,20 @@ void damage_views(wayfire_view view)
     }
 }
 
+/** Links of the views in their sublayer */
+struct sublayer_view_links_t
+{
+    static view_interface_t*& prev(view_interface_t *view)
+    {
+        return view->view_impl->sublayer_prev;
+    }
+
+    static view_interface_t*& next(view_interface_t *view)
+    {
+        return view->view_impl->sublayer_next;
+    }
+};
+
 struct layer_container_t;
 /**
  * Implementation of the sublayer struct.
@@ -88,7 +116,7 @@ struct layer_container_t;
 struct sublayer_t
 {
     /** A list of the views in the sublayer */
-    std::list<wayfire_view> views;
+    intrusive_list_t<view_interface_t, sublayer_view_links_t> views;
 
     /** The actual layer this sublayer belongs to */
     nonstd::observer_ptr<layer_container_t> layer;
@@ -102,6 +130,26 @@ struct sublayer_t
      * elsewhere.
      */
     bool is_single_view;
+
+    /** Links in the list of sublayers with the same mode */
+    sublayer_t *prev = nullptr;
+    sublayer_t *next = nullptr;
+    /** Index in layer_container_t::sublayers */
+    size_t index;
+};
+
+/** Links of the sublayers in their layer */
+struct sublayer_links_t
+{
+    static sublayer_t*& prev(sublayer_t *sublayer)
+    {
+        return sublayer->prev;
+    }
+
+    static sublayer_t*& next(sublayer_t *sublayer)
+    {
+        return sublayer->next;
+    }
 };
 
 /**
@@ -112,7 +160,7 @@ struct layer_container_t
     /** The layer of the container */
     layer_t layer;
 
-    using sublayer_container_t = std::list<std::unique_ptr<sublayer_t>>;
+    using sublayer_container_t = intrusive_list_t<sublayer_t, sublayer_links_t>;
     /** List of sublayers docked below */
     sublayer_container_t below;
     /** List of floating sublayers */
@@ -120,28 +168,63 @@ struct layer_container_t
     /** List of sublayers docked above */
     sublayer_container_t above;
 
-    void remove_sublayer(nonstd::observer_ptr<sublayer_t> sublayer)
+    /** Storage for all sublayers of the layer, in no particular order */
+    std::vector<std::unique_ptr<sublayer_t>> sublayers;
+
+    sublayer_container_t& get_container(sublayer_mode_t mode)
     {
-        for (auto container : {& below, & floating, & above})
+        switch (mode)
         {
-            remove_from(*container, sublayer);
+          case SUBLAYER_DOCKED_BELOW:
+            return below;
+
+          case SUBLAYER_DOCKED_ABOVE:
+            return above;
+
+          default:
+            return floating;
         }
     }
+
+    void add_sublayer(std::unique_ptr<sublayer_t> sublayer)
+    {
+        sublayer->index = sublayers.size();
+        sublayers.push_back(std::move(sublayer));
+    }
+
+    void remove_sublayer(nonstd::observer_ptr<sublayer_t> sublayer)
+    {
+        get_container(sublayer->mode).remove(sublayer.get());
+
+        /* Move the last sublayer in the freed slot */
+        size_t index = sublayer->index;
+        std::swap(sublayers[index], sublayers.back());
+        sublayers[index]->index = index;
+        sublayers.pop_back();
+    }
 };
 
 /**
  * output_layer_manager_t is a part of the workspace_manager module. It provides
  * the functionality related to layers and sublayers.
+ *
+ * Views and sublayers are kept in intrusive lists, so that restacking a view
+ * doesn't need to search for it. The flat stacking order of the visible
+ * layers is rebuilt only when it is requested after a change.
  */
 class output_layer_manager_t
 {
     // A hierarchical representation of the view stack order
     layer_container_t layers[TOTAL_LAYERS];
 
-    // A flat representation of the view stack order
+    // A flat representation of the view stack order, valid if !view_list_dirty
     std::vector<wayfire_view> view_list;
+    bool view_list_dirty = true;
 
   public:
+    /** Incremented each time the stacking order changes */
+    uint64_t stack_version = 0;
+
     output_layer_manager_t()
     {
         for (int i = 0; i < TOTAL_LAYERS; i++)
@@ -185,7 +268,7 @@ class output_layer_manager_t
 
         damage_views(view);
 
-        remove_from(sublayer->views, view);
+        sublayer->views.remove(view.get());
         if (sublayer->is_single_view)
         {
             sublayer->layer->remove_sublayer(sublayer);
@@ -193,7 +276,7 @@ class output_layer_manager_t
 
         /* Reset the view's sublayer */
         sublayer = nullptr;
-        rebuild_stack_order();
+        stack_order_changed();
     }
 
     void add_view_to_sublayer(wayfire_view view,
@@ -201,8 +284,8 @@ class output_layer_manager_t
     {
         remove_view(view);
         get_view_sublayer(view) = sublayer;
-        sublayer->views.push_front(view);
-        rebuild_stack_order();
+        sublayer->views.push_front(view.get());
+        stack_order_changed();
     }
 
     nonstd::observer_ptr<sublayer_t> create_sublayer(layer_t layer_mask,
@@ -216,21 +299,16 @@ class output_layer_manager_t
         sublayer->mode  = mode;
         sublayer->is_single_view = false;
 
-        switch (mode)
+        if (mode == SUBLAYER_DOCKED_BELOW)
         {
-          case SUBLAYER_DOCKED_BELOW:
-            layer.below.emplace_back(std::move(sublayer));
-            break;
-
-          case SUBLAYER_DOCKED_ABOVE:
-            layer.above.emplace_front(std::move(sublayer));
-            break;
-
-          case SUBLAYER_FLOATING:
-            layer.floating.emplace_front(std::move(sublayer));
-            break;
+            layer.below.push_back(sublayer.get());
+        } else
+        {
+            layer.get_container(mode).push_front(sublayer.get());
         }
 
+        layer.add_sublayer(std::move(sublayer));
+
         return ptr;
     }
 
@@ -238,29 +316,46 @@ class output_layer_manager_t
     void add_view_to_layer(wayfire_view view, layer_t layer)
     {
         damage_views(view);
-        add_view_to_sublayer(view, create_sublayer(layer, SUBLAYER_FLOATING));
-        rebuild_stack_order();
+        auto sublayer = create_sublayer(layer, SUBLAYER_FLOATING);
+        sublayer->is_single_view = true;
+        add_view_to_sublayer(view, sublayer);
         damage_views(view);
     }
 
-    /** Precondition: view is in some sublayer */
-    void bring_to_front(wayfire_view view)
+    /**
+     * Precondition: view is in some sublayer
+     *
+     * @return Whether the stacking order changed.
+     */
+    bool bring_to_front(wayfire_view view)
     {
         auto sublayer = get_view_sublayer(view);
         assert(sublayer);
 
-        for (auto view : sublayer->views)
+        auto& floating = sublayer->layer->floating;
+        bool raise_sublayer = (sublayer->mode == SUBLAYER_FLOATING) &&
+            (floating.front() != sublayer.get());
+        if (!raise_sublayer && (sublayer->views.front() == view.get()))
         {
-            damage_views(view);
+            return false;
         }
 
-        if (sublayer->mode == SUBLAYER_FLOATING)
+        sublayer->views.for_each([] (view_interface_t *view)
+        {
+            damage_views(view->self());
+        });
+
+        if (raise_sublayer)
         {
-            raise_to_front(sublayer->layer->floating, sublayer);
+            floating.remove(sublayer.get());
+            floating.push_front(sublayer.get());
         }
 
-        raise_to_front(sublayer->views, view);
-        rebuild_stack_order();
+        sublayer->views.remove(view.get());
+        sublayer->views.push_front(view.get());
+        stack_order_changed();
+
+        return true;
     }
 
     wayfire_view get_front_view(wf::layer_t layer)
@@ -285,8 +380,9 @@ class output_layer_manager_t
 
         if (view_sublayer == below_sublayer)
         {
-            reorder_above(view_sublayer->views, view, below);
-            rebuild_stack_order();
+            view_sublayer->views.remove(view.get());
+            view_sublayer->views.insert_before(below.get(), view.get());
+            stack_order_changed();
 
             return;
         }
@@ -297,9 +393,14 @@ class output_layer_manager_t
             return;
         }
 
-        reorder_above(view_sublayer->layer->floating, view_sublayer, below_sublayer);
-        raise_to_front(view_sublayer->views, view, true); // bring to back == reverse
-        rebuild_stack_order();
+        auto& floating = view_sublayer->layer->floating;
+        floating.remove(view_sublayer.get());
+        floating.insert_before(below_sublayer.get(), view_sublayer.get());
+
+        // bring to back
+        view_sublayer->views.remove(view.get());
+        view_sublayer->views.push_back(view.get());
+        stack_order_changed();
     }
 
     /** Precondition: view and above are in the same layer */
@@ -313,8 +414,9 @@ class output_layer_manager_t
 
         if (view_sublayer == above_sublayer)
         {
-            reorder_below(view_sublayer->views, view, above);
-            rebuild_stack_order();
+            view_sublayer->views.remove(view.get());
+            view_sublayer->views.insert_after(above.get(), view.get());
+            stack_order_changed();
 
             return;
         }
@@ -325,9 +427,13 @@ class output_layer_manager_t
             return;
         }
 
-        reorder_below(view_sublayer->layer->floating, view_sublayer, above_sublayer);
-        raise_to_front(view_sublayer->views, view);
-        rebuild_stack_order();
+        auto& floating = view_sublayer->layer->floating;
+        floating.remove(view_sublayer.get());
+        floating.insert_after(above_sublayer.get(), view_sublayer.get());
+
+        view_sublayer->views.remove(view.get());
+        view_sublayer->views.push_front(view.get());
+        stack_order_changed();
     }
 
     void push_views(std::vector<wayfire_view>& into, layer_t layer_e,
@@ -337,37 +443,59 @@ class output_layer_manager_t
         for (const auto& sublayers :
              {& layer.above, & layer.floating, & layer.below})
         {
-            for (const auto& sublayer : *sublayers)
+            sublayers->for_each([&] (sublayer_t *sublayer)
             {
-                auto& container = sublayer->views;
-                std::copy_if(container.begin(), container.end(),
-                    std::back_inserter(into), [=] (wayfire_view view)
+                sublayer->views.for_each([&] (view_interface_t *view)
                 {
-                    return view->view_impl->is_promoted == promoted;
+                    if (view->view_impl->is_promoted == promoted)
+                    {
+                        into.push_back(view->self());
+                    }
                 });
-            }
+            });
         }
     }
 
-    void rebuild_stack_order()
+    /**
+     * Mark the flat stacking order as outdated. Must be called after each
+     * change of the stacking order, including promotion of views.
+     */
+    void stack_order_changed()
+    {
+        view_list_dirty = true;
+        ++stack_version;
+    }
+
+    /** @return The views in the visible layers, in stacking order */
+    const std::vector<wayfire_view>& get_stack_order()
     {
-        this->view_list = _get_views_in_layer(VISIBLE_LAYERS);
+        if (view_list_dirty)
+        {
+            view_list.clear();
+            push_layer_views(view_list, VISIBLE_LAYERS);
+            view_list_dirty = false;
+        }
+
+        return view_list;
     }
 
     std::vector<wayfire_view> get_views_in_layer(uint32_t layers_mask)
     {
         if (layers_mask == VISIBLE_LAYERS)
         {
-            return view_list;
+            return get_stack_order();
         } else
         {
-            return _get_views_in_layer(layers_mask);
+            std::vector<wayfire_view> views;
+            push_layer_views(views, layers_mask);
+
+            return views;
         }
     }
 
-    std::vector<wayfire_view> _get_views_in_layer(uint32_t layers_mask)
+    void push_layer_views(std::vector<wayfire_view>& views,
+        uint32_t layers_mask)
     {
-        std::vector<wayfire_view> views;
         auto try_push = [&] (layer_t layer, bool promoted = false)
         {
             if (!(layer & layers_mask))
@@ -395,7 +523,6 @@ class output_layer_manager_t
         }
 
         try_push(LAYER_MINIMIZED);
-        return views;
     }
 
     std::vector<wayfire_view> get_promoted_views()
@@ -413,8 +540,10 @@ class output_layer_manager_t
         nonstd::observer_ptr<sublayer_t> sublayer)
     {
         std::vector<wayfire_view> result;
-        std::copy(sublayer->views.begin(), sublayer->views.end(),
-            std::back_inserter(result));
+        sublayer->views.for_each([&] (view_interface_t *view)
+        {
+            result.push_back(view->self());
+        });
 
         return result;
     }
@@ -534,10 +663,13 @@ class output_viewport_manager_t
     /**
      * @param threshold Threshold of the view to be counted
      *        on that workspace. 1.0 for 100% visible, 0.1 for 10%
+     * @param visible_on If not null, the workspaces the view is visible on,
+     *        indexed row-major, as tracked by output_workspace_index_t.
      *
      * @return a vector of all the workspaces
      */
-    std::vector<wf::point_t> get_view_workspaces(wayfire_view view, double threshold)
+    std::vector<wf::point_t> get_view_workspaces(wayfire_view view, double threshold,
+        const std::vector<bool> *visible_on = nullptr)
     {
         assert(view->get_output() == this->output);
         std::vector<wf::point_t> view_workspaces;
@@ -549,7 +681,10 @@ class output_viewport_manager_t
             for (int vertical = 0; vertical < grid.height; vertical++)
             {
                 wf::point_t ws = {horizontal, vertical};
-                if (output->workspace->view_visible_on(view, ws))
+                bool visible = visible_on ?
+                    (*visible_on)[vertical * grid.width + horizontal] :
+                    output->workspace->view_visible_on(view, ws);
+                if (visible)
                 {
                     workspace_relative_geometry = output->render->get_ws_box(ws);
                     auto intersection = wf::geometry_intersection(
@@ -784,6 +919,315 @@ class output_viewport_manager_t
     }
 };
 
+/**
+ * output_workspace_index_t keeps track of the workspaces each view in the
+ * visible layers is visible on, and of the views visible on each workspace,
+ * so that querying the views on a workspace doesn't need to check all views.
+ *
+ * The index is updated lazily on the next query:
+ * - Views whose geometry or stickiness changed are found via their damage,
+ *   and only their workspaces are recomputed. Views with transformers are
+ *   recomputed on each damage, as the transformer may change their visibility.
+ * - A change of the stacking order, the current workspace, the grid size or
+ *   the output size rebuilds the lists of all workspaces.
+ */
+class output_workspace_index_t
+{
+    output_t *output;
+    output_layer_manager_t *layer_manager;
+    output_viewport_manager_t *viewport_manager;
+
+    struct view_entry_t
+    {
+        wayfire_view view;
+        /* The state for which visible_on was computed */
+        wf::geometry_t geometry;
+        bool sticky;
+        bool transformed;
+
+        /* Whether visible_on needs to be recomputed */
+        bool dirty = true;
+        /* For each workspace, see get_workspace_index() */
+        std::vector<bool> visible_on;
+
+        wf::signal_connection_t on_damage;
+    };
+
+    std::unordered_map<wf::view_interface_t*,
+        std::unique_ptr<view_entry_t>> entries;
+    bool has_dirty_entries = false;
+
+    /* The state for which the index was built */
+    uint64_t stack_version = -1;
+    wf::point_t current_workspace = {0, 0};
+    wf::dimensions_t grid = {0, 0};
+    wf::dimensions_t screen_size = {0, 0};
+
+    struct workspace_views_t
+    {
+        /* All views in the visible layers, in stacking order */
+        std::vector<wayfire_view> views;
+        /* The views for each layer mask which was queried so far */
+        std::vector<std::pair<uint32_t, std::vector<wayfire_view>>> by_mask;
+    };
+
+    std::vector<workspace_views_t> workspaces;
+    bool workspaces_dirty = true;
+
+    /* The result of queries which can't use the index */
+    std::vector<wayfire_view> uncached_result;
+
+    /* Drop the entry right away, as the view might be destroyed soon */
+    wf::signal_connection_t on_view_detached = [=] (wf::signal_data_t *data)
+    {
+        entries.erase(get_signaled_view(data).get());
+    };
+
+    int get_workspace_index(wf::point_t ws)
+    {
+        return ws.y * grid.width + ws.x;
+    }
+
+    static bool is_transformed(wayfire_view view)
+    {
+        return view->has_transformer();
+    }
+
+    static wf::geometry_t get_indexed_geometry(wayfire_view view)
+    {
+        return is_transformed(view) ? view->get_bounding_box() :
+               view->get_wm_geometry();
+    }
+
+    void mark_dirty(view_entry_t& entry)
+    {
+        entry.dirty = true;
+        has_dirty_entries = true;
+    }
+
+    void handle_view_damage(view_entry_t& entry)
+    {
+        if (entry.dirty)
+        {
+            return;
+        }
+
+        auto view = entry.view;
+        if (entry.transformed || is_transformed(view) ||
+            (entry.sticky != view->sticky) ||
+            (entry.geometry != view->get_wm_geometry()))
+        {
+            mark_dirty(entry);
+        }
+    }
+
+    /** Add and remove entries so that they match the stacking order */
+    void update_entries(const std::vector<wayfire_view>& stack)
+    {
+        std::unordered_map<wf::view_interface_t*,
+            std::unique_ptr<view_entry_t>> new_entries;
+        for (auto& view : stack)
+        {
+            auto it = entries.find(view.get());
+            if (it != entries.end())
+            {
+                new_entries[view.get()] = std::move(it->second);
+                continue;
+            }
+
+            auto entry = std::make_unique<view_entry_t>();
+            auto ptr   = entry.get();
+            entry->view = view;
+            entry->on_damage.set_callback([=] (wf::signal_data_t*)
+            {
+                handle_view_damage(*ptr);
+            });
+            view->connect_signal(wf::REGION_DAMAGED_SIGNAL, &entry->on_damage);
+            mark_dirty(*entry);
+            new_entries[view.get()] = std::move(entry);
+        }
+
+        entries = std::move(new_entries);
+    }
+
+    void update_entry(view_entry_t& entry)
+    {
+        auto view = entry.view;
+        entry.geometry    = get_indexed_geometry(view);
+        entry.sticky      = view->sticky;
+        entry.transformed = is_transformed(view);
+        entry.dirty = false;
+
+        std::vector<bool> visible_on(grid.width * grid.height);
+        for (int x = 0; x < grid.width; x++)
+        {
+            for (int y = 0; y < grid.height; y++)
+            {
+                visible_on[get_workspace_index({x, y})] =
+                    viewport_manager->view_visible_on(view, {x, y});
+            }
+        }
+
+        if (visible_on != entry.visible_on)
+        {
+            entry.visible_on = std::move(visible_on);
+            workspaces_dirty = true;
+        }
+    }
+
+    void filter_by_mask(const std::vector<wayfire_view>& views, uint32_t mask,
+        std::vector<wayfire_view>& result)
+    {
+        result.clear();
+        for (auto& view : views)
+        {
+            if (layer_manager->get_view_layer(view) & mask)
+            {
+                result.push_back(view);
+            }
+        }
+    }
+
+    void update_index()
+    {
+        bool geometry_changed =
+            (current_workspace != viewport_manager->get_current_workspace()) ||
+            (grid != viewport_manager->get_workspace_grid_size()) ||
+            (screen_size != output->get_screen_size());
+
+        if (geometry_changed)
+        {
+            current_workspace = viewport_manager->get_current_workspace();
+            grid = viewport_manager->get_workspace_grid_size();
+            screen_size = output->get_screen_size();
+            workspaces.resize(grid.width * grid.height);
+            workspaces_dirty = true;
+
+            for (auto& entry : entries)
+            {
+                mark_dirty(*entry.second);
+            }
+        }
+
+        if (stack_version != layer_manager->stack_version)
+        {
+            stack_version = layer_manager->stack_version;
+            update_entries(layer_manager->get_stack_order());
+            workspaces_dirty = true;
+        }
+
+        if (has_dirty_entries)
+        {
+            for (auto& entry : entries)
+            {
+                if (entry.second->dirty)
+                {
+                    update_entry(*entry.second);
+                }
+            }
+
+            has_dirty_entries = false;
+        }
+
+        if (!workspaces_dirty)
+        {
+            return;
+        }
+
+        for (auto& ws : workspaces)
+        {
+            ws.views.clear();
+        }
+
+        for (auto& view : layer_manager->get_stack_order())
+        {
+            auto& visible_on = entries[view.get()]->visible_on;
+            for (size_t i = 0; i < workspaces.size(); i++)
+            {
+                if (visible_on[i])
+                {
+                    workspaces[i].views.push_back(view);
+                }
+            }
+        }
+
+        for (auto& ws : workspaces)
+        {
+            for (auto& [mask, views] : ws.by_mask)
+            {
+                filter_by_mask(ws.views, mask, views);
+            }
+        }
+
+        workspaces_dirty = false;
+    }
+
+  public:
+    output_workspace_index_t(output_t *output,
+        output_layer_manager_t *layer_manager,
+        output_viewport_manager_t *viewport_manager)
+    {
+        this->output = output;
+        this->layer_manager    = layer_manager;
+        this->viewport_manager = viewport_manager;
+        output->connect_signal("view-layer-detached", &on_view_detached);
+    }
+
+    /**
+     * Same result as output_viewport_manager_t::get_views_on_workspace().
+     * The returned list is valid until the next call.
+     */
+    const std::vector<wayfire_view>& get_views_on_workspace(wf::point_t ws,
+        uint32_t layers_mask)
+    {
+        if ((layers_mask & ~VISIBLE_LAYERS) ||
+            !viewport_manager->is_workspace_valid(ws))
+        {
+            uncached_result =
+                viewport_manager->get_views_on_workspace(ws, layers_mask);
+
+            return uncached_result;
+        }
+
+        update_index();
+        auto& workspace = workspaces[get_workspace_index(ws)];
+        if ((layers_mask & VISIBLE_LAYERS) == VISIBLE_LAYERS)
+        {
+            return workspace.views;
+        }
+
+        for (auto& [mask, views] : workspace.by_mask)
+        {
+            if (mask == layers_mask)
+            {
+                return views;
+            }
+        }
+
+        workspace.by_mask.push_back({layers_mask, {}});
+        auto& views = workspace.by_mask.back().second;
+        filter_by_mask(workspace.views, layers_mask, views);
+
+        return views;
+    }
+
+    /**
+     * @return A pointer to the workspaces the view is visible on, indexed by
+     *   workspace index (row-major), or null if the view isn't indexed.
+     */
+    const std::vector<bool> *get_view_visibility(wayfire_view view)
+    {
+        update_index();
+        auto it = entries.find(view.get());
+        if (it == entries.end())
+        {
+            return nullptr;
+        }
+
+        return &it->second->visible_on;
+    }
+};
+
 /**
  * output_workarea_manager_t provides workarea-related functionality from the
  * workspace_manager module
@@ -952,11 +1396,13 @@ class workspace_manager::impl
     output_layer_manager_t layer_manager;
     output_viewport_manager_t viewport_manager;
     output_workarea_manager_t workarea_manager;
+    output_workspace_index_t workspace_index;
 
     impl(output_t *o) :
         layer_manager(),
         viewport_manager(o),
-        workarea_manager(o)
+        workarea_manager(o),
+        workspace_index(o, &layer_manager, &viewport_manager)
     {
         output = o;
         output_geometry = output->get_relative_geometry();
@@ -1058,12 +1504,22 @@ class workspace_manager::impl
         });
         views.erase(it, views.end());
 
+        wayfire_view promoted = nullptr;
         if (!views.empty() && views.front()->fullscreen)
         {
-            views.front()->view_impl->is_promoted = true;
+            promoted = views.front();
+            promoted->view_impl->is_promoted = true;
+        }
+
+        /* Promoted views are stacked differently */
+        bool same_promoted = promoted ?
+            (already_promoted.size() == 1) && (already_promoted[0] == promoted) :
+            already_promoted.empty();
+        if (!same_promoted)
+        {
+            layer_manager.stack_order_changed();
         }
 
-        layer_manager.rebuild_stack_order();
         check_autohide_panels();
 
         /**
@@ -1115,8 +1571,11 @@ class workspace_manager::impl
             return;
         }
 
-        layer_manager.bring_to_front(view);
-        update_promoted_views();
+        /* Focus-follows-mouse raises the same view over and over */
+        if (layer_manager.bring_to_front(view))
+        {
+            update_promoted_views();
+        }
     }
 
     void restack_above(wayfire_view view, wayfire_view below)
@@ -1197,7 +1656,8 @@ workspace_manager::~workspace_manager() = default;
 std::vector<wf::point_t> workspace_manager::get_view_workspaces(wayfire_view view,
     double threshold)
 {
-    return pimpl->viewport_manager.get_view_workspaces(view, threshold);
+    return pimpl->viewport_manager.get_view_workspaces(view, threshold,
+        pimpl->workspace_index.get_view_visibility(view));
 }
 
 wf::point_t workspace_manager::get_view_main_workspace(wayfire_view view)
@@ -1213,7 +1673,13 @@ bool workspace_manager::view_visible_on(wayfire_view view, wf::point_t ws)
 std::vector<wayfire_view> workspace_manager::get_views_on_workspace(wf::point_t ws,
     uint32_t layer_mask)
 {
-    return pimpl->viewport_manager.get_views_on_workspace(ws, layer_mask);
+    return pimpl->workspace_index.get_views_on_workspace(ws, layer_mask);
+}
+
+const std::vector<wayfire_view>& workspace_manager::get_views_on_workspace_cached(
+    wf::point_t ws, uint32_t layer_mask)
+{
+    return pimpl->workspace_index.get_views_on_workspace(ws, layer_mask);
 }
 
 std::vector<wayfire_view> workspace_manager::get_views_on_workspace_sublayer(
@@ -1279,6 +1745,11 @@ std::vector<wayfire_view> workspace_manager::get_views_in_layer(uint32_t layers_
     return pimpl->layer_manager.get_views_in_layer(layers_mask);
 }
 
+uint64_t workspace_manager::get_stack_order_version()
+{
+    return pimpl->layer_manager.stack_version;
+}
+
 std::vector<wayfire_view> workspace_manager::get_views_in_sublayer(
     nonstd::observer_ptr<sublayer_t> sublayer)
 {
@@ -7,13 +7,22 @@
 
 namespace wf
 {
+class wlr_surface_base_t;
+
 class surface_interface_t::impl
 {
   public:
     surface_interface_t *parent_surface;
     std::vector<std::unique_ptr<surface_interface_t>> surface_children_above;
     std::vector<std::unique_ptr<surface_interface_t>> surface_children_below;
-    size_t last_cnt_surfaces = 0;
+    /**
+     * The flattened surface tree, relative to {0, 0}, and whether it needs to
+     * be rebuilt. See get_surface_tree().
+     */
+    std::vector<surface_iterator_t> surface_tree;
+    bool surface_tree_dirty = true;
+    /** The offset used for this surface in the parent's surface tree */
+    wf::point_t offset_in_tree = {0, 0};
 
     /**
      * Remove all subsurfaces and emit signals for them.
@@ -30,6 +39,19 @@ class surface_interface_t::impl
      * subtract_opaque(), send_frame_done(), etc. work for the surface
      */
     wlr_surface *wsurface = nullptr;
+
+    /**
+     * Set while the surface is mapped if its simple_render() only draws the
+     * texture of its wlr_surface. The render manager then draws it with
+     * wlr_surface_base_t::_batch_render(), in a batch with other surfaces.
+     */
+    wlr_surface_base_t *batch_source = nullptr;
+
+    /**
+     * The time (in msec, see get_current_time()) when the last frame event was
+     * sent. Used for throttling frame events of occluded surfaces.
+     */
+    uint32_t last_frame_done = 0;
 };
 
 /**
@@ -70,6 +92,12 @@ class wlr_surface_base_t
     virtual void _simple_render(const wf::framebuffer_t& fb, int x, int y,
         const wf::region_t& damage);
 
+    /**
+     * Add the texture of the surface to the current batch, see
+     * OpenGL::batch_begin(). This is what _simple_render() draws.
+     */
+    void _batch_render(int x, int y, const wf::region_t& damage);
+
   protected:
     virtual void map(wlr_surface *surface);
     virtual void unmap();
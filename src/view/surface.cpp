@@ -32,6 +32,7 @@ void wf::surface_interface_t::add_subsurface(
     ev.subsurface   = {subsurface};
 
     container.insert(container.begin(), std::move(subsurface));
+    invalidate_surface_tree();
     this->emit_signal("subsurface-added", &ev);
 }
 
@@ -57,6 +58,7 @@ std::unique_ptr<wf::surface_interface_t> wf::surface_interface_t::remove_subsurf
     ev.main_surface = this;
     ev.subsurface   = subsurface;
     this->emit_signal("subsurface-removed", &ev);
+    invalidate_surface_tree();
 
     if (auto surf = remove_from(priv->surface_children_above))
     {
@@ -82,38 +84,70 @@ wf::surface_interface_t*wf::surface_interface_t::get_main_surface()
 std::vector<wf::surface_iterator_t> wf::surface_interface_t::enumerate_surfaces(
     wf::point_t surface_origin)
 {
+    auto tree = get_surface_tree(surface_origin);
     std::vector<wf::surface_iterator_t> result;
-    result.reserve(priv->last_cnt_surfaces);
-    auto add_surfaces_recursive = [&] (surface_interface_t *child)
+    result.reserve(tree.size());
+    for (auto surface : tree)
+    {
+        result.push_back(surface);
+    }
+
+    return result;
+}
+
+wf::surface_tree_range_t wf::surface_interface_t::get_surface_tree(
+    wf::point_t surface_origin)
+{
+    if (!priv->surface_tree_dirty)
+    {
+        return {priv->surface_tree, surface_origin};
+    }
+
+    auto& tree = priv->surface_tree;
+    tree.clear();
+    auto add_child_tree = [&] (surface_interface_t *child)
     {
         if (!child->is_mapped())
         {
             return;
         }
 
-        auto child_surfaces = child->enumerate_surfaces(
-            child->get_offset() + surface_origin);
-        result.insert(result.end(),
-            child_surfaces.begin(), child_surfaces.end());
+        child->priv->offset_in_tree = child->get_offset();
+        for (auto child_surface : child->get_surface_tree(
+            child->priv->offset_in_tree))
+        {
+            tree.push_back(child_surface);
+        }
     };
 
     for (auto& child : priv->surface_children_above)
     {
-        add_surfaces_recursive(child.get());
+        add_child_tree(child.get());
     }
 
     if (is_mapped())
     {
-        result.push_back({this, surface_origin});
+        tree.push_back({this, {0, 0}});
     }
 
     for (auto& child : priv->surface_children_below)
     {
-        add_surfaces_recursive(child.get());
+        add_child_tree(child.get());
     }
 
-    priv->last_cnt_surfaces = result.size();
-    return result;
+    priv->surface_tree_dirty = false;
+
+    return {tree, surface_origin};
+}
+
+void wf::surface_interface_t::invalidate_surface_tree()
+{
+    /* Don't stop at the first invalid surface: the parents of an unmapped
+     * subsurface may still be valid. */
+    for (auto surface = this; surface; surface = surface->priv->parent_surface)
+    {
+        surface->priv->surface_tree_dirty = true;
+    }
 }
 
 wf::output_t*wf::surface_interface_t::get_output()
@@ -247,6 +281,12 @@ void wf::surface_interface_t::clear_subsurfaces()
 
     finish_subsurfaces(priv->surface_children_above);
     finish_subsurfaces(priv->surface_children_below);
+    invalidate_surface_tree();
+}
+
+void wf::surface_interface_t::map_state_changed()
+{
+    invalidate_surface_tree();
 }
 
 wf::wlr_surface_base_t::wlr_surface_base_t(surface_interface_t *self)
@@ -314,6 +354,8 @@ void wf::emit_map_state_change(wf::surface_interface_t *surface)
     std::string state =
         surface->is_mapped() ? "surface-mapped" : "surface-unmapped";
 
+    surface->map_state_changed();
+
     surface_map_state_changed_signal data;
     data.surface = surface;
     wf::get_core().emit_signal(state, &data);
@@ -325,6 +367,7 @@ void wf::wlr_surface_base_t::map(wlr_surface *surface)
     this->surface = surface;
 
     _as_si->priv->wsurface = surface;
+    _as_si->priv->batch_source = this;
 
     /* force surface_send_enter(), and also check whether parent surface
      * output hasn't changed while we were unmapped */
@@ -357,6 +400,7 @@ void wf::wlr_surface_base_t::unmap()
     this->surface->data = NULL;
     this->surface = nullptr;
     this->_as_si->priv->wsurface = nullptr;
+    this->_as_si->priv->batch_source = nullptr;
     emit_map_state_change(_as_si);
 
     on_new_subsurface.disconnect();
@@ -399,6 +443,27 @@ void wf::wlr_surface_base_t::apply_surface_damage()
 
 void wf::wlr_surface_base_t::commit()
 {
+    /* A commit applies the pending position of the subsurfaces */
+    auto check_offset = [] (wf::surface_interface_t *surface)
+    {
+        if (surface->priv->parent_surface && surface->is_mapped() &&
+            (surface->get_offset() != surface->priv->offset_in_tree))
+        {
+            surface->invalidate_surface_tree();
+        }
+    };
+
+    check_offset(_as_si);
+    for (auto& child : _as_si->priv->surface_children_above)
+    {
+        check_offset(child.get());
+    }
+
+    for (auto& child : _as_si->priv->surface_children_below)
+    {
+        check_offset(child.get());
+    }
+
     apply_surface_damage();
     if (_as_si->get_output())
     {
@@ -431,21 +496,24 @@ void wf::wlr_surface_base_t::_simple_render(const wf::framebuffer_t& fb,
         return;
     }
 
-    auto size = this->_get_size();
-    wf::geometry_t geometry = {x, y, size.width, size.height};
-    wf::texture_t texture{surface};
-
     OpenGL::render_begin(fb);
-    OpenGL::render_texture(texture, fb, geometry, glm::vec4(1.f),
-        OpenGL::RENDER_FLAG_CACHED);
-    for (const auto& rect : damage)
+    OpenGL::batch_begin(fb);
+    _batch_render(x, y, damage);
+    OpenGL::batch_end();
+    OpenGL::render_end();
+}
+
+void wf::wlr_surface_base_t::_batch_render(int x, int y,
+    const wf::region_t& damage)
+{
+    if (!get_buffer())
     {
-        fb.logic_scissor(wlr_box_from_pixman_box(rect));
-        OpenGL::draw_cached();
+        return;
     }
 
-    OpenGL::clear_cached();
-    OpenGL::render_end();
+    auto size = this->_get_size();
+    wf::geometry_t geometry = {x, y, size.width, size.height};
+    OpenGL::batch_texture(wf::texture_t{surface}, geometry, damage);
 }
 
 wf::wlr_child_surface_base_t::wlr_child_surface_base_t(
@@ -33,6 +33,20 @@ wf::region_t wf::view_transformer_t::transform_opaque_region(
     return {};
 }
 
+wf::region_t wf::view_transformer_t::transform_damage(wf::geometry_t box,
+    const wf::region_t& damage)
+{
+    wf::region_t result;
+    for (const auto& rect : damage)
+    {
+        auto damaged = get_bounding_box(box, wlr_box_from_pixman_box(rect));
+        result |= wf::geometry_t{damaged.x - 1, damaged.y - 1,
+            damaged.width + 2, damaged.height + 2};
+    }
+
+    return result;
+}
+
 void wf::view_transformer_t::render_with_damage(wf::texture_t src_tex,
     wlr_box src_box,
     const wf::region_t& damage, const wf::framebuffer_t& target_fb)
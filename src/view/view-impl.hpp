@@ -21,6 +21,11 @@ struct view_transform_block_t : public noncopyable_t
     std::string plugin_name = "";
     std::unique_ptr<wf::view_transformer_t> transform;
     wf::framebuffer_t fb;
+    /**
+     * Whether fb holds the output of the transformer, up to the damage which
+     * is still pending in view_priv_impl::transform_damage.
+     */
+    bool fb_valid = false;
 
     view_transform_block_t();
     ~view_transform_block_t();
@@ -39,7 +44,12 @@ class view_interface_t::view_priv_impl
     /** Reference count to the view */
     int ref_cnt = 0;
 
-    size_t last_view_cnt = 0;
+    /**
+     * The views returned by enumerate_views(), for mapped_only = false and
+     * true, and whether they need to be rebuilt. See get_view_tree().
+     */
+    std::vector<wayfire_view> view_tree[2];
+    bool view_tree_dirty[2] = {true, true};
 
     bool keyboard_focus_enabled = true;
 
@@ -72,13 +82,26 @@ class view_interface_t::view_priv_impl
         }
     } offscreen_buffer;
 
+    /**
+     * Damage to the view since the transformer buffers were last updated,
+     * in output-local coordinates before transformation. Only tracked when
+     * the view has intermediate transformer buffers.
+     */
+    wf::region_t transform_damage;
+
     wlr_box minimize_hint = {0, 0, 0, 0};
 
     /** The sublayer of the view. For workspace-manager. */
     nonstd::observer_ptr<sublayer_t> sublayer;
+    /** The views above and below in the sublayer. For workspace-manager. */
+    wf::view_interface_t *sublayer_prev = nullptr;
+    wf::view_interface_t *sublayer_next = nullptr;
     /* Promoted to the fullscreen layer? For workspace-manager. */
     bool is_promoted = false;
 
+    /** Whether the view was fully occluded last frame. For render-manager. */
+    bool occluded = false;
+
   private:
     /** Last geometry the view has had in non-tiled and non-fullscreen state.
      * -1 as width/height means that no such geometry has been stored. */
@@ -103,6 +126,12 @@ class view_interface_t::view_priv_impl
  */
 void view_damage_raw(wayfire_view view, const wlr_box& box);
 
+/**
+ * Invalidate the cached view tree (see view_interface_t::get_view_tree()) of
+ * the given view and its parents.
+ */
+void invalidate_view_tree(wayfire_view view);
+
 /**
  * Implementation of a view backed by a wlr_* shell struct.
  */
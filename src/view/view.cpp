@@ -9,6 +9,7 @@
 #include "wayfire/render-manager.hpp"
 #include "xdg-shell.hpp"
 #include "../output/gtk-shell.hpp"
+#include "../output/output-impl.hpp"
 
 #include <algorithm>
 #include <glm/glm.hpp>
@@ -63,6 +64,7 @@ static void unset_toplevel_parent(wayfire_view view)
 {
     if (view->parent)
     {
+        wf::invalidate_view_tree(view);
         auto& container = view->parent->children;
         auto it = std::remove(container.begin(), container.end(), view);
         container.erase(it, container.end());
@@ -110,6 +112,7 @@ void wf::view_interface_t::set_toplevel_parent(wayfire_view new_parent)
         }
 
         parent = new_parent;
+        invalidate_view_tree(self());
         desktop_state_updated();
     }
 
@@ -148,23 +151,48 @@ void wf::view_interface_t::set_toplevel_parent(wayfire_view new_parent)
 std::vector<wayfire_view> wf::view_interface_t::enumerate_views(
     bool mapped_only)
 {
-    if (!this->is_mapped() && mapped_only)
+    return get_view_tree(mapped_only);
+}
+
+const std::vector<wayfire_view>& wf::view_interface_t::get_view_tree(
+    bool mapped_only)
+{
+    auto& tree = view_impl->view_tree[mapped_only];
+    if (!view_impl->view_tree_dirty[mapped_only])
     {
-        return {};
+        return tree;
     }
 
-    std::vector<wayfire_view> result;
-    result.reserve(view_impl->last_view_cnt);
-    for (auto& v : this->children)
+    tree.clear();
+    if (this->is_mapped() || !mapped_only)
     {
-        auto cdr = v->enumerate_views(mapped_only);
-        result.insert(result.end(), cdr.begin(), cdr.end());
+        for (auto& v : this->children)
+        {
+            auto& child_tree = v->get_view_tree(mapped_only);
+            tree.insert(tree.end(), child_tree.begin(), child_tree.end());
+        }
+
+        tree.push_back(self());
     }
 
-    result.push_back(self());
-    view_impl->last_view_cnt = result.size();
+    view_impl->view_tree_dirty[mapped_only] = false;
 
-    return result;
+    return tree;
+}
+
+void wf::invalidate_view_tree(wayfire_view view)
+{
+    for (; view; view = view->parent)
+    {
+        view->view_impl->view_tree_dirty[0] = true;
+        view->view_impl->view_tree_dirty[1] = true;
+    }
+}
+
+void wf::view_interface_t::map_state_changed()
+{
+    surface_interface_t::map_state_changed();
+    invalidate_view_tree(self());
 }
 
 void wf::view_interface_t::set_role(view_role_t new_role)
@@ -362,7 +390,7 @@ wf::surface_interface_t*wf::view_interface_t::map_input_coordinates(
     auto view_relative_coordinates =
         global_to_local_point(cursor, nullptr);
 
-    for (auto& child : enumerate_surfaces({0, 0}))
+    for (auto child : get_surface_tree())
     {
         local.x = view_relative_coordinates.x - child.position.x;
         local.y = view_relative_coordinates.y - child.position.y;
@@ -761,6 +789,11 @@ void wf::view_interface_t::damage()
 {
     auto bbox = get_untransformed_bounding_box();
     view_impl->offscreen_buffer.cached_damage |= bbox;
+    if (view_impl->transforms.size() > 1)
+    {
+        view_impl->transform_damage |= bbox;
+    }
+
     view_damage_raw(self(), transform_region(bbox));
 }
 
@@ -903,6 +936,14 @@ void wf::view_interface_t::pop_transformer(
         return tr->transform.get() == transformer.get();
     });
 
+    /* The transformers after the removed one get a different input */
+    view_impl->transform_damage |= get_untransformed_bounding_box();
+    if (get_output())
+    {
+        auto impl = (wf::output_impl_t*)get_output();
+        impl->get_input_hit_index().handle_view_damage(self());
+    }
+
     /* Since we can remove transformers while rendering the output, damaging it
      * won't help at this stage (damage is already calculated).
      *
@@ -933,7 +974,7 @@ wf::geometry_t wf::view_interface_t::get_untransformed_bounding_box()
     auto bbox = get_output_geometry();
     wf::region_t bounding_region = bbox;
 
-    for (auto& child : enumerate_surfaces({bbox.x, bbox.y}))
+    for (auto child : get_surface_tree({bbox.x, bbox.y}))
     {
         auto dim = child.surface->get_size();
         bounding_region |= {child.position.x, child.position.y,
@@ -1012,7 +1053,7 @@ bool wf::view_interface_t::intersects_region(const wlr_box& region)
     }
 
     auto origin = get_output_geometry();
-    for (auto& child : enumerate_surfaces({origin.x, origin.y}))
+    for (auto child : get_surface_tree({origin.x, origin.y}))
     {
         wlr_box box = {child.position.x, child.position.y,
             child.surface->get_size().width, child.surface->get_size().height};
@@ -1038,7 +1079,7 @@ wf::region_t wf::view_interface_t::get_transformed_opaque_region()
     auto og   = get_output_geometry();
 
     wf::region_t opaque;
-    for (auto& surf : enumerate_surfaces({og.x, og.y}))
+    for (auto surf : get_surface_tree({og.x, og.y}))
     {
         opaque |= surf.surface->get_opaque_region(surf.position);
     }
@@ -1066,7 +1107,7 @@ bool wf::view_interface_t::render_transformed(const wf::framebuffer_t& framebuff
     wf::texture_t previous_texture;
     float texture_scale;
 
-    if (is_mapped() && (enumerate_surfaces().size() == 1) && get_wlr_surface())
+    if (is_mapped() && (get_surface_tree().size() == 1) && get_wlr_surface())
     {
         /* Optimized case: there is a single mapped surface.
          * We can directly start with its texture */
@@ -1094,12 +1135,15 @@ bool wf::view_interface_t::render_transformed(const wf::framebuffer_t& framebuff
      * For each transformer except the last we render on offscreen buffers,
      * and the last one is rendered to the real fb. */
     auto& transforms = view_impl->transforms;
+    wf::region_t damage_in = view_impl->transform_damage & obox;
     transforms.for_each([&] (auto& transform) -> void
     {
         /* Last transform is handled separately */
         if (transform == transforms.back())
         {
             final_transform = transform;
+            /* Its buffer is not updated, in case it stops being the last */
+            final_transform->fb_valid = false;
 
             return;
         }
@@ -1110,24 +1154,49 @@ bool wf::view_interface_t::render_transformed(const wf::framebuffer_t& framebuff
         int scaled_width  = transformed_box.width * texture_scale;
         int scaled_height = transformed_box.height * texture_scale;
 
+        /* Only the parts of the buffer which depend on damaged input need to
+         * be repainted, unless the buffer is new or has changed its size */
+        damage_in = transform->transform->transform_damage(obox, damage_in);
+        if (!transform->fb_valid ||
+            (transform->fb.geometry != transformed_box) ||
+            (transform->fb.scale != texture_scale) ||
+            (transform->fb.viewport_width != scaled_width) ||
+            (transform->fb.viewport_height != scaled_height))
+        {
+            damage_in = transformed_box;
+        }
+
+        damage_in &= transformed_box;
+
         /* Prepare buffer to store result after the transform */
         OpenGL::render_begin();
         transform->fb.allocate(scaled_width, scaled_height);
         transform->fb.scale    = texture_scale;
         transform->fb.geometry = transformed_box;
         transform->fb.bind(); // bind buffer to clear it
-        OpenGL::clear({0, 0, 0, 0});
+        for (auto& box : damage_in)
+        {
+            transform->fb.logic_scissor(wlr_box_from_pixman_box(box));
+            OpenGL::clear({0, 0, 0, 0});
+        }
+
         OpenGL::render_end();
 
         /* Actually render the transform to the next framebuffer */
-        transform->transform->render_with_damage(previous_texture, obox,
-            wf::region_t{transformed_box}, transform->fb);
+        if (!damage_in.empty())
+        {
+            transform->transform->render_with_damage(previous_texture, obox,
+                damage_in, transform->fb);
+        }
 
-        previous_transform = transform;
-        previous_texture   = previous_transform->fb.tex;
+        transform->fb_valid = true;
+        previous_transform  = transform;
+        previous_texture    = previous_transform->fb.tex;
         obox = transformed_box;
     });
 
+    view_impl->transform_damage.clear();
+
     /* This can happen in two ways:
      * 1. The view is unmapped, and no snapshot
      * 2. The last transform was deleted while iterating, so now the last
@@ -1138,20 +1207,9 @@ bool wf::view_interface_t::render_transformed(const wf::framebuffer_t& framebuff
     if (final_transform == nullptr)
     {
         OpenGL::render_begin(framebuffer);
-        auto matrix = framebuffer.get_orthographic_projection();
-        gl_geometry src_geometry = {
-            1.0f * obox.x, 1.0f * obox.y,
-            1.0f * obox.x + 1.0f * obox.width,
-            1.0f * obox.y + 1.0f * obox.height,
-        };
-
-        for (const auto& rect : damage)
-        {
-            framebuffer.logic_scissor(wlr_box_from_pixman_box(rect));
-            OpenGL::render_transformed_texture(previous_texture, src_geometry,
-                {}, matrix);
-        }
-
+        OpenGL::batch_begin(framebuffer);
+        OpenGL::batch_texture(previous_texture, obox, damage);
+        OpenGL::batch_end();
         OpenGL::render_end();
     } else
     {
@@ -1294,6 +1352,11 @@ void wf::view_interface_t::damage_surface_box(const wlr_box& box)
     damaged.x += obox.x;
     damaged.y += obox.y;
     view_impl->offscreen_buffer.cached_damage |= damaged;
+    if (view_impl->transforms.size() > 1)
+    {
+        view_impl->transform_damage |= damaged;
+    }
+
     view_damage_raw(self(), transform_region(damaged));
 }
 
@@ -1329,7 +1392,14 @@ void wf::view_damage_raw(wayfire_view view, const wlr_box& box)
         output->render->damage(box);
     }
 
-    view->emit_signal("region-damaged", nullptr);
+    /* The damage might come from a change of the view's size or position */
+    auto impl = (wf::output_impl_t*)output;
+    impl->get_input_hit_index().handle_view_damage(view);
+
+    wf::view_region_damaged_signal data;
+    data.view = view;
+    data.box  = box;
+    view->emit_signal(wf::REGION_DAMAGED_SIGNAL, &data);
 }
 
 void wf::view_interface_t::destruct()
@@ -993,6 +993,8 @@ class wayfire_dnd_xwayland_view : public wayfire_unmanaged_xwayland_view
         LOGD("Mapping a Xwayland drag icon");
         this->set_output(wf::get_core().get_active_output());
         wayfire_xwayland_view_base::map(surface);
+        /* simple_render() also sends frame events, so it can't be batched */
+        priv->batch_source = nullptr;
         this->damage();
     }
 };
@@ -0,0 +1,42 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Counts the heap allocations of the process. Preloaded into the compositor
+ * by the benchmark runner, see bench-driver.cpp.
+ *
+ * The glibc entry points are used directly, so that no symbol lookup, which
+ * could allocate itself, is needed.
+ */
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+static std::atomic<uint64_t> allocations{0};
+
+uint64_t wf_bench_alloc_count()
+{
+    return allocations.load(std::memory_order_relaxed);
+}
+
+void *malloc(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+}
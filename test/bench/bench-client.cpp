@@ -0,0 +1,457 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <getopt.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <wayland-client.h>
+#include "xdg-shell-client-protocol.h"
+
+/**
+ * A synthetic client for benchmarks. It opens a number of windows which
+ * update their contents with a given damage pattern on each frame, and can
+ * add subsurfaces and popups to them.
+ */
+
+static void usage()
+{
+    printf("Usage: wf-bench-client [options]\n"
+           " -n, --windows N        number of windows (1)\n"
+           " -s, --size WxH         size of the windows (640x480)\n"
+           " -d, --damage PATTERN   none, full, typing or lines (full)\n"
+           " -u, --subsurfaces N    subsurfaces per window (0)\n"
+           " -p, --popups           open a popup on each window\n");
+}
+
+enum damage_pattern_t
+{
+    DAMAGE_NONE,
+    /* The whole window, like a video */
+    DAMAGE_FULL,
+    /* A single cell and the cursor after it, like typing in a terminal */
+    DAMAGE_TYPING,
+    /* A few distant lines, like an editor updating its gutters */
+    DAMAGE_LINES,
+};
+
+struct options_t
+{
+    int windows     = 1;
+    int width       = 640;
+    int height      = 480;
+    int subsurfaces = 0;
+    bool popups     = false;
+    damage_pattern_t damage = DAMAGE_FULL;
+} options;
+
+struct globals_t
+{
+    wl_display *display;
+    wl_compositor *compositor   = nullptr;
+    wl_subcompositor *subcompositor = nullptr;
+    wl_shm *shm = nullptr;
+    xdg_wm_base *wm_base = nullptr;
+} globals;
+
+struct buffer_t
+{
+    wl_buffer *buffer = nullptr;
+    uint32_t *data    = nullptr;
+    int width, height;
+    bool busy = false;
+};
+
+static void handle_buffer_release(void *data, wl_buffer*)
+{
+    static_cast<buffer_t*>(data)->busy = false;
+}
+
+static const wl_buffer_listener buffer_listener = {
+    .release = handle_buffer_release,
+};
+
+static std::unique_ptr<buffer_t> create_buffer(int width, int height)
+{
+    int stride = width * 4;
+    int size   = stride * height;
+    int fd     = memfd_create("wf-bench-client", MFD_CLOEXEC);
+    if ((fd < 0) || (ftruncate(fd, size) < 0))
+    {
+        perror("Failed to create a buffer");
+        exit(1);
+    }
+
+    auto buffer = std::make_unique<buffer_t>();
+    buffer->width  = width;
+    buffer->height = height;
+    buffer->data   = (uint32_t*)mmap(nullptr, size, PROT_READ | PROT_WRITE,
+        MAP_SHARED, fd, 0);
+
+    auto pool = wl_shm_create_pool(globals.shm, fd, size);
+    buffer->buffer = wl_shm_pool_create_buffer(pool, 0, width, height, stride,
+        WL_SHM_FORMAT_XRGB8888);
+    wl_shm_pool_destroy(pool);
+    close(fd);
+
+    wl_buffer_add_listener(buffer->buffer, &buffer_listener, buffer.get());
+    return buffer;
+}
+
+static void fill(buffer_t *buffer, int x, int y, int w, int h, uint32_t color)
+{
+    for (int j = std::max(y, 0); j < std::min(y + h, buffer->height); j++)
+    {
+        for (int i = std::max(x, 0); i < std::min(x + w, buffer->width); i++)
+        {
+            buffer->data[j * buffer->width + i] = color;
+        }
+    }
+}
+
+/** A surface with a static content, used for subsurfaces and popups */
+struct static_surface_t
+{
+    wl_surface *surface;
+    std::unique_ptr<buffer_t> buffer;
+
+    static_surface_t(int width, int height, uint32_t color)
+    {
+        surface = wl_compositor_create_surface(globals.compositor);
+        buffer  = create_buffer(width, height);
+        fill(buffer.get(), 0, 0, width, height, color);
+    }
+
+    void commit()
+    {
+        wl_surface_attach(surface, buffer->buffer, 0, 0);
+        wl_surface_damage_buffer(surface, 0, 0, buffer->width, buffer->height);
+        wl_surface_commit(surface);
+    }
+};
+
+struct window_t
+{
+    wl_surface *surface;
+    xdg_surface *xsurface;
+    xdg_toplevel *toplevel;
+    std::vector<std::unique_ptr<buffer_t>> buffers;
+    uint32_t frame = 0;
+    bool configured = false;
+
+    std::vector<std::unique_ptr<static_surface_t>> subsurfaces;
+    std::unique_ptr<static_surface_t> popup;
+    xdg_surface *popup_xsurface = nullptr;
+    xdg_popup *xpopup = nullptr;
+
+    window_t(int index);
+    void draw();
+    void create_popup();
+};
+
+static void handle_frame_done(void *data, wl_callback *callback, uint32_t)
+{
+    wl_callback_destroy(callback);
+    static_cast<window_t*>(data)->draw();
+}
+
+static const wl_callback_listener frame_listener = {
+    .done = handle_frame_done,
+};
+
+static void handle_xdg_surface_configure(void *data, xdg_surface *xsurface,
+    uint32_t serial)
+{
+    auto window = static_cast<window_t*>(data);
+    xdg_surface_ack_configure(xsurface, serial);
+    if (!window->configured)
+    {
+        window->configured = true;
+        window->draw();
+        for (auto& sub : window->subsurfaces)
+        {
+            sub->commit();
+        }
+
+        if (options.popups)
+        {
+            window->create_popup();
+        }
+    }
+}
+
+static const xdg_surface_listener xdg_surface_listener = {
+    .configure = handle_xdg_surface_configure,
+};
+
+static void handle_popup_configure(void *data, xdg_surface *xsurface,
+    uint32_t serial)
+{
+    xdg_surface_ack_configure(xsurface, serial);
+    static_cast<static_surface_t*>(data)->commit();
+}
+
+static const xdg_surface_listener popup_surface_listener = {
+    .configure = handle_popup_configure,
+};
+
+static void handle_toplevel_configure(void*, xdg_toplevel*, int32_t, int32_t,
+    wl_array*)
+{}
+
+static void handle_toplevel_close(void*, xdg_toplevel*)
+{}
+
+static const xdg_toplevel_listener toplevel_listener = {
+    .configure = handle_toplevel_configure,
+    .close     = handle_toplevel_close,
+};
+
+window_t::window_t(int index)
+{
+    surface  = wl_compositor_create_surface(globals.compositor);
+    xsurface = xdg_wm_base_get_xdg_surface(globals.wm_base, surface);
+    xdg_surface_add_listener(xsurface, &xdg_surface_listener, this);
+    toplevel = xdg_surface_get_toplevel(xsurface);
+    xdg_toplevel_add_listener(toplevel, &toplevel_listener, this);
+    xdg_toplevel_set_title(toplevel,
+        ("wf-bench-client " + std::to_string(index)).c_str());
+
+    for (int i = 0; i < 3; i++)
+    {
+        buffers.push_back(create_buffer(options.width, options.height));
+        fill(buffers.back().get(), 0, 0, options.width, options.height,
+            0xff202020);
+    }
+
+    for (int i = 0; i < options.subsurfaces; i++)
+    {
+        auto sub = std::make_unique<static_surface_t>(64, 64, 0xff4060a0);
+        auto subsurface = wl_subcompositor_get_subsurface(globals.subcompositor,
+            sub->surface, surface);
+        wl_subsurface_set_position(subsurface, 16 + 24 * i, 16 + 24 * i);
+        wl_subsurface_set_desync(subsurface);
+        subsurfaces.push_back(std::move(sub));
+    }
+
+    wl_surface_commit(surface);
+}
+
+void window_t::create_popup()
+{
+    popup = std::make_unique<static_surface_t>(200, 150, 0xffa06040);
+    auto positioner = xdg_wm_base_create_positioner(globals.wm_base);
+    xdg_positioner_set_size(positioner, 200, 150);
+    xdg_positioner_set_anchor_rect(positioner, options.width / 2,
+        options.height / 2, 1, 1);
+    xdg_positioner_set_anchor(positioner, XDG_POSITIONER_ANCHOR_BOTTOM_RIGHT);
+    xdg_positioner_set_gravity(positioner, XDG_POSITIONER_GRAVITY_BOTTOM_RIGHT);
+
+    popup_xsurface = xdg_wm_base_get_xdg_surface(globals.wm_base,
+        popup->surface);
+    xdg_surface_add_listener(popup_xsurface, &popup_surface_listener,
+        popup.get());
+    xpopup = xdg_surface_get_popup(popup_xsurface, xsurface, positioner);
+    xdg_positioner_destroy(positioner);
+    wl_surface_commit(popup->surface);
+}
+
+void window_t::draw()
+{
+    buffer_t *buffer = nullptr;
+    for (auto& b : buffers)
+    {
+        if (!b->busy)
+        {
+            buffer = b.get();
+            break;
+        }
+    }
+
+    if ((options.damage != DAMAGE_NONE) || (frame == 0))
+    {
+        wl_callback_add_listener(wl_surface_frame(surface), &frame_listener, this);
+    }
+
+    if (!buffer)
+    {
+        /* All buffers are in use, try again on the next frame */
+        wl_surface_commit(surface);
+        return;
+    }
+
+    const int w = options.width, h = options.height;
+    const uint32_t color = 0xff000000 | ((frame * 0x030507) & 0xffffff);
+    if ((frame == 0) || (options.damage == DAMAGE_FULL))
+    {
+        fill(buffer, 0, 0, w, h, color);
+        wl_surface_damage_buffer(surface, 0, 0, w, h);
+    } else if (options.damage == DAMAGE_TYPING)
+    {
+        const int cols = std::max(1, w / 8), rows = std::max(1, h / 16);
+        int x = (frame % cols) * 8;
+        int y = (frame / cols % rows) * 16;
+        fill(buffer, x, y, 16, 16, color);
+        wl_surface_damage_buffer(surface, x, y, 16, 16);
+    } else if (options.damage == DAMAGE_LINES)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            int y = (frame * 16 + i * h / 4) % std::max(1, h - 16);
+            fill(buffer, 0, y, w, 16, color);
+            wl_surface_damage_buffer(surface, 0, y, w, 16);
+        }
+    }
+
+    buffer->busy = true;
+    wl_surface_attach(surface, buffer->buffer, 0, 0);
+    wl_surface_commit(surface);
+    ++frame;
+}
+
+static void handle_ping(void*, xdg_wm_base *wm_base, uint32_t serial)
+{
+    xdg_wm_base_pong(wm_base, serial);
+}
+
+static const xdg_wm_base_listener wm_base_listener = {
+    .ping = handle_ping,
+};
+
+static void handle_global(void*, wl_registry *registry, uint32_t name,
+    const char *interface, uint32_t)
+{
+    if (!strcmp(interface, wl_compositor_interface.name))
+    {
+        globals.compositor = (wl_compositor*)wl_registry_bind(registry, name,
+            &wl_compositor_interface, 4);
+    } else if (!strcmp(interface, wl_subcompositor_interface.name))
+    {
+        globals.subcompositor = (wl_subcompositor*)wl_registry_bind(registry,
+            name, &wl_subcompositor_interface, 1);
+    } else if (!strcmp(interface, wl_shm_interface.name))
+    {
+        globals.shm = (wl_shm*)wl_registry_bind(registry, name,
+            &wl_shm_interface, 1);
+    } else if (!strcmp(interface, xdg_wm_base_interface.name))
+    {
+        globals.wm_base = (xdg_wm_base*)wl_registry_bind(registry, name,
+            &xdg_wm_base_interface, 1);
+        xdg_wm_base_add_listener(globals.wm_base, &wm_base_listener, nullptr);
+    }
+}
+
+static void handle_global_remove(void*, wl_registry*, uint32_t)
+{}
+
+static const wl_registry_listener registry_listener = {
+    .global = handle_global,
+    .global_remove = handle_global_remove,
+};
+
+static bool parse_options(int argc, char **argv)
+{
+    static const option opts[] = {
+        {"windows", required_argument, nullptr, 'n'},
+        {"size", required_argument, nullptr, 's'},
+        {"damage", required_argument, nullptr, 'd'},
+        {"subsurfaces", required_argument, nullptr, 'u'},
+        {"popups", no_argument, nullptr, 'p'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0},
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "n:s:d:u:ph", opts, nullptr)) != -1)
+    {
+        switch (c)
+        {
+          case 'n':
+            options.windows = atoi(optarg);
+            break;
+
+          case 's':
+            if (sscanf(optarg, "%dx%d", &options.width, &options.height) != 2)
+            {
+                return false;
+            }
+
+            break;
+
+          case 'd':
+            if (!strcmp(optarg, "none"))
+            {
+                options.damage = DAMAGE_NONE;
+            } else if (!strcmp(optarg, "full"))
+            {
+                options.damage = DAMAGE_FULL;
+            } else if (!strcmp(optarg, "typing"))
+            {
+                options.damage = DAMAGE_TYPING;
+            } else if (!strcmp(optarg, "lines"))
+            {
+                options.damage = DAMAGE_LINES;
+            } else
+            {
+                return false;
+            }
+
+            break;
+
+          case 'u':
+            options.subsurfaces = atoi(optarg);
+            break;
+
+          case 'p':
+            options.popups = true;
+            break;
+
+          default:
+            return false;
+        }
+    }
+
+    return (options.width > 0) && (options.height > 0);
+}
+
+int main(int argc, char **argv)
+{
+    if (!parse_options(argc, argv))
+    {
+        usage();
+        return 1;
+    }
+
+    globals.display = wl_display_connect(nullptr);
+    if (!globals.display)
+    {
+        fprintf(stderr, "Failed to connect to the wayland display\n");
+        return 1;
+    }
+
+    auto registry = wl_display_get_registry(globals.display);
+    wl_registry_add_listener(registry, &registry_listener, nullptr);
+    wl_display_roundtrip(globals.display);
+    if (!globals.compositor || !globals.subcompositor || !globals.shm ||
+        !globals.wm_base)
+    {
+        fprintf(stderr, "Missing required globals\n");
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<window_t>> windows;
+    for (int i = 0; i < options.windows; i++)
+    {
+        windows.push_back(std::make_unique<window_t>(i));
+    }
+
+    /* Run until the compositor goes away */
+    while (wl_display_dispatch(globals.display) != -1)
+    {}
+
+    return 0;
+}
@@ -0,0 +1,425 @@
+#include <wayfire/singleton-plugin.hpp>
+#include <wayfire/core.hpp>
+#include <wayfire/output.hpp>
+#include <wayfire/output-layout.hpp>
+#include <wayfire/render-manager.hpp>
+#include <wayfire/workspace-manager.hpp>
+#include <wayfire/view.hpp>
+#include <wayfire/option-wrapper.hpp>
+#include <wayfire/util/log.hpp>
+#include "output/frame-timing.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <dlfcn.h>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <sys/resource.h>
+
+/**
+ * Drives a benchmark run: starts the synthetic clients, runs a script of
+ * input actions, records the frames of all outputs, writes a report and shuts
+ * the compositor down.
+ *
+ * The script is a list of steps separated by ';':
+ *
+ * - wait <ms>: do nothing
+ * - motion <ms>: move the pointer in circles over the output
+ * - move <ms>: move the topmost view around
+ * - workspace <x> <y>: switch to the workspace
+ * - activate <binding>: call a plugin's activator, for ex. scale/toggle
+ * - wait-views <count>: wait until at least count views are mapped
+ *
+ * Allocations are counted if libwf-bench-alloc.so is preloaded.
+ */
+class wayfire_bench_driver
+{
+    wf::option_wrapper_t<std::string> clients{"bench-driver/clients"};
+    wf::option_wrapper_t<std::string> script{"bench-driver/script"};
+    wf::option_wrapper_t<std::string> report_file{"bench-driver/report"};
+    wf::option_wrapper_t<int> tick{"bench-driver/tick"};
+
+    struct step_t
+    {
+        std::string action;
+        std::vector<std::string> args;
+    };
+
+    std::vector<step_t> steps;
+    size_t current_step = 0;
+    /* Time spent in the current step, in ms */
+    int step_time = 0;
+
+    /** The recorded frames of an output */
+    struct output_record_t
+    {
+        wf::output_t *output;
+        std::vector<wf::frame_timing_t> frames;
+        std::vector<int64_t> allocations;
+        uint64_t last_sequence = 0;
+        bool has_frames = false;
+
+        uint64_t frame_start_allocations = 0;
+        wf::effect_hook_t on_frame_start;
+        wf::effect_hook_t on_frame_end;
+    };
+
+    std::map<wf::output_t*, std::unique_ptr<output_record_t>> records;
+
+    using alloc_count_t = uint64_t (*)();
+    alloc_count_t get_alloc_count = nullptr;
+
+    wf::wl_timer timer;
+    int64_t start_time;
+    rusage start_usage;
+
+  public:
+    wayfire_bench_driver()
+    {
+        get_alloc_count = (alloc_count_t)dlsym(RTLD_DEFAULT,
+            "wf_bench_alloc_count");
+        if (!get_alloc_count)
+        {
+            LOGW("bench-driver: libwf-bench-alloc.so is not preloaded, "
+                 "allocations are not counted");
+        }
+
+        parse_script(script);
+        for (auto& command : split(clients, ';'))
+        {
+            wf::get_core().run(command);
+        }
+
+        for (auto& output : wf::get_core().output_layout->get_outputs())
+        {
+            add_output(output);
+        }
+
+        start_time = wf::get_current_time();
+        getrusage(RUSAGE_SELF, &start_usage);
+        timer.set_timeout(tick, [=] ()
+        {
+            return run_tick();
+        });
+    }
+
+    ~wayfire_bench_driver()
+    {
+        for (auto& [output, record] : records)
+        {
+            output->render->rem_effect(&record->on_frame_start);
+            output->render->rem_effect(&record->on_frame_end);
+        }
+    }
+
+  private:
+    static std::vector<std::string> split(const std::string& str, char sep)
+    {
+        std::vector<std::string> result;
+        std::istringstream stream{str};
+        std::string item;
+        while (std::getline(stream, item, sep))
+        {
+            auto first = item.find_first_not_of(" \t");
+            auto last  = item.find_last_not_of(" \t");
+            if (first != std::string::npos)
+            {
+                result.push_back(item.substr(first, last - first + 1));
+            }
+        }
+
+        return result;
+    }
+
+    void parse_script(const std::string& text)
+    {
+        for (auto& line : split(text, ';'))
+        {
+            auto words = split(line, ' ');
+            step_t step;
+            step.action = words[0];
+            step.args.assign(words.begin() + 1, words.end());
+            steps.push_back(step);
+        }
+    }
+
+    int arg(const step_t& step, size_t i)
+    {
+        return i < step.args.size() ? std::atoi(step.args[i].c_str()) : 0;
+    }
+
+    void add_output(wf::output_t *output)
+    {
+        auto record = std::make_unique<output_record_t>();
+        record->output = output;
+        auto ptr = record.get();
+
+        record->on_frame_start = [=] ()
+        {
+            ptr->frame_start_allocations =
+                get_alloc_count ? get_alloc_count() : 0;
+        };
+        record->on_frame_end = [=] ()
+        {
+            if (get_alloc_count)
+            {
+                ptr->allocations.push_back(
+                    get_alloc_count() - ptr->frame_start_allocations);
+            }
+        };
+
+        output->render->add_effect(&record->on_frame_start,
+            wf::OUTPUT_EFFECT_PRE);
+        output->render->add_effect(&record->on_frame_end, wf::OUTPUT_EFFECT_POST);
+        records[output] = std::move(record);
+    }
+
+    /**
+     * Copy the frames published since the last call. The outputs only keep
+     * the latest frames, so this has to run more often than they are
+     * overwritten.
+     */
+    void collect_frames()
+    {
+        for (auto& [output, record] : records)
+        {
+            for (auto& frame : output->render->get_frame_timings())
+            {
+                if (!record->has_frames || (frame.sequence > record->last_sequence))
+                {
+                    record->frames.push_back(frame);
+                    record->last_sequence = frame.sequence;
+                    record->has_frames    = true;
+                }
+            }
+        }
+    }
+
+    bool run_tick()
+    {
+        collect_frames();
+        step_time += tick;
+
+        while (current_step < steps.size())
+        {
+            if (!run_step(steps[current_step]))
+            {
+                return true;
+            }
+
+            ++current_step;
+            step_time = 0;
+        }
+
+        finish();
+        return false;
+    }
+
+    /** @return Whether the step is done */
+    bool run_step(const step_t& step)
+    {
+        auto output = wf::get_core().get_active_output();
+        auto box    = output->get_layout_geometry();
+
+        if (step.action == "wait")
+        {
+            return step_time >= arg(step, 0);
+        } else if (step.action == "wait-views")
+        {
+            int mapped = 0;
+            for (auto& view : wf::get_core().get_all_views())
+            {
+                mapped += view->is_mapped() ? 1 : 0;
+            }
+
+            return mapped >= arg(step, 0);
+        } else if (step.action == "motion")
+        {
+            double angle = step_time / 200.0;
+            wf::get_core().warp_cursor({
+                box.x + box.width / 2 + std::cos(angle) * box.width / 3,
+                box.y + box.height / 2 + std::sin(angle) * box.height / 3,
+            });
+
+            return step_time >= arg(step, 0);
+        } else if (step.action == "move")
+        {
+            if (auto view = output->get_top_view())
+            {
+                double angle = step_time / 300.0;
+                view->move(box.width / 4 + std::cos(angle) * box.width / 8,
+                    box.height / 4 + std::sin(angle) * box.height / 8);
+            }
+
+            return step_time >= arg(step, 0);
+        } else if (step.action == "workspace")
+        {
+            output->workspace->request_workspace({arg(step, 0), arg(step, 1)});
+            return true;
+        } else if (step.action == "activate")
+        {
+            wf::activator_data_t data = {
+                .source = wf::activator_source_t::PLUGIN,
+                .activation_data = 0,
+            };
+            if (step.args.empty() || !output->call_plugin(step.args[0], data))
+            {
+                LOGW("bench-driver: failed to activate ",
+                    step.args.empty() ? "" : step.args[0]);
+            }
+
+            return true;
+        }
+
+        LOGE("bench-driver: unknown step ", step.action);
+        return true;
+    }
+
+    template<class T>
+    static void write_distribution(std::ostream& out, std::vector<T> values,
+        double scale)
+    {
+        if (values.empty())
+        {
+            out << "null";
+            return;
+        }
+
+        std::sort(values.begin(), values.end());
+        auto percentile = [&] (int p)
+        {
+            return values[(values.size() - 1) * p / 100] * scale;
+        };
+
+        double sum = 0;
+        for (auto& v : values)
+        {
+            sum += v;
+        }
+
+        out << "{\"count\": " << values.size() <<
+            ", \"mean\": " << sum * scale / values.size() <<
+            ", \"p50\": " << percentile(50) <<
+            ", \"p90\": " << percentile(90) <<
+            ", \"p99\": " << percentile(99) <<
+            ", \"max\": " << values.back() * scale << "}";
+    }
+
+    static double to_msec(const timeval& time)
+    {
+        return time.tv_sec * 1e3 + time.tv_usec / 1e3;
+    }
+
+    void write_report(std::ostream& out)
+    {
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+
+        out << "{\n";
+        out << "  \"script\": \"" << (std::string)script << "\",\n";
+        out << "  \"duration_ms\": " << wf::get_current_time() - start_time << ",\n";
+        out << "  \"cpu_user_ms\": " <<
+            to_msec(usage.ru_utime) - to_msec(start_usage.ru_utime) << ",\n";
+        out << "  \"cpu_system_ms\": " <<
+            to_msec(usage.ru_stime) - to_msec(start_usage.ru_stime) << ",\n";
+        out << "  \"outputs\": [";
+
+        bool first_output = true;
+        for (auto& [output, record] : records)
+        {
+            std::vector<int64_t> total, damage_rects;
+            std::vector<std::vector<int64_t>> phases(wf::FRAME_PHASE_TOTAL);
+            std::vector<std::vector<int64_t>> gpu_phases(wf::FRAME_PHASE_TOTAL);
+            int results[3] = {0, 0, 0};
+            for (auto& frame : record->frames)
+            {
+                ++results[frame.result];
+                if (frame.result != wf::FRAME_RESULT_RENDERED)
+                {
+                    continue;
+                }
+
+                total.push_back(frame.total_cpu_nsec);
+                damage_rects.push_back(frame.damage_rects);
+                for (int i = 0; i < wf::FRAME_PHASE_TOTAL; i++)
+                {
+                    phases[i].push_back(frame.cpu_nsec[i]);
+                    /* -1 if the phase wasn't measured on the GPU */
+                    if (frame.gpu_nsec[i] >= 0)
+                    {
+                        gpu_phases[i].push_back(frame.gpu_nsec[i]);
+                    }
+                }
+            }
+
+            out << (first_output ? "\n" : ",\n");
+            first_output = false;
+
+            out << "    {\n";
+            out << "      \"name\": \"" << output->to_string() << "\",\n";
+            out << "      \"frames_rendered\": " << results[0] << ",\n";
+            out << "      \"frames_scanout\": " << results[1] << ",\n";
+            out << "      \"frames_skipped\": " << results[2] << ",\n";
+            out << "      \"frame_cpu_us\": ";
+            write_distribution(out, total, 1e-3);
+            out << ",\n      \"phase_cpu_us\": {";
+            for (int i = 0; i < wf::FRAME_PHASE_TOTAL; i++)
+            {
+                out << (i ? ",\n        \"" : "\n        \"") <<
+                    wf::get_frame_phase_name((wf::frame_phase_t)i) << "\": ";
+                write_distribution(out, phases[i], 1e-3);
+            }
+
+            out << "\n      },\n      \"phase_gpu_us\": {";
+            bool first_phase = true;
+            for (int i = 0; i < wf::FRAME_PHASE_TOTAL; i++)
+            {
+                if (gpu_phases[i].empty())
+                {
+                    continue;
+                }
+
+                out << (first_phase ? "\n        \"" : ",\n        \"") <<
+                    wf::get_frame_phase_name((wf::frame_phase_t)i) << "\": ";
+                write_distribution(out, gpu_phases[i], 1e-3);
+                first_phase = false;
+            }
+
+            out << "\n      },\n";
+            out << "      \"damage_rects\": ";
+            write_distribution(out, damage_rects, 1);
+            out << ",\n      \"allocations_per_frame\": ";
+            write_distribution(out, record->allocations, 1);
+            out << "\n    }";
+        }
+
+        out << "\n  ]\n}\n";
+    }
+
+    void finish()
+    {
+        collect_frames();
+
+        std::ofstream out{(std::string)report_file};
+        if (out)
+        {
+            write_report(out);
+            LOGI("bench-driver: wrote the report to ", (std::string)report_file);
+        } else
+        {
+            LOGE("bench-driver: failed to open ", (std::string)report_file);
+        }
+
+        std::ofstream frames{(std::string)report_file + ".frames"};
+        for (auto& [output, record] : records)
+        {
+            frames << "## output " << output->to_string() << "\n";
+            frames << wf::format_frame_timings(record->frames);
+        }
+
+        wf::get_core().shutdown();
+    }
+};
+
+DECLARE_WAYFIRE_PLUGIN((wf::singleton_plugin_t<wayfire_bench_driver, false>));
@@ -0,0 +1,60 @@
+#!/bin/sh
+# Runs wayfire on a headless output with the benchmark driver and a set of
+# synthetic clients, and writes a JSON report of the rendered frames.
+#
+# Usage: run-bench.sh <build dir> <source dir> [report] [client args...]
+#
+# The client args are passed to every wf-bench-client instance, for ex.
+# "--damage typing --subsurfaces 2". Set BENCH_CLIENTS to change the number
+# of client processes (4 by default).
+
+set -e
+
+build="$(realpath "$1")"
+source="$(realpath "$2")"
+report="${3:-wayfire-bench.json}"
+if [ $# -ge 3 ]; then shift 3; else shift $#; fi
+
+clients="${BENCH_CLIENTS:-4}"
+client_args="$*"
+
+workdir="$(mktemp -d)"
+trap 'rm -rf "$workdir"' EXIT
+
+client_cmd="$build/test/bench/wf-bench-client $client_args"
+client_list=""
+for i in $(seq "$clients"); do
+    client_list="$client_list$client_cmd;"
+done
+
+# Each client opens one window unless told otherwise
+views="$clients"
+set -- $client_args
+while [ $# -gt 0 ]; do
+    case "$1" in
+        -n|--windows) views=$((clients * $2)); shift ;;
+    esac
+    shift
+done
+
+sed -e "s|@CLIENTS@|$client_list|" \
+    -e "s|@VIEWS@|$views|" \
+    -e "s|@REPORT@|$(realpath -m "$report")|" \
+    "$source/test/bench/bench.ini" > "$workdir/wayfire.ini"
+
+export WLR_BACKENDS=headless
+export WLR_HEADLESS_OUTPUTS=1
+export WLR_LIBINPUT_NO_DEVICES=1
+# Render with Mesa's llvmpipe when there is no GPU
+export WLR_RENDERER_ALLOW_SOFTWARE=1
+export WAYFIRE_PLUGIN_PATH="$build/test/bench:$(find "$build/plugins" -name '*.so' \
+    -exec dirname {} \; | sort -u | paste -sd:)"
+export WAYFIRE_PLUGIN_XML_PATH="$source/test/bench:$source/metadata"
+export XDG_RUNTIME_DIR="${XDG_RUNTIME_DIR:-$workdir}"
+unset WAYLAND_DISPLAY DISPLAY
+
+LD_PRELOAD="$build/test/bench/libwf-bench-alloc.so" \
+    "$build/src/wayfire" -c "$workdir/wayfire.ini" \
+    -B "$build/src/libdefault-config-backend.so"
+
+echo "Report written to $report"
@@ -0,0 +1,139 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+#include <cfloat>
+#include <cmath>
+#include <random>
+#include "core/output-lookup.hpp"
+#include <wayfire/nonstd/wlroots-full.hpp>
+
+/**
+ * The reference implementation, as in wlr_output_layout_closest_point()
+ * followed by wlr_output_layout_output_at().
+ */
+static int find_linear(const std::vector<wf::geometry_t>& boxes,
+    wf::pointf_t point, wf::pointf_t& closest)
+{
+    double min_distance = DBL_MAX;
+    closest = point;
+    for (auto& box : boxes)
+    {
+        double x, y;
+        wlr_box_closest_point(&box, point.x, point.y, &x, &y);
+        double distance = (point.x - x) * (point.x - x) +
+            (point.y - y) * (point.y - y);
+        if (std::isfinite(distance) && (distance < min_distance))
+        {
+            min_distance = distance;
+            closest = {x, y};
+        }
+    }
+
+    for (int i = 0; i < (int)boxes.size(); i++)
+    {
+        if (boxes[i] & closest)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static bool same_point(wf::pointf_t a, wf::pointf_t b)
+{
+    return (a.x == b.x) && (a.y == b.y);
+}
+
+TEST_CASE("No outputs")
+{
+    wf::output_lookup_t lookup;
+    wf::pointf_t closest;
+    REQUIRE(lookup.find_at({10, 10}) == -1);
+    REQUIRE(lookup.find_closest({10, 10}, closest) == -1);
+
+    lookup.rebuild({});
+    REQUIRE(lookup.find_closest({10, 10}, closest) == -1);
+}
+
+TEST_CASE("Points are clamped to the closest output")
+{
+    wf::output_lookup_t lookup;
+    lookup.rebuild({{0, 0, 1920, 1080}, {1920, 0, 1280, 1024}});
+
+    wf::pointf_t closest;
+    REQUIRE(lookup.find_closest({100.5, 200.5}, closest) == 0);
+    REQUIRE(same_point(closest, wf::pointf_t{100.5, 200.5}));
+
+    REQUIRE(lookup.find_closest({2000, 1000}, closest) == 1);
+    REQUIRE(lookup.find_at({2000, 1000}) == 1);
+
+    /* Below the second output, which is shorter than the first */
+    REQUIRE(lookup.find_closest({2000, 1050}, closest) == 1);
+    REQUIRE(closest.y < 1024);
+    REQUIRE(lookup.find_at({2000, 1050}) == -1);
+
+    REQUIRE(lookup.find_closest({-100, -100}, closest) == 0);
+    REQUIRE(same_point(closest, wf::pointf_t{0, 0}));
+
+    /* Rebuilding forgets the previous layout */
+    lookup.rebuild({{1920, 0, 1280, 1024}});
+    REQUIRE(lookup.find_at({100, 200}) == -1);
+    REQUIRE(lookup.find_closest({100, 200}, closest) == 0);
+}
+
+TEST_CASE("Earlier outputs win where they overlap")
+{
+    wf::output_lookup_t lookup;
+    lookup.rebuild({{0, 0, 1920, 1080}, {0, 0, 1920, 1080}, {960, 0, 1920, 1080}});
+
+    wf::pointf_t closest;
+    REQUIRE(lookup.find_closest({1000, 500}, closest) == 0);
+    REQUIRE(lookup.find_closest({2000, 500}, closest) == 2);
+    /* The last found output is not preferred over an earlier one */
+    REQUIRE(lookup.find_closest({1000, 500}, closest) == 0);
+}
+
+TEST_CASE("Random layouts are the same as with the reference")
+{
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> count_dist(1, 12);
+    std::uniform_int_distribution<int> size_dist(1, 3000);
+    std::uniform_int_distribution<int> pos_dist(-5000, 15000);
+    std::uniform_real_distribution<double> point_dist(-8000, 20000);
+
+    for (int layout = 0; layout < 200; layout++)
+    {
+        std::vector<wf::geometry_t> boxes;
+        int count = count_dist(gen);
+        for (int i = 0; i < count; i++)
+        {
+            /* Mostly a grid of outputs, like a video wall */
+            if (layout % 2)
+            {
+                boxes.push_back({(i % 4) * 1920, (i / 4) * 1080, 1920, 1080});
+            } else
+            {
+                boxes.push_back({pos_dist(gen), pos_dist(gen),
+                    size_dist(gen), size_dist(gen)});
+            }
+        }
+
+        wf::output_lookup_t lookup;
+        lookup.rebuild(boxes);
+        for (int i = 0; i < 500; i++)
+        {
+            wf::pointf_t point = {point_dist(gen), point_dist(gen)};
+            if (i % 2)
+            {
+                /* Points close to each other, as for pointer motion */
+                point = {(i % 8) * 1000.0 + 0.5, (i % 5) * 700.0 + 0.5};
+            }
+
+            wf::pointf_t expected, closest;
+            int index = find_linear(boxes, point, expected);
+            REQUIRE(lookup.find_closest(point, closest) == index);
+            REQUIRE(same_point(closest, expected));
+        }
+    }
+}
@@ -0,0 +1,105 @@
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include <wayfire/object.hpp>
+
+/**
+ * Measure the cost of emitting a signal by its name, by its ID and as a
+ * typed signal, on a provider with several other signals connected, as an
+ * output or a view has. Run with `meson test --benchmark` or directly.
+ */
+
+using bench_clock = std::chrono::steady_clock;
+
+static double elapsed_ns(bench_clock::time_point start, int iterations)
+{
+    std::chrono::duration<double, std::nano> time = bench_clock::now() - start;
+    return time.count() / iterations;
+}
+
+struct bench_provider_t : public wf::signal_provider_t
+{};
+
+struct bench_data_t : public wf::signal_data_t
+{
+    long value = 0;
+};
+
+static const wf::signal_t<bench_data_t> bench_signal{"region-damaged"};
+
+int main()
+{
+    const int iterations = 1000000;
+    int result = 0;
+
+    for (int num_connections : {1, 4, 16})
+    {
+        bench_provider_t provider;
+        long checksum = 0;
+        std::vector<std::unique_ptr<wf::signal_connection_t>> conns;
+
+        /* Other signals on the same provider */
+        for (int i = 0; i < 24; i++)
+        {
+            conns.push_back(std::make_unique<wf::signal_connection_t>(
+                [] (wf::signal_data_t*) {}));
+            provider.connect_signal("signal-" + std::to_string(i),
+                conns.back().get());
+        }
+
+        for (int i = 0; i < num_connections; i++)
+        {
+            conns.push_back(std::make_unique<wf::signal_connection_t>(
+                [&checksum] (wf::signal_data_t *data)
+            {
+                checksum += static_cast<bench_data_t*>(data)->value;
+            }));
+            provider.connect_signal(bench_signal, conns.back().get());
+        }
+
+        bench_data_t data;
+        data.value = 1;
+
+        auto start = bench_clock::now();
+        for (int i = 0; i < iterations; i++)
+        {
+            provider.emit_signal("region-damaged", &data);
+        }
+
+        double by_name = elapsed_ns(start, iterations);
+
+        start = bench_clock::now();
+        for (int i = 0; i < iterations; i++)
+        {
+            provider.emit_signal(bench_signal, &data);
+        }
+
+        double typed = elapsed_ns(start, iterations);
+
+        /* Connect and disconnect a connection among all others */
+        start = bench_clock::now();
+        for (int i = 0; i < iterations; i++)
+        {
+            wf::signal_connection_t conn;
+            provider.connect_signal(bench_signal, &conn);
+        }
+
+        double connect = elapsed_ns(start, iterations);
+
+        long expected = 2l * iterations * num_connections;
+        printf("%2d connections: by name %6.1f ns, typed %6.1f ns, "
+               "connect+disconnect %6.1f ns%s\n",
+            num_connections, by_name, typed, connect,
+            checksum != expected ? " (mismatch!)" : "");
+
+        if (checksum != expected)
+        {
+            /* The typed and by-name emits didn't reach every handler */
+            result = 1;
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,212 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+#include <memory>
+#include <wayfire/object.hpp>
+
+struct test_provider_t : public wf::signal_provider_t
+{};
+
+struct test_data_t : public wf::signal_data_t
+{
+    int value = 0;
+};
+
+static const wf::signal_t<test_data_t> test_signal{"test-signal"};
+
+TEST_CASE("Signal IDs are hashes of the names")
+{
+    static_assert(wf::signal_id_t{"a"} != wf::signal_id_t{"b"});
+    REQUIRE(wf::signal_id_t{"view-mapped"} ==
+        wf::signal_id_t{std::string("view-mapped")});
+    REQUIRE(wf::signal_id_t{""} != wf::signal_id_t{"view-mapped"});
+}
+
+TEST_CASE("Names, IDs and typed signals can be mixed")
+{
+    test_provider_t provider;
+    int calls = 0;
+    wf::signal_connection_t by_name = [&] (wf::signal_data_t *data)
+    {
+        calls += static_cast<test_data_t*>(data)->value;
+    };
+    wf::signal_connection_t typed = [&] (wf::signal_data_t *data)
+    {
+        calls += 10 * static_cast<test_data_t*>(data)->value;
+    };
+
+    provider.connect_signal("test-signal", &by_name);
+    provider.connect_signal(test_signal, &typed);
+
+    test_data_t data;
+    data.value = 1;
+    provider.emit_signal("test-signal", &data);
+    REQUIRE(calls == 11);
+    provider.emit_signal(test_signal, &data);
+    REQUIRE(calls == 22);
+    provider.emit_signal(wf::signal_id_t{"test-signal"}, &data);
+    REQUIRE(calls == 33);
+
+    provider.emit_signal("other-signal", &data);
+    REQUIRE(calls == 33);
+}
+
+TEST_CASE("Disconnecting")
+{
+    test_provider_t a, b;
+    int calls = 0;
+    wf::signal_connection_t conn = [&] (wf::signal_data_t*) { ++calls; };
+
+    a.connect_signal("s1", &conn);
+    a.connect_signal("s2", &conn);
+    b.connect_signal("s1", &conn);
+
+    a.emit_signal("s1", nullptr);
+    a.emit_signal("s2", nullptr);
+    b.emit_signal("s1", nullptr);
+    REQUIRE(calls == 3);
+
+    /* Only the connections to a are removed */
+    a.disconnect_signal(&conn);
+    a.emit_signal("s1", nullptr);
+    a.emit_signal("s2", nullptr);
+    b.emit_signal("s1", nullptr);
+    REQUIRE(calls == 4);
+
+    conn.disconnect();
+    b.emit_signal("s1", nullptr);
+    REQUIRE(calls == 4);
+
+    /* Can be connected again */
+    a.connect_signal("s1", &conn);
+    a.emit_signal("s1", nullptr);
+    REQUIRE(calls == 5);
+}
+
+TEST_CASE("Many connections are disconnected in any order")
+{
+    test_provider_t provider;
+    std::vector<int> calls(100, 0);
+    std::vector<std::unique_ptr<wf::signal_connection_t>> conns;
+    for (int i = 0; i < 100; i++)
+    {
+        conns.push_back(std::make_unique<wf::signal_connection_t>(
+            [&calls, i] (wf::signal_data_t*) { ++calls[i]; }));
+        provider.connect_signal("s", conns.back().get());
+    }
+
+    /* Remove every third connection, then the rest from the back */
+    for (int i = 0; i < 100; i += 3)
+    {
+        conns[i].reset();
+    }
+
+    provider.emit_signal("s", nullptr);
+    for (int i = 0; i < 100; i++)
+    {
+        REQUIRE(calls[i] == (i % 3 ? 1 : 0));
+    }
+
+    for (int i = 99; i >= 50; i--)
+    {
+        conns[i].reset();
+    }
+
+    provider.emit_signal("s", nullptr);
+    for (int i = 0; i < 100; i++)
+    {
+        REQUIRE(calls[i] == (i % 3 ? (i < 50 ? 2 : 1) : 0));
+    }
+}
+
+TEST_CASE("Connecting and disconnecting during emission")
+{
+    test_provider_t provider;
+    int first_calls  = 0;
+    int second_calls = 0;
+    int added_calls  = 0;
+
+    wf::signal_connection_t added = [&] (wf::signal_data_t*) { ++added_calls; };
+    auto second = std::make_unique<wf::signal_connection_t>(
+        [&] (wf::signal_data_t*) { ++second_calls; });
+
+    wf::signal_connection_t first = [&] (wf::signal_data_t*)
+    {
+        ++first_calls;
+        if (second)
+        {
+            second.reset();
+            provider.connect_signal("s", &added);
+        }
+    };
+
+    provider.connect_signal("s", &first);
+    provider.connect_signal("s", second.get());
+
+    /* The removed connection is not called anymore, the added one is only
+     * called from the next emission */
+    provider.emit_signal("s", nullptr);
+    REQUIRE(first_calls == 1);
+    REQUIRE(second_calls == 0);
+    REQUIRE(added_calls == 0);
+
+    provider.emit_signal("s", nullptr);
+    REQUIRE(first_calls == 2);
+    REQUIRE(added_calls == 1);
+}
+
+TEST_CASE("Nested emission")
+{
+    test_provider_t provider;
+    int calls = 0;
+    wf::signal_connection_t conn = [&] (wf::signal_data_t*)
+    {
+        if (++calls == 1)
+        {
+            provider.emit_signal("s", nullptr);
+            conn.disconnect();
+        }
+    };
+
+    provider.connect_signal("s", &conn);
+    provider.emit_signal("s", nullptr);
+    REQUIRE(calls == 2);
+    provider.emit_signal("s", nullptr);
+    REQUIRE(calls == 2);
+}
+
+TEST_CASE("Destroying the provider disconnects")
+{
+    int calls = 0;
+    wf::signal_connection_t conn = [&] (wf::signal_data_t*) { ++calls; };
+    test_provider_t other;
+    other.connect_signal("s", &conn);
+
+    {
+        test_provider_t provider;
+        provider.connect_signal("s", &conn);
+        provider.connect_signal("s", &conn);
+        provider.emit_signal("s", nullptr);
+        REQUIRE(calls == 2);
+    }
+
+    other.emit_signal("s", nullptr);
+    REQUIRE(calls == 3);
+    conn.disconnect();
+}
+
+TEST_CASE("Deprecated callbacks")
+{
+    test_provider_t provider;
+    int calls = 0;
+    wf::signal_callback_t callback = [&] (wf::signal_data_t*)
+    {
+        ++calls;
+        provider.disconnect_signal("s", &callback);
+    };
+
+    provider.connect_signal("s", &callback);
+    provider.emit_signal(wf::signal_id_t{"s"}, nullptr);
+    provider.emit_signal("s", nullptr);
+    REQUIRE(calls == 1);
+}
@@ -0,0 +1,252 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <wayfire/worker-pool.hpp>
+
+TEST_CASE("parallel_for covers the whole range once")
+{
+    wf::worker_pool_t pool{4};
+    REQUIRE(pool.get_concurrency() == 5);
+
+    for (size_t count : {0, 1, 7, 100, 1000, 1001})
+    {
+        std::vector<std::atomic<int>> calls(count);
+        pool.parallel_for(count, 16, [&] (size_t begin, size_t end)
+        {
+            REQUIRE(begin < end);
+            REQUIRE(end - begin <= 16);
+            for (size_t i = begin; i < end; i++)
+            {
+                ++calls[i];
+            }
+        });
+
+        for (auto& c : calls)
+        {
+            REQUIRE(c == 1);
+        }
+    }
+}
+
+TEST_CASE("Work runs on several threads")
+{
+    wf::worker_pool_t pool{3};
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    std::atomic<int> waiting{0};
+
+    /* Each task waits until all have started, so they must run at once */
+    std::vector<std::function<void()>> tasks(4, [&] ()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            threads.insert(std::this_thread::get_id());
+        }
+
+        ++waiting;
+        while (waiting < 4)
+        {
+            std::this_thread::yield();
+        }
+    });
+
+    pool.fork_join(tasks);
+    REQUIRE(threads.size() == 4);
+    REQUIRE(threads.count(std::this_thread::get_id()) == 1);
+}
+
+TEST_CASE("Nested calls run on the calling thread")
+{
+    wf::worker_pool_t pool{2};
+    std::atomic<int> sum{0};
+    pool.parallel_for(8, 1, [&] (size_t, size_t)
+    {
+        pool.parallel_for(10, 2, [&] (size_t begin, size_t end)
+        {
+            sum += end - begin;
+        });
+    });
+
+    REQUIRE(sum == 80);
+}
+
+TEST_CASE("A pool without threads runs everything on the caller")
+{
+    wf::worker_pool_t pool{0};
+    REQUIRE(pool.get_concurrency() == 1);
+
+    auto caller = std::this_thread::get_id();
+    int calls   = 0;
+    pool.parallel_for(100, 10, [&] (size_t, size_t)
+    {
+        REQUIRE(std::this_thread::get_id() == caller);
+        ++calls;
+    });
+    REQUIRE(calls == 10);
+}
+
+TEST_CASE("Submitted tasks all run on the workers")
+{
+    std::atomic<int> done{0};
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    {
+        wf::worker_pool_t pool{4};
+        for (int i = 0; i < 100; i++)
+        {
+            pool.submit([&] ()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    threads.insert(std::this_thread::get_id());
+                }
+
+                /* Tasks submitted from tasks go to the same worker */
+                pool.submit([&] () { ++done; });
+                ++done;
+            });
+        }
+
+        while (done < 200)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    REQUIRE(done == 200);
+    REQUIRE(threads.count(std::this_thread::get_id()) == 0);
+}
+
+TEST_CASE("Idle workers steal submitted tasks")
+{
+    wf::worker_pool_t pool{3};
+    std::atomic<int> waiting{0};
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+
+    /* The first task queues the others on its own worker, and waits until
+     * they have started, so they must be stolen by the other workers.
+     * They also wait for each other, so they must run on different ones. */
+    pool.submit([&] ()
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            pool.submit([&] ()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    threads.insert(std::this_thread::get_id());
+                }
+
+                ++waiting;
+                while (waiting < 2)
+                {
+                    std::this_thread::yield();
+                }
+            });
+        }
+
+        while (waiting < 2)
+        {
+            std::this_thread::yield();
+        }
+
+        ++waiting;
+    });
+
+    while (waiting < 3)
+    {
+        std::this_thread::yield();
+    }
+
+    REQUIRE(threads.size() == 2);
+}
+
+TEST_CASE("Tasks submitted from several threads all run")
+{
+    constexpr int num_submitters = 4;
+    constexpr int tasks_per_submitter = 2000;
+
+    for (int round = 0; round < 20; round++)
+    {
+        std::atomic<int> done{0};
+        wf::worker_pool_t pool{4};
+
+        /* Submitters and tasks which submit more tasks keep the queues of
+         * all workers busy, so that the workers steal from each other while
+         * others push and pop. */
+        std::vector<std::thread> submitters;
+        for (int i = 0; i < num_submitters; i++)
+        {
+            submitters.emplace_back([&] ()
+            {
+                for (int j = 0; j < tasks_per_submitter; j++)
+                {
+                    pool.submit([&] ()
+                    {
+                        pool.submit([&] () { ++done; });
+                        ++done;
+                    });
+                }
+            });
+        }
+
+        for (auto& thread : submitters)
+        {
+            thread.join();
+        }
+
+        while (done < 2 * num_submitters * tasks_per_submitter)
+        {
+            std::this_thread::yield();
+        }
+
+        REQUIRE(done == 2 * num_submitters * tasks_per_submitter);
+    }
+}
+
+TEST_CASE("Submitted tasks run inline without threads")
+{
+    wf::worker_pool_t pool{0};
+    bool done = false;
+    pool.submit([&] () { done = true; });
+    REQUIRE(done);
+}
+
+TEST_CASE("Workers of one pool can submit to a smaller pool")
+{
+    std::atomic<int> started{0};
+    std::atomic<int> done{0};
+    wf::worker_pool_t small{1};
+    {
+        wf::worker_pool_t large{4};
+
+        /* The tasks wait for each other, so every worker of the large pool
+         * submits to the small one, which has fewer queues than the large
+         * pool has workers. */
+        for (int i = 0; i < 4; i++)
+        {
+            large.submit([&] ()
+            {
+                ++started;
+                while (started < 4)
+                {
+                    std::this_thread::yield();
+                }
+
+                small.submit([&] () { ++done; });
+            });
+        }
+
+        while (done < 4)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    REQUIRE(done == 4);
+}
@@ -0,0 +1,99 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+#include <random>
+#include "output/damage-coalescer.hpp"
+
+static int count_boxes(const wf::region_t& region)
+{
+    return std::distance(region.begin(), region.end());
+}
+
+/** @return Whether @region contains all of @other */
+static bool contains(const wf::region_t& region, const wf::region_t& other)
+{
+    return (other ^ region).empty();
+}
+
+TEST_CASE("Small damage is left as it is")
+{
+    wf::damage_coalesce_policy_t policy;
+
+    wf::region_t damage;
+    auto stats = wf::coalesce_damage(damage, policy);
+    REQUIRE(damage.empty());
+    REQUIRE(stats.rects_after == 0);
+
+    damage |= wf::geometry_t{10, 10, 100, 100};
+    stats = wf::coalesce_damage(damage, policy);
+    REQUIRE(stats.rects_before == 1);
+    REQUIRE(stats.rects_after == 1);
+    REQUIRE(stats.area_added == 0);
+}
+
+TEST_CASE("Close boxes are merged")
+{
+    /* Like a cursor and a glyph next to each other in a terminal */
+    wf::region_t damage;
+    damage |= wf::geometry_t{0, 0, 10, 20};
+    damage |= wf::geometry_t{11, 2, 10, 20};
+    const auto original = damage;
+    REQUIRE(count_boxes(damage) > 1);
+
+    wf::damage_coalesce_policy_t policy;
+    policy.max_waste = 0.25;
+    policy.max_rects = 0;
+    auto stats = wf::coalesce_damage(damage, policy);
+    REQUIRE(stats.rects_after == 1);
+    REQUIRE(stats.area_added == 21 * 22 - 400);
+    REQUIRE(contains(damage, original));
+
+    /* Merging disabled */
+    damage = original;
+    policy.max_waste = -1;
+    stats = wf::coalesce_damage(damage, policy);
+    REQUIRE(stats.rects_after == stats.rects_before);
+    REQUIRE(stats.area_added == 0);
+}
+
+TEST_CASE("Distant boxes are not merged")
+{
+    wf::region_t damage;
+    damage |= wf::geometry_t{0, 0, 10, 10};
+    damage |= wf::geometry_t{500, 500, 10, 10};
+
+    wf::damage_coalesce_policy_t policy;
+    policy.max_waste = 0.25;
+    policy.max_rects = 32;
+    auto stats = wf::coalesce_damage(damage, policy);
+    REQUIRE(stats.rects_after == 2);
+    REQUIRE(stats.area_added == 0);
+}
+
+TEST_CASE("The number of boxes is limited")
+{
+    std::mt19937 gen(1);
+    std::uniform_int_distribution<int> pos(0, 1900);
+    std::uniform_int_distribution<int> size(1, 16);
+
+    for (int max_rects : {1, 4, 16, 32})
+    {
+        wf::region_t damage;
+        for (int i = 0; i < 500; i++)
+        {
+            damage |= wf::geometry_t{pos(gen), pos(gen), size(gen), size(gen)};
+        }
+
+        const auto original = damage;
+
+        wf::damage_coalesce_policy_t policy;
+        policy.max_waste = 0;
+        policy.max_rects = max_rects;
+        auto stats = wf::coalesce_damage(damage, policy);
+        REQUIRE(stats.rects_before == count_boxes(original));
+        REQUIRE(stats.rects_after == count_boxes(damage));
+        REQUIRE(stats.rects_after <= max_rects);
+        REQUIRE(contains(damage, original));
+        REQUIRE(stats.area_added > 0);
+    }
+}
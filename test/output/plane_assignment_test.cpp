@@ -0,0 +1,181 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+#include <set>
+#include "output/plane-assignment.hpp"
+
+/**
+ * A plane backend without real hardware. It has a configurable number of
+ * overlay planes and can be told to reject specific candidates.
+ */
+class test_plane_backend_t : public wf::plane_backend_t
+{
+  public:
+    int overlay_planes = 1;
+    std::set<const void*> rejected;
+    int num_tests = 0;
+
+    int get_overlay_plane_count() override
+    {
+        return overlay_planes;
+    }
+
+    bool test(const std::vector<wf::plane_candidate_t>& candidates,
+        const wf::plane_assignment_t& assignment) override
+    {
+        ++num_tests;
+        if ((assignment.primary >= 0) &&
+            rejected.count(candidates[assignment.primary].id))
+        {
+            return false;
+        }
+
+        for (int index : assignment.overlays)
+        {
+            if ((index >= 0) && rejected.count(candidates[index].id))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool commit(const std::vector<wf::plane_candidate_t>&,
+        const wf::plane_assignment_t&) override
+    {
+        return true;
+    }
+};
+
+static const wf::geometry_t output_box = {0, 0, 1920, 1080};
+static int video, panel, window, background;
+
+static wf::plane_candidate_t make_candidate(const void *id, wf::geometry_t box,
+    bool opaque = true, bool capable = true)
+{
+    wf::plane_candidate_t candidate;
+    candidate.id = id;
+    candidate.geometry = box;
+    if (opaque)
+    {
+        candidate.opaque = box;
+    }
+
+    candidate.scanout_capable = capable;
+    return candidate;
+}
+
+TEST_CASE("Fullscreen opaque surface goes on the primary plane")
+{
+    test_plane_backend_t backend;
+    auto result = wf::assign_planes({make_candidate(&video, output_box)},
+        output_box, backend);
+
+    REQUIRE_EQ(result.primary, 0);
+    REQUIRE(result.composited.empty());
+}
+
+TEST_CASE("Surfaces below an opaque fullscreen surface are dropped")
+{
+    test_plane_backend_t backend;
+    auto result = wf::assign_planes({
+        make_candidate(&video, output_box),
+        make_candidate(&window, output_box, true, false),
+        make_candidate(&background, output_box),
+    }, output_box, backend);
+
+    REQUIRE_EQ(result.primary, 0);
+    REQUIRE(result.composited.empty());
+}
+
+TEST_CASE("Non-opaque fullscreen surface needs composition")
+{
+    test_plane_backend_t backend;
+    backend.overlay_planes = 0;
+    auto result = wf::assign_planes({make_candidate(&video, output_box, false)},
+        output_box, backend);
+
+    REQUIRE_EQ(result.primary, -1);
+    REQUIRE_EQ(result.composited, std::vector<int>{0});
+}
+
+TEST_CASE("Panel goes on an overlay above a fullscreen video")
+{
+    test_plane_backend_t backend;
+    auto result = wf::assign_planes({
+        make_candidate(&panel, {0, 0, 1920, 30}, false),
+        make_candidate(&video, output_box),
+    }, output_box, backend);
+
+    REQUIRE_EQ(result.overlays, std::vector<int>{0});
+    REQUIRE_EQ(result.primary, 1);
+    REQUIRE(result.composited.empty());
+}
+
+TEST_CASE("Without overlay planes, everything is composited")
+{
+    test_plane_backend_t backend;
+    backend.overlay_planes = 0;
+    auto result = wf::assign_planes({
+        make_candidate(&panel, {0, 0, 1920, 30}, false),
+        make_candidate(&video, output_box),
+    }, output_box, backend);
+
+    REQUIRE_EQ(result.primary, -1);
+    REQUIRE_EQ(result.composited, (std::vector<int>{0, 1}));
+}
+
+TEST_CASE("Rejected overlay candidates fall back to composition")
+{
+    test_plane_backend_t backend;
+    backend.rejected.insert(&panel);
+    auto result = wf::assign_planes({
+        make_candidate(&panel, {0, 0, 1920, 30}, false),
+        make_candidate(&video, {100, 100, 640, 480}),
+        make_candidate(&background, output_box, true, false),
+    }, output_box, backend);
+
+    /* The panel is rejected, the video takes the overlay instead */
+    REQUIRE_EQ(result.overlays, std::vector<int>{1});
+    REQUIRE_EQ(result.primary, -1);
+    REQUIRE_EQ(result.composited, (std::vector<int>{0, 2}));
+}
+
+TEST_CASE("Surfaces below composited surfaces do not go on overlays")
+{
+    test_plane_backend_t backend;
+    auto result = wf::assign_planes({
+        make_candidate(&window, {0, 0, 800, 600}, true, false),
+        make_candidate(&video, {400, 300, 800, 600}),
+        make_candidate(&background, output_box, true, false),
+    }, output_box, backend);
+
+    REQUIRE_EQ(result.overlays, std::vector<int>{-1});
+    REQUIRE_EQ(result.composited, (std::vector<int>{0, 1, 2}));
+}
+
+TEST_CASE("Rejected primary falls back to composition")
+{
+    test_plane_backend_t backend;
+    backend.rejected.insert(&video);
+    auto result = wf::assign_planes({make_candidate(&video, output_box)},
+        output_box, backend);
+
+    REQUIRE_EQ(result.primary, -1);
+    REQUIRE_EQ(result.composited, std::vector<int>{0});
+}
+
+TEST_CASE("Overlays are filled from the topmost plane")
+{
+    test_plane_backend_t backend;
+    backend.overlay_planes = 2;
+    auto result = wf::assign_planes({
+        make_candidate(&panel, {0, 0, 1920, 30}, false),
+        make_candidate(&video, {100, 100, 640, 480}),
+        make_candidate(&background, output_box),
+    }, output_box, backend);
+
+    REQUIRE_EQ(result.overlays, (std::vector<int>{1, 0}));
+    REQUIRE_EQ(result.primary, 2);
+}
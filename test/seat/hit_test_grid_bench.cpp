@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include "core/seat/hit-test-grid.hpp"
+
+/**
+ * Compare the lookups in a hit_test_grid_t with going through all boxes, as
+ * done for the surface under the cursor before. Run with `meson test
+ * --benchmark` or directly.
+ */
+
+using bench_clock = std::chrono::steady_clock;
+
+static double elapsed_ns(bench_clock::time_point start, int iterations)
+{
+    std::chrono::duration<double, std::nano> time = bench_clock::now() - start;
+    return time.count() / iterations;
+}
+
+int main()
+{
+    const wf::geometry_t area = {0, 0, 3840, 2160};
+    const int iterations = 1000000;
+
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<double> px(0, area.width);
+    std::uniform_real_distribution<double> py(0, area.height);
+
+    std::vector<wf::pointf_t> points;
+    for (int i = 0; i < 4096; i++)
+    {
+        points.push_back({px(gen), py(gen)});
+    }
+
+    for (int count : {10, 50, 200, 1000})
+    {
+        std::uniform_int_distribution<int> x(0, area.width - 1);
+        std::uniform_int_distribution<int> y(0, area.height - 1);
+        std::uniform_int_distribution<int> size(50, 600);
+        std::vector<wf::geometry_t> boxes;
+        for (int i = 0; i < count; i++)
+        {
+            boxes.push_back({x(gen), y(gen), size(gen), size(gen)});
+        }
+
+        wf::hit_test_grid_t grid;
+        auto start = bench_clock::now();
+        grid.rebuild(area, boxes);
+        double rebuild = elapsed_ns(start, 1);
+
+        /* Accumulate results so that the lookups are not optimized out */
+        long checksum = 0;
+        start = bench_clock::now();
+        for (int i = 0; i < iterations; i++)
+        {
+            auto& p = points[i % points.size()];
+            for (int j = 0; j < (int)boxes.size(); j++)
+            {
+                if (boxes[j] & p)
+                {
+                    checksum += j;
+                    break;
+                }
+            }
+        }
+
+        double linear = elapsed_ns(start, iterations);
+
+        start = bench_clock::now();
+        for (int i = 0; i < iterations; i++)
+        {
+            auto& p = points[i % points.size()];
+            int index = grid.find_box_at(p, [] (uint32_t) { return true; });
+            checksum -= std::max(index, 0);
+        }
+
+        double indexed = elapsed_ns(start, iterations);
+
+        printf("%5d boxes: linear %8.1f ns, grid %6.1f ns, rebuild %9.0f ns%s\n",
+            count, linear, indexed, rebuild, checksum ? " (mismatch!)" : "");
+    }
+
+    return 0;
+}
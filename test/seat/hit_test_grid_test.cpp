@@ -0,0 +1,103 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+#include <random>
+#include "core/seat/hit-test-grid.hpp"
+
+/** The reference implementation: go through all boxes in order. */
+static int find_linear(const std::vector<wf::geometry_t>& boxes,
+    wf::pointf_t point, int skip = -1)
+{
+    for (int i = 0; i < (int)boxes.size(); i++)
+    {
+        if ((i != skip) && (boxes[i] & point))
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+TEST_CASE("Empty grid")
+{
+    wf::hit_test_grid_t grid;
+    REQUIRE(grid.find_box_at({10, 10}, [] (uint32_t) { return true; }) == -1);
+
+    grid.rebuild({0, 0, 1920, 1080}, {});
+    REQUIRE(grid.size() == 0);
+    REQUIRE(grid.find_box_at({10, 10}, [] (uint32_t) { return true; }) == -1);
+}
+
+TEST_CASE("Boxes are found in priority order")
+{
+    wf::hit_test_grid_t grid{100};
+    grid.rebuild({0, 0, 1000, 1000}, {
+        {50, 50, 100, 100},
+        {0, 0, 1000, 1000},
+        {120, 120, 300, 300},
+    });
+
+    auto any = [] (uint32_t) { return true; };
+    REQUIRE(grid.find_box_at({60, 60}, any) == 0);
+    REQUIRE(grid.find_box_at({149.5, 149.5}, any) == 0);
+    REQUIRE(grid.find_box_at({150, 150}, any) == 1);
+    REQUIRE(grid.find_box_at({999, 999}, any) == 1);
+
+    /* The callback can reject boxes, then the next one is tried */
+    std::vector<uint32_t> tried;
+    int found = grid.find_box_at({130, 130}, [&] (uint32_t index)
+    {
+        tried.push_back(index);
+        return index == 2;
+    });
+    REQUIRE(found == 2);
+    REQUIRE(tried == std::vector<uint32_t>({0, 1, 2}));
+}
+
+TEST_CASE("Points outside of the area")
+{
+    wf::hit_test_grid_t grid{64};
+    grid.rebuild({100, 100, 500, 500}, {
+        {0, 0, 1000, 1000},
+    });
+
+    auto any = [] (uint32_t) { return true; };
+    REQUIRE(grid.find_box_at({99.5, 200}, any) == -1);
+    REQUIRE(grid.find_box_at({200, 600}, any) == -1);
+    REQUIRE(grid.find_box_at({100, 100}, any) == 0);
+    REQUIRE(grid.find_box_at({599.9, 599.9}, any) == 0);
+}
+
+TEST_CASE("Grid matches a linear scan")
+{
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> pos(-200, 2000);
+    std::uniform_int_distribution<int> size(1, 800);
+    std::uniform_real_distribution<double> point(0, 1920);
+
+    std::vector<wf::geometry_t> boxes;
+    for (int i = 0; i < 200; i++)
+    {
+        boxes.push_back({pos(gen), pos(gen), size(gen), size(gen)});
+    }
+
+    const wf::geometry_t area = {0, 0, 1920, 1920};
+    wf::hit_test_grid_t grid;
+    grid.rebuild(area, boxes);
+    REQUIRE(grid.size() == boxes.size());
+
+    for (int i = 0; i < 10000; i++)
+    {
+        wf::pointf_t p = {point(gen), point(gen)};
+        REQUIRE(grid.find_box_at(p, [] (uint32_t) { return true; }) ==
+            find_linear(boxes, p));
+
+        /* Skipping the topmost box must give the next one */
+        int top = find_linear(boxes, p);
+        REQUIRE(grid.find_box_at(p, [&] (uint32_t index)
+        {
+            return (int)index != top;
+        }) == find_linear(boxes, p, top));
+    }
+}
@@ -0,0 +1,175 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+#include <cmath>
+#include <vector>
+
+extern "C"
+{
+#include "wobbly.h"
+
+double wobbly_settings_get_friction()
+{
+    return 3.0;
+}
+
+double wobbly_settings_get_spring_k()
+{
+    return 8.0;
+}
+}
+
+/* The world keeps the address of the surface, so it is initialized in place */
+static void init_surface(wobbly_surface& surface, wobbly_world *world, int x,
+    int grid)
+{
+    surface = {};
+    surface.world  = world;
+    surface.x      = x;
+    surface.y      = 0;
+    surface.width  = 400;
+    surface.height = 300;
+    surface.grid_width  = grid;
+    surface.grid_height = grid;
+    surface.x_cells = 8;
+    surface.y_cells = 8;
+    surface.synced  = 1;
+    REQUIRE(wobbly_init(&surface));
+}
+
+/* Drag the surface by 200 pixels, release it, and step until it settles */
+static int drag_and_settle(std::vector<wobbly_world*> worlds,
+    std::vector<wobbly_surface*> surfaces)
+{
+    for (auto surface : surfaces)
+    {
+        wobbly_grab_notify(surface, surface->x + 200, 150);
+    }
+
+    for (int i = 0; i < 20; i++)
+    {
+        for (auto surface : surfaces)
+        {
+            wobbly_move_notify(surface, surface->x + 200 + 10 * i, 150);
+        }
+
+        for (auto world : worlds)
+        {
+            wobbly_world_step(world, 16);
+        }
+    }
+
+    for (auto surface : surfaces)
+    {
+        wobbly_ungrab_notify(surface);
+    }
+
+    for (int frames = 1; frames < 1000; frames++)
+    {
+        for (auto world : worlds)
+        {
+            wobbly_world_step(world, 16);
+        }
+
+        bool all_synced = true;
+        for (auto surface : surfaces)
+        {
+            wobbly_add_geometry(surface);
+            wobbly_done_paint(surface);
+            all_synced &= surface->synced;
+        }
+
+        if (all_synced)
+        {
+            return frames;
+        }
+    }
+
+    return -1;
+}
+
+TEST_CASE("Models of any grid size settle at their size")
+{
+    auto world = wobbly_world_create();
+    wobbly_surface small, large;
+    init_surface(small, world, 0, 4);
+    init_surface(large, world, 1000, 8);
+
+    REQUIRE(drag_and_settle({world}, {&small, &large}) > 0);
+    for (auto surface : {&small, &large})
+    {
+        auto box = wobbly_boundingbox(surface);
+        CHECK(box.brx - box.tlx == doctest::Approx(400).epsilon(0.01));
+        CHECK(box.bry - box.tly == doctest::Approx(300).epsilon(0.01));
+
+        /* The corners of the geometry are the corners of the model */
+        int last = (surface->x_cells + 1) * (surface->y_cells + 1) - 1;
+        CHECK(surface->v[0] == doctest::Approx(box.tlx).epsilon(0.01));
+        CHECK(surface->v[2 * last + 1] == doctest::Approx(box.bry).epsilon(0.01));
+    }
+
+    wobbly_fini(&small);
+    wobbly_fini(&large);
+    wobbly_world_destroy(world);
+}
+
+TEST_CASE("Models are independent of the other models in their world")
+{
+    auto shared_world = wobbly_world_create();
+    auto own_world    = wobbly_world_create();
+
+    wobbly_surface alone, first, second, third;
+    init_surface(alone, own_world, 0, 4);
+    init_surface(first, shared_world, 0, 4);
+    init_surface(second, shared_world, 500, 6);
+    init_surface(third, shared_world, 0, 4);
+
+    /* Removing a model moves the ones after it */
+    wobbly_fini(&second);
+    drag_and_settle({shared_world, own_world}, {&alone, &first, &third});
+
+    auto a = wobbly_boundingbox(&alone);
+    auto b = wobbly_boundingbox(&first);
+    auto c = wobbly_boundingbox(&third);
+    CHECK(a.tlx == doctest::Approx(b.tlx));
+    CHECK(a.tly == doctest::Approx(b.tly));
+    CHECK(a.tlx == doctest::Approx(c.tlx));
+    CHECK(a.tly == doctest::Approx(c.tly));
+
+    wobbly_fini(&alone);
+    wobbly_fini(&first);
+    wobbly_fini(&third);
+    wobbly_world_destroy(shared_world);
+    wobbly_world_destroy(own_world);
+}
+
+TEST_CASE("Models keep their state when moved to another world")
+{
+    auto world_a = wobbly_world_create();
+    auto world_b = wobbly_world_create();
+    wobbly_surface moved, other;
+    init_surface(moved, world_a, 0, 5);
+    init_surface(other, world_a, 0, 5);
+
+    wobbly_slight_wobble(&moved);
+    wobbly_slight_wobble(&other);
+    wobbly_world_step(world_a, 16);
+    REQUIRE(wobbly_set_world(&moved, world_b));
+
+    for (int i = 0; i < 10; i++)
+    {
+        wobbly_world_step(world_a, 16);
+        wobbly_world_step(world_b, 16);
+    }
+
+    auto a = wobbly_boundingbox(&moved);
+    auto b = wobbly_boundingbox(&other);
+    CHECK(a.tlx == doctest::Approx(b.tlx));
+    CHECK(a.brx == doctest::Approx(b.brx));
+    CHECK(a.bry == doctest::Approx(b.bry));
+
+    wobbly_fini(&moved);
+    wobbly_fini(&other);
+    wobbly_world_destroy(world_a);
+    wobbly_world_destroy(world_b);
+}